@@ -53,6 +53,7 @@ extern Bit32s CPU_CycleLeft;
 extern Bit32s CPU_CycleMax;
 extern Bit32s CPU_OldCycleMax;
 extern Bit32s CPU_CyclePercUsed;
+extern Bit32s CPU_CycleLoad;		//Measured host load of auto cycles in percent
 extern Bit32s CPU_CycleLimit;
 extern Bit64s CPU_IODelayRemoved;
 extern bool CPU_CycleAutoAdjust;
@@ -63,6 +64,28 @@ extern Bitu CPU_ArchitectureType;
 
 extern Bitu CPU_PrefetchQueueSize;
 
+/* The normal and simple cores can dispatch through a table of handler
+   labels instead of a switch, this needs the labels as values extension */
+#if defined(__GNUC__)
+#define CPU_CORE_THREADED 1
+#else
+#define CPU_CORE_THREADED 0
+#endif
+
+/* Normal and simple core use the threaded dispatch */
+extern bool CPU_CoreThreaded;
+
+/* Normal core runs the common instructions from the decoded instruction cache */
+extern bool CPU_DecodeCache;
+
+/* Longest host sleep in ms while the guest is halted, 0 disables idle sleeping */
+extern Bitu CPU_IdleSleep;
+
+/* The interpreter cores skip ahead in loops that only poll for an event */
+extern bool CPU_PollSkip;
+void CPU_PollLoop(PhysPt head,Bitu len);
+void CPU_PollLoopStats(void);
+
 /* Some common Defines */
 /* A CPU Handler */
 typedef Bits (CPU_Decoder)(void);
@@ -71,6 +94,8 @@ extern CPU_Decoder * cpudecoder;
 Bits CPU_Core_Normal_Run(void);
 Bits CPU_Core_Normal_Trap_Run(void);
 Bits CPU_Core_Simple_Run(void);
+Bits CPU_Core_Normal_Threaded_Run(void);
+Bits CPU_Core_Simple_Threaded_Run(void);
 Bits CPU_Core_Full_Run(void);
 Bits CPU_Core_Dyn_X86_Run(void);
 Bits CPU_Core_Dyn_X86_Trap_Run(void);
@@ -126,6 +151,7 @@ void CPU_CALL(bool use32,Bitu selector,Bitu offset,Bitu oldeip);
 void CPU_RET(bool use32,Bitu bytes,Bitu oldeip);
 void CPU_IRET(bool use32,Bitu oldeip);
 void CPU_HLT(Bitu oldeip);
+bool CPU_IsHalted(void);
 
 bool CPU_POPF(Bitu use32);
 bool CPU_PUSHF(Bitu use32);
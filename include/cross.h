@@ -74,6 +74,10 @@ public:
 	static void ResolveHomedir(std::string & temp_line);
 	static void CreateDir(std::string const& temp);
 	static bool IsPathAbsolute(std::string const& in);
+	static int GetCPUCount(void);
+	static bool GetExecutablePath(std::string & path);
+	static Bit64u GetTicksUs(void);
+	static void DelayUs(Bit32u us);
 };
 
 
@@ -33,6 +33,7 @@ typedef Bitu (LoopHandler)(void);
 
 void DOSBOX_RunMachine();
 void DOSBOX_SetLoop(LoopHandler * handler);
+void DOSBOX_ResetAutoCycles(void);
 void DOSBOX_SetNormalLoop();
 
 void DOSBOX_Init(void);
@@ -49,7 +49,21 @@ FILE * OpenCaptureFile(const char * type,const char * ext);
 void CAPTURE_AddWave(Bit32u freq, Bit32u len, Bit16s * data);
 #define CAPTURE_FLAG_DBLW	0x1
 #define CAPTURE_FLAG_DBLH	0x2
-void CAPTURE_AddImage(Bitu width, Bitu height, Bitu bpp, Bitu pitch, Bitu flags, float fps, Bit8u * data, Bit8u * pal);
+/* changed holds a flag for each source line that differs from the previous
+ * frame, without it every line counts as changed */
+void CAPTURE_AddImage(Bitu width, Bitu height, Bitu bpp, Bitu pitch, Bitu flags, float fps, Bit8u * data, Bit8u * pal, Bit8u * changed);
 void CAPTURE_AddMidi(bool sysex, Bitu len, Bit8u * data);
 
+/* Capture files are written by a background thread, in order per file.
+ * CAPTURE_Write copies the data, CAPTURE_WriteOwned takes over a malloced
+ * buffer. Deferred jobs run on the writer thread between the writes. */
+void CAPTURE_Write(FILE * handle, const void * data, Bitu size);
+void CAPTURE_WriteAt(FILE * handle, long pos, const void * data, Bitu size);
+void CAPTURE_WriteOwned(FILE * handle, void * data, Bitu size);
+void CAPTURE_Close(FILE * handle);
+void CAPTURE_Defer(void (*job)(void * data), void * data, Bitu size);
+/* Bytes queued but not written yet, peak returns the highest count since the last call */
+Bitu CAPTURE_WriterBacklog(Bitu * peak);
+void CAPTURE_WriterShutdown(void);
+
 #endif
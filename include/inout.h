@@ -39,6 +39,11 @@ void IO_RegisterWriteHandler(Bitu port,IO_WriteHandler * handler,Bitu mask,Bitu
 void IO_FreeReadHandler(Bitu port,Bitu mask,Bitu range=1);
 void IO_FreeWriteHandler(Bitu port,Bitu mask,Bitu range=1);
 
+/* Kinds of ports read since the cores' polling loop detection last looked */
+#define IO_POLL_VIDEO	0x1		//Video status, changes with the time in the frame
+#define IO_POLL_OTHER	0x2		//Anything that isn't known to change only in events
+extern Bitu IO_PollReads;
+
 void IO_WriteB(Bitu port,Bitu val);
 void IO_WriteW(Bitu port,Bitu val);
 void IO_WriteD(Bitu port,Bitu val);
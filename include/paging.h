@@ -27,22 +27,22 @@
 #include "mem.h"
 #endif
 
-// disable this to reduce the size of the TLB
-// NOTE: does not work with the dynamic core (dynrec is fine)
+// The dynamic core addresses the flat TLB arrays from the generated code,
+// everything else uses the much smaller two level TLB (dynrec is fine)
+#if (C_DYNAMIC_X86)
 #define USE_FULL_TLB
+#endif
 
 class PageDirectory;
 
 #define MEM_PAGE_SIZE	(4096)
 #define XMS_START		(0x110)
 
-#if defined(USE_FULL_TLB)
 #define TLB_SIZE		(1024*1024)
-#else
-#define TLB_SIZE		65536	// This must a power of 2 and greater then LINK_START
-#define BANK_SHIFT		28
-#define BANK_MASK		0xffff // always the same as TLB_SIZE-1?
-#define TLB_BANKS		((1024*1024/TLB_SIZE)-1)
+#if !defined(USE_FULL_TLB)
+#define TLB_BANK_SHIFT	10		// Every bank covers 4 MB of linear memory
+#define TLB_BANK_SIZE	(1 << TLB_BANK_SHIFT)
+#define TLB_BANKS		(TLB_SIZE/TLB_BANK_SIZE)
 #endif
 
 #define PFLAG_READABLE		0x1
@@ -165,7 +165,7 @@ struct PagingBlock {
 		Bit32u	phys_page[TLB_SIZE];
 	} tlb;
 #else
-	tlb_entry tlbh[TLB_SIZE];
+	/* Banks without mapped pages share an empty one, so lookups don't need a check */
 	tlb_entry *tlbh_banks[TLB_BANKS];
 #endif
 	struct {
@@ -220,17 +220,8 @@ static INLINE PhysPt PAGING_GetPhysicalAddress(PhysPt linAddr) {
 
 #else
 
-void PAGING_InitTLBBank(tlb_entry **bank);
-
 static INLINE tlb_entry *get_tlb_entry(PhysPt address) {
-	Bitu index=(address>>12);
-	if (TLB_BANKS && (index >= TLB_SIZE)) {
-		Bitu bank=(address>>BANK_SHIFT) - 1;
-		if (!paging.tlbh_banks[bank])
-			PAGING_InitTLBBank(&paging.tlbh_banks[bank]);
-		return &paging.tlbh_banks[bank][index & BANK_MASK];
-	}
-	return &paging.tlbh[index];
+	return &paging.tlbh_banks[address>>(12+TLB_BANK_SHIFT)][(address>>12) & (TLB_BANK_SIZE-1)];
 }
 
 static INLINE HostPt get_tlb_read(PhysPt address) {
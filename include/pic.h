@@ -31,6 +31,8 @@ typedef void (* PIC_EventHandler)(Bitu val);
 
 extern Bitu PIC_IRQCheck;
 extern Bitu PIC_Ticks;
+/* The queue returns at the end of each of this many slices of a tick */
+extern Bitu PIC_Slices;
 
 static INLINE float PIC_TickIndex(void) {
 	return (CPU_CycleMax-CPU_CycleLeft-CPU_Cycles)/(float)CPU_CycleMax;
@@ -60,4 +62,9 @@ void PIC_RemoveEvents(PIC_EventHandler handler);
 void PIC_RemoveSpecificEvents(PIC_EventHandler handler, Bitu val);
 
 void PIC_SetIRQMask(Bitu irq, bool masked);
+
+Bitu PIC_IdleTicks(Bitu limit);
+
+/* Events per millisecond through the event queue or the old sorted list */
+Bitu PIC_BenchmarkQueue(bool list,Bitu pending,Bitu ms);
 #endif
@@ -78,6 +78,7 @@ typedef struct {
 		Bit8u *outWrite;
 		Bitu cachePitch;
 		Bit8u *cacheRead;
+		Bit8u *srcChanged;
 		Bitu inHeight, inLine, outLine;
 	} scale;
 	RenderPal_t pal;
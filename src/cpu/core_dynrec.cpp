@@ -57,6 +57,10 @@
 #define CACHE_PAGES		(512)
 #define CACHE_BLOCKS	(128*1024)
 #define CACHE_ALIGN		(16)
+#define CACHE_REGIONS	(32)
+#define CACHE_CANDIDATES	(4)
+#define CACHE_EVICTED	(16*1024)
+#define CACHE_RELOCS	(1024)
 #define DYN_HASH_SHIFT	(4)
 #define DYN_PAGE_HASH	(4096>>DYN_HASH_SHIFT)
 #define DYN_LINKS		(16)
@@ -225,10 +229,16 @@ Bits CPU_Core_Dynrec_Run(void) {
 		}
 
 run_block:
+		// the runs that the cache replacement goes by are counted here and
+		// not by the block code, so a block started from here counts and
+		// so does the block that returns, which catches the hot ones among
+		// the linked blocks whenever the cycles run out
+		block->cache.runs++;
 		cache.block.running=0;
 		// now we're ready to run the dynamic code block
 //		BlockReturn ret=((BlockReturn (*)(void))(block->cache.start))();
 		BlockReturn ret=core_dynrec.runcode(block->cache.start);
+		if (cache.block.running) cache.block.running->cache.runs++;
 
 		switch (ret) {
 		case BR_Iret:
@@ -326,12 +336,20 @@ Bits CPU_Core_Dynrec_Trap_Run(void) {
 void CPU_Core_Dynrec_Init(void) {
 }
 
+void CPU_Core_Dynrec_Cache_Setup(Bitu cache_size,Bitu cache_max,bool persistent) {
+	// sizes in MB, the cache grows from cache_size up to cache_max
+	cache_setup(cache_size*1024*1024,cache_max*1024*1024);
+	persist_setup(persistent);
+}
+
 void CPU_Core_Dynrec_Cache_Init(bool enable_cache) {
 	// Initialize code cache and dynamic blocks
 	cache_init(enable_cache);
+	if (enable_cache) persist_init();
 }
 
 void CPU_Core_Dynrec_Cache_Close(void) {
+	persist_close();
 	cache_close();
 }
 
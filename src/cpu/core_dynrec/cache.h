@@ -44,6 +44,7 @@ public:
 		Bit8u * wmapmask;
 		Bit16u maskstart;
 		Bit16u masklen;
+		Bit32u runs;			// sampled runs, see CPU_Core_Dynrec_Run
 	} cache;
 	struct {
 		Bitu index;
@@ -68,8 +69,32 @@ static struct {
 	CodePageHandlerDynRec * free_pages;		// pointer to the free list
 	CodePageHandlerDynRec * used_pages;		// pointer to the list of used pages
 	CodePageHandlerDynRec * last_page;		// the last used page
+	Bitu size;			// code memory in all regions
+	Bitu max_size;		// the cache may grow up to this size
+	struct {
+		Bitu translations;		// blocks translated
+		Bitu retranslations;	// blocks translated again after they were evicted
+		Bitu evictions;			// blocks cleared to make room for new ones
+		Bitu skips;				// recently run blocks that were kept
+		Bitu loaded;			// blocks taken from the persistent cache
+	} stats;
 } cache;
 
+// the code cache grows by adding regions of contiguous memory,
+// the blocks of all regions are chained into one list
+static struct {
+	Bit8u * alloc;				// as returned by the allocator
+	Bit8u * start;				// page aligned start of the code
+	Bitu size;
+	CacheBlockDynRec * first;	// the block at the start of the region
+} cache_regions[CACHE_REGIONS];
+static Bitu cache_region_count=0;
+static Bitu cache_initial_size=CACHE_TOTAL;
+
+// physical addresses (+1) of evicted blocks, to notice when they get translated again
+static Bit32u cache_evicted[CACHE_EVICTED];
+#define CACHE_EVICTED_INDEX(addr) (((addr)^((addr)>>14))&(CACHE_EVICTED-1))
+
 
 // cache memory pointers, to be malloc'd later
 static Bit8u * cache_code_start_ptr=NULL;
@@ -362,6 +387,10 @@ public:
 		Release();	// now can release this page
 	}
 
+	Bitu GetPhysPage(void) const {
+		return phys_page;
+	}
+
 	CacheBlockDynRec * FindCacheBlock(Bitu start) {
 		CacheBlockDynRec * block=hash_map[1+(start>>DYN_HASH_SHIFT)];
 		// see if there's a cache block present at the start address
@@ -403,10 +432,24 @@ static INLINE void cache_addunusedblock(CacheBlockDynRec * block) {
 	cache.block.free=block;
 }
 
+static void cache_addblocks(void) {
+	// blocks are never moved or freed, the translated code points to them
+	CacheBlockDynRec * blocks=(CacheBlockDynRec*)malloc(CACHE_BLOCKS*sizeof(CacheBlockDynRec));
+	if(!blocks) E_Exit("Allocating cache_blocks has failed");
+	memset(blocks,0,sizeof(CacheBlockDynRec)*CACHE_BLOCKS);
+	for (Bitu i=0;i<CACHE_BLOCKS;i++) {
+		blocks[i].link[0].to=(CacheBlockDynRec *)1;
+		blocks[i].link[1].to=(CacheBlockDynRec *)1;
+		blocks[i].cache.next=(i<CACHE_BLOCKS-1) ? &blocks[i+1] : cache.block.free;
+	}
+	cache.block.free=&blocks[0];
+	if (!cache_blocks) cache_blocks=blocks;
+}
+
 static CacheBlockDynRec * cache_getblock(void) {
 	// get a free cache block and advance the free pointer
+	if (!cache.block.free) cache_addblocks();
 	CacheBlockDynRec * ret=cache.block.free;
-	if (!ret) E_Exit("Ran out of CacheBlocks" );
 	cache.block.free=ret->cache.next;
 	ret->cache.next=0;
 	return ret;
@@ -459,22 +502,183 @@ void CacheBlockDynRec::Clear(void) {
 }
 
 
-static CacheBlockDynRec * cache_openblock(void) {
+/* Define temporary pagesize so the MPROTECT case and the regular case share as much code as possible */
+#if (C_HAVE_MPROTECT)
+#define PAGESIZE_TEMP PAGESIZE
+#else 
+#define PAGESIZE_TEMP 4096
+#endif
+
+// add a region of code memory to the end of the block list,
+// the first region also holds the link blocks
+static bool cache_addregion(Bitu size) {
+	if (cache_region_count>=CACHE_REGIONS) return false;
+	Bitu extra=cache_region_count ? 0 : PAGESIZE_TEMP;
+	Bitu alloc_size=size+CACHE_MAXSIZE+PAGESIZE_TEMP-1+extra;
+	Bit8u * alloc;
+#if defined (WIN32)
+	alloc=(Bit8u*)VirtualAlloc(0,alloc_size,MEM_COMMIT,PAGE_EXECUTE_READWRITE);
+	if (!alloc) alloc=(Bit8u*)malloc(alloc_size);
+#else
+	alloc=(Bit8u*)malloc(alloc_size);
+#endif
+	if (!alloc) return false;
+
+	// align the region at a page boundary
+	Bit8u * start=(Bit8u*)(((Bitu)alloc + PAGESIZE_TEMP-1) & ~(PAGESIZE_TEMP-1));//Bitu is same size as a pointer.
+#if (C_HAVE_MPROTECT)
+	if(mprotect(start,size+CACHE_MAXSIZE+extra,PROT_WRITE|PROT_READ|PROT_EXEC))
+		LOG_MSG("Setting execute permission on the code cache has failed");
+#endif
+	if (extra) {
+		cache_code_start_ptr=alloc;
+		cache_code_link_blocks=start;
+		start+=extra;
+		cache_code=start;
+	}
+
+	CacheBlockDynRec * block=cache_getblock();
+	block->cache.start=start;
+	block->cache.size=size;
+	block->cache.next=0;						// last block in the list
+	if (cache_region_count) {
+		CacheBlockDynRec * last=cache_regions[cache_region_count-1].first;
+		while (last->cache.next) last=last->cache.next;
+		last->cache.next=block;
+	} else {
+		cache.block.first=block;
+	}
+	cache_regions[cache_region_count].alloc=alloc;
+	cache_regions[cache_region_count].start=start;
+	cache_regions[cache_region_count].size=size;
+	cache_regions[cache_region_count].first=block;
+	cache_region_count++;
+	cache.size+=size;
+	return true;
+}
+
+// the next block continues this one in the same region
+static INLINE bool cache_contiguous(CacheBlockDynRec * block) {
+	return block->cache.next && (block->cache.next->cache.start==block->cache.start+block->cache.size);
+}
+
+static Bitu cache_regionof(CacheBlockDynRec * block) {
+	for (Bitu i=0;i<cache_region_count;i++) {
+		if (block->cache.start>=cache_regions[i].start &&
+			block->cache.start<cache_regions[i].start+cache_regions[i].size) return i;
+	}
+	return 0;
+}
+
+// the block to open after this one, at the end of the list
+// the cache grows while it is below the limit, otherwise it starts over;
+// without grow it returns 0 instead of growing the cache
+static CacheBlockDynRec * cache_advance(CacheBlockDynRec * block,bool grow) {
+	CacheBlockDynRec * next=block->cache.next;
+	if (next && cache_contiguous(block)) {
+		Bitu r=cache_regionof(block);
+		if (next->cache.start<=cache_regions[r].start+cache_regions[r].size-CACHE_MAXSIZE) return next;
+		// not enough room for a full block before the end of the region
+		next=(r+1<cache_region_count) ? cache_regions[r+1].first : 0;
+	}
+	if (next) return next;
+	if (cache.size<cache.max_size) {
+		if (!grow) return 0;
+		Bitu size=cache.size;
+		if (size>cache.max_size-cache.size) size=cache.max_size-cache.size;
+		size&=~(PAGESIZE_TEMP-1);
+		if (size>=CACHE_MAXSIZE*2 && cache_addregion(size)) {
+			LOG_MSG("Dynamic core cache grown to %d KB",(int)(cache.size/1024));
+			return cache_regions[cache_region_count-1].first;
+		}
+		LOG_MSG("Dynamic core cache can't grow beyond %d KB",(int)(cache.size/1024));
+		cache.max_size=cache.size;
+	}
+//	LOG_MSG("Cache full restarting");
+	return cache.block.first;
+}
+
+// how often the blocks in the space a new block would take from this block
+// on ran again since they were translated or since the allocator passed them
+static Bitu cache_heat(CacheBlockDynRec * block,CacheBlockDynRec * & last) {
+	Bitu heat=0;
+	Bitu size=0;
+	for (;;) {
+		// the run right after the translation doesn't count
+		if (block->page.handler && block->cache.runs>1) heat+=block->cache.runs-1;
+		size+=block->cache.size;
+		if (size>=CACHE_MAXSIZE || !cache_contiguous(block)) break;
+		block=block->cache.next;
+	}
+	last=block;
+	return heat;
+}
+
+// choose the coldest of the next few places for a new block, the blocks
+// that get passed over have to run again to be kept the next time around
+static CacheBlockDynRec * cache_pickblock(void) {
 	CacheBlockDynRec * block=cache.block.active;
+	CacheBlockDynRec * best=block;
+	CacheBlockDynRec * last;
+	Bitu best_heat=cache_heat(block,last);
+	// only move on when the blocks in the way are clearly hotter
+	Bitu limit=best_heat/4;
+	for (Bitu i=1;i<CACHE_CANDIDATES && limit;i++) {
+		// the cache only grows when a block really gets there
+		block=cache_advance(last,false);
+		if (!block) break;
+		Bitu heat=cache_heat(block,last);
+		if (heat<limit && heat<best_heat) {
+			best=block;
+			best_heat=heat;
+			if (!heat) break;
+		}
+	}
+	for (block=cache.block.active;block!=best;block=block->cache.next) {
+		if (!block) block=cache.block.first;
+		if (block==best) break;
+		if (block->cache.runs>1) {
+			block->cache.runs=1;
+			cache.stats.skips++;
+		}
+	}
+	return best;
+}
+
+static void cache_evict(CacheBlockDynRec * block) {
+	Bit32u addr=(Bit32u)((block->page.handler->GetPhysPage()<<12)+block->page.start);
+	cache_evicted[CACHE_EVICTED_INDEX(addr)]=addr+1;
+	cache.stats.evictions++;
+	block->Clear();
+}
+
+// count a translation of the code at this physical address
+static void cache_addtranslation(Bit32u addr) {
+	cache.stats.translations++;
+	if (cache_evicted[CACHE_EVICTED_INDEX(addr)]==addr+1) {
+		cache_evicted[CACHE_EVICTED_INDEX(addr)]=0;
+		cache.stats.retranslations++;
+	}
+}
+
+static CacheBlockDynRec * cache_openblock(void) {
+	CacheBlockDynRec * block=cache_pickblock();
+	cache.block.active=block;
 	// check for enough space in this block
 	Bitu size=block->cache.size;
 	CacheBlockDynRec * nextblock=block->cache.next;
 	if (block->page.handler) 
-		block->Clear();
+		cache_evict(block);
 	// block size must be at least CACHE_MAXSIZE
 	while (size<CACHE_MAXSIZE) {
-		if (!nextblock)
+		// the end of a region has CACHE_MAXSIZE to spare
+		if (!nextblock || nextblock->cache.start!=block->cache.start+size)
 			goto skipresize;
 		// merge blocks
 		size+=nextblock->cache.size;
 		CacheBlockDynRec * tempblock=nextblock->cache.next;
 		if (nextblock->page.handler) 
-			nextblock->Clear();
+			cache_evict(nextblock);
 		// block is free now
 		cache_addunusedblock(nextblock);
 		nextblock=tempblock;
@@ -483,6 +687,7 @@ skipresize:
 	// adjust parameters and open this block
 	block->cache.size=size;
 	block->cache.next=nextblock;
+	block->cache.runs=0;
 	cache.pos=block->cache.start;
 	return block;
 }
@@ -499,7 +704,7 @@ static void cache_closeblock(void) {
 	// close the block with correct alignment
 	Bitu written=(Bitu)(cache.pos-block->cache.start);
 	if (written>block->cache.size) {
-		if (!block->cache.next) {
+		if (!cache_contiguous(block)) {
 			if (written>block->cache.size+CACHE_MAXSIZE) E_Exit("CacheBlock overrun 1 %d",written-block->cache.size);	
 		} else E_Exit("CacheBlock overrun 2 written %d size %d",written,block->cache.size);	
 	} else {
@@ -518,12 +723,7 @@ static void cache_closeblock(void) {
 		}
 	}
 	// advance the active block pointer
-	if (!block->cache.next || (block->cache.next->cache.start>(cache_code_start_ptr + CACHE_TOTAL - CACHE_MAXSIZE))) {
-//		LOG_MSG("Cache full restarting");
-		cache.block.active=cache.block.first;
-	} else {
-		cache.block.active=block->cache.next;
-	}
+	cache.block.active=cache_advance(block,true);
 }
 
 
@@ -551,19 +751,61 @@ static INLINE void cache_addq(Bit64u val) {
 }
 
 
+// host addresses the backend placed into the code of the current block,
+// kept so the block can be relocated when it is stored and loaded again
+enum RelocTypes {
+	RELOC_ABS64,		// 64bit absolute address
+	RELOC_ABS32,		// 32bit absolute address, zero extended
+	RELOC_REL32			// 32bit displacement, relative to the field end plus extra
+};
+
+static struct {
+	struct {
+		Bit8u * pos;
+		Bit8u type;
+		Bit8u extra;
+	} list[CACHE_RELOCS];
+	Bitu used;
+	bool overflow;
+	Bitu written;		// size of the code when the block was closed
+} cache_relocs;
+
+// the address field at pos has just been written
+static INLINE void cache_addreloc(Bit8u * pos,RelocTypes type,Bitu extra=0) {
+	if (GCC_UNLIKELY(cache_relocs.used>=CACHE_RELOCS)) {
+		cache_relocs.overflow=true;
+		return;
+	}
+	cache_relocs.list[cache_relocs.used].pos=pos;
+	cache_relocs.list[cache_relocs.used].type=(Bit8u)type;
+	cache_relocs.list[cache_relocs.used].extra=(Bit8u)extra;
+	cache_relocs.used++;
+}
+
+// the address field at pos has been replaced by code
+static void cache_delreloc(Bit8u * pos) {
+	for (Bitu i=0;i<cache_relocs.used;i++) {
+		if (cache_relocs.list[i].pos!=pos) continue;
+		cache_relocs.list[i]=cache_relocs.list[--cache_relocs.used];
+		return;
+	}
+}
+
+
 static void dyn_return(BlockReturn retcode,bool ret_exception);
 static void dyn_run_code(void);
 
 
-/* Define temporary pagesize so the MPROTECT case and the regular case share as much code as possible */
-#if (C_HAVE_MPROTECT)
-#define PAGESIZE_TEMP PAGESIZE
-#else 
-#define PAGESIZE_TEMP 4096
-#endif
-
 static bool cache_initialized = false;
 
+static void cache_setup(Bitu size,Bitu max_size) {
+	// the initial size only applies before the cache is allocated
+	size&=~(PAGESIZE_TEMP-1);
+	if (size<CACHE_MAXSIZE*2) size=CACHE_MAXSIZE*2;
+	if (!cache_initialized) cache_initial_size=size;
+	cache.max_size=(max_size>cache_initial_size) ? max_size : cache_initial_size;
+}
+
 static void cache_init(bool enable) {
 	Bits i;
 	if (enable) {
@@ -572,45 +814,12 @@ static void cache_init(bool enable) {
 		cache_initialized = true;
 		if (cache_blocks == NULL) {
 			// allocate the cache blocks memory
-			cache_blocks=(CacheBlockDynRec*)malloc(CACHE_BLOCKS*sizeof(CacheBlockDynRec));
-			if(!cache_blocks) E_Exit("Allocating cache_blocks has failed");
-			memset(cache_blocks,0,sizeof(CacheBlockDynRec)*CACHE_BLOCKS);
-			cache.block.free=&cache_blocks[0];
-			// initialize the cache blocks
-			for (i=0;i<CACHE_BLOCKS-1;i++) {
-				cache_blocks[i].link[0].to=(CacheBlockDynRec *)1;
-				cache_blocks[i].link[1].to=(CacheBlockDynRec *)1;
-				cache_blocks[i].cache.next=&cache_blocks[i+1];
-			}
+			cache_addblocks();
 		}
 		if (cache_code_start_ptr==NULL) {
 			// allocate the code cache memory
-#if defined (WIN32)
-			cache_code_start_ptr=(Bit8u*)VirtualAlloc(0,CACHE_TOTAL+CACHE_MAXSIZE+PAGESIZE_TEMP-1+PAGESIZE_TEMP,
-				MEM_COMMIT,PAGE_EXECUTE_READWRITE);
-			if (!cache_code_start_ptr)
-				cache_code_start_ptr=(Bit8u*)malloc(CACHE_TOTAL+CACHE_MAXSIZE+PAGESIZE_TEMP-1+PAGESIZE_TEMP);
-#else
-			cache_code_start_ptr=(Bit8u*)malloc(CACHE_TOTAL+CACHE_MAXSIZE+PAGESIZE_TEMP-1+PAGESIZE_TEMP);
-#endif
-			if(!cache_code_start_ptr) E_Exit("Allocating dynamic cache failed");
-
-			// align the cache at a page boundary
-			cache_code=(Bit8u*)(((Bitu)cache_code_start_ptr + PAGESIZE_TEMP-1) & ~(PAGESIZE_TEMP-1));//Bitu is same size as a pointer.
-
-			cache_code_link_blocks=cache_code;
-			cache_code=cache_code+PAGESIZE_TEMP;
-
-#if (C_HAVE_MPROTECT)
-			if(mprotect(cache_code_link_blocks,CACHE_TOTAL+CACHE_MAXSIZE+PAGESIZE_TEMP,PROT_WRITE|PROT_READ|PROT_EXEC))
-				LOG_MSG("Setting execute permission on the code cache has failed");
-#endif
-			CacheBlockDynRec * block=cache_getblock();
-			cache.block.first=block;
-			cache.block.active=block;
-			block->cache.start=&cache_code[0];
-			block->cache.size=CACHE_TOTAL;
-			block->cache.next=0;						// last block in the list
+			if (!cache_addregion(cache_initial_size)) E_Exit("Allocating dynamic cache failed");
+			cache.block.active=cache.block.first;
 		}
 		// setup the default blocks for block linkage returns
 		cache.pos=&cache_code_link_blocks[0];
@@ -640,6 +849,11 @@ static void cache_init(bool enable) {
 }
 
 static void cache_close(void) {
+	if (cache_initialized && (cache.stats.translations || cache.stats.loaded)) {
+		LOG_MSG("Dynamic core: %d KB cache, %d translations, %d evictions, %d retranslations, %d blocks kept, %d blocks loaded",
+			(int)(cache.size/1024),(int)cache.stats.translations,(int)cache.stats.evictions,
+			(int)cache.stats.retranslations,(int)cache.stats.skips,(int)cache.stats.loaded);
+	}
 /*	for (;;) {
 		if (cache.used_pages) {
 			CodePageHandler * cpage=cache.used_pages;
@@ -23,6 +23,7 @@
 #include "decoder_opcodes.h"
 
 #include "dyn_fpu.h"
+#include "persist.h"
 
 /*
 	The function CreateCacheBlock translates the instruction stream
@@ -41,10 +42,17 @@ static CacheBlockDynRec * CreateCacheBlock(CodePageHandlerDynRec * codepage,Phys
 	decode.page.invmap=codepage->invalidation_map;
 	decode.page.first=start >> 12;
 	decode.active_block=decode.block=cache_openblock();
+#ifdef DRC_PERSISTENT_CACHE
+	// the block may have been translated in an earlier session
+	if (persist_loadblock(codepage,start,decode.block)) return decode.block;
+	persist_startblock();
+#endif
 	decode.block->page.start=(Bit16u)decode.page.index;
 	codepage->AddCacheBlock(decode.block);
+	cache_addtranslation((Bit32u)((codepage->GetPhysPage()<<12)+decode.page.index));
 
 	InitFlagsOptimization();
+	dyn_flags_analyze(max_opcodes);
 
 	// every codeblock that is run sets cache.block.running to itself
 	// so the block linking knows the last executed block
@@ -266,10 +274,12 @@ restart_prefix:
 			break;
 
 		case 0x60:
+			gen_release_regs(0xff);
 			if (decode.big_op) gen_call_function_raw((void *)&dynrec_pusha_dword);
 			else gen_call_function_raw((void *)&dynrec_pusha_word);
 			break;
 		case 0x61:
+			gen_release_regs(0xff);
 			if (decode.big_op) gen_call_function_raw((void *)&dynrec_popa_dword);
 			else gen_call_function_raw((void *)&dynrec_popa_word);
 			break;
@@ -585,6 +595,7 @@ restart_prefix:
 #endif
 			goto illegalopcode;
 		}
+		dyn_flags_check();
 	}
 	// link to next block because the maximum number of opcodes has been reached
 	dyn_set_eip_end();
@@ -610,6 +621,9 @@ finish_block:
 	decode.page.index--;
 	decode.active_block->page.end=(Bit16u)decode.page.index;
 //	LOG_MSG("Created block size %d start %d end %d",decode.block->cache.size,decode.block->page.start,decode.block->page.end);
+#ifdef DRC_PERSISTENT_CACHE
+	persist_addblock(codepage);
+#endif
 
 	return decode.block;
 }
@@ -667,6 +667,9 @@ static void dyn_closeblock(void) {
 	//Shouldn't create empty block normally but let's do it like this
 	dyn_fill_blocks();
 	cache_block_before_close();
+#ifdef DRC_PERSISTENT_CACHE
+	cache_relocs.written=(Bitu)(cache.pos-decode.block->cache.start);
+#endif
 	cache_closeblock();
 	cache_block_closing(decode.block->cache.start,decode.block->cache.size);
 }
@@ -1176,6 +1179,15 @@ static void gen_restore_addr_reg(void) {
 #endif
 }
 
+#ifndef DRC_USE_REGS_CACHE
+// write back the guest registers in mask that are kept in host registers,
+// needed before helpers that work on them in cpu_regs directly
+static void INLINE gen_release_regs(Bitu mask) { }
+// write back all modified guest registers, needed before code positions
+// that get patched later
+static void INLINE gen_regcache_sync(void) { }
+#endif
+
 // save back an arbitrary register
 static void gen_protect_reg(HostReg reg) {
 	gen_mov_word_from_reg(reg,&core_dynrec.protected_regs[reg],true);
@@ -1225,6 +1237,8 @@ static void InvalidateFlags(void) {
 // the flags are not required before
 static void InvalidateFlags(void* current_simple_function,Bitu flags_type) {
 #ifdef DRC_FLAGS_INVALIDATION
+	// the raw call that follows must start right at the recorded position
+	gen_regcache_sync();
 	for (Bitu ct=0; ct<mf_functions_num; ct++) {
 		gen_fill_function_ptr(mf_functions[ct].pos,mf_functions[ct].fct_ptr,mf_functions[ct].ftype);
 	}
@@ -1240,6 +1254,7 @@ static void InvalidateFlags(void* current_simple_function,Bitu flags_type) {
 // this function can be replaced by a simpler one as well
 static void InvalidateFlagsPartially(void* current_simple_function,Bitu flags_type) {
 #ifdef DRC_FLAGS_INVALIDATION
+	gen_regcache_sync();
 	mf_functions[mf_functions_num].pos=cache.pos;
 	mf_functions[mf_functions_num].fct_ptr=current_simple_function;
 	mf_functions[mf_functions_num].ftype=flags_type;
@@ -1265,3 +1280,288 @@ static void AcquireFlags(Bitu flags_mask) {
 	mf_functions_num=0;
 #endif
 }
+
+
+
+// flag liveness analysis
+// before a block is translated its instructions are scanned once to find
+// out after which of them none of the condition flags are read anymore
+// before being overwritten again; there the queued flag generating functions
+// can be replaced by their simpler variants even if the following
+// instructions only set part of the flags (like inc/dec)
+
+#define FLAGS_SCAN_MAX 64
+
+static struct {
+	PhysPt code;		// next byte to scan
+	Bitu index;			// index of the next byte in the active page
+	Bitu count;			// number of scanned instructions
+	Bitu current;		// index of the instruction that is translated
+	bool dead[FLAGS_SCAN_MAX];	// no flags are live after the instruction
+} flags_scan;
+
+static bool flags_scan_fetchb(Bit8u & val) {
+	if (flags_scan.index>=4096) return false;
+	// don't look at code that is known to be modified a lot
+	if (decode.page.invmap && (decode.page.invmap[flags_scan.index]>=4)) return false;
+	val=mem_readb(flags_scan.code);
+	flags_scan.code++;
+	flags_scan.index++;
+	return true;
+}
+
+static bool flags_scan_skip(Bitu bytes) {
+	Bit8u val;
+	while (bytes--) {
+		if (!flags_scan_fetchb(val)) return false;
+	}
+	return true;
+}
+
+static bool flags_scan_modrm(bool big_addr,Bitu & mod,Bitu & reg) {
+	Bit8u modrm;
+	if (!flags_scan_fetchb(modrm)) return false;
+	mod=modrm>>6;
+	reg=(modrm>>3)&7;
+	Bitu rm=modrm&7;
+	if (mod==3) return true;
+	if (big_addr) {
+		if (rm==4) {
+			Bit8u sib;
+			if (!flags_scan_fetchb(sib)) return false;
+			if ((mod==0) && ((sib&7)==5)) return flags_scan_skip(4);
+		} else if ((mod==0) && (rm==5)) return flags_scan_skip(4);
+		if (mod==1) return flags_scan_skip(1);
+		if (mod==2) return flags_scan_skip(4);
+	} else {
+		if ((mod==0) && (rm==6)) return flags_scan_skip(2);
+		if (mod==1) return flags_scan_skip(1);
+		if (mod==2) return flags_scan_skip(2);
+	}
+	return true;
+}
+
+// determine the condition flags the next instruction reads and the ones it
+// always overwrites; returns false if the translation may stop at this
+// instruction or it is not known, the flags have to be correct then
+static bool flags_scan_instruction(Bitu & use,Bitu & def) {
+	bool big_op=cpu.code.big;
+	bool big_addr=cpu.code.big;
+	bool rep=false;
+	Bitu mod,reg;
+	Bit8u opcode,imm;
+	use=0;
+	def=0;
+restart_prefix:
+	if (!flags_scan_fetchb(opcode)) return false;
+	if ((opcode<0x40) && ((opcode&7)<6)) {
+		// add/or/adc/sbb/and/sub/xor/cmp
+		Bitu op=(opcode>>3)&7;
+		if ((op==2) || (op==3)) use=FLAG_CF;
+		def=FMASK_TEST;
+		switch (opcode&7) {
+			case 4:return flags_scan_skip(1);
+			case 5:return flags_scan_skip(big_op ? 4 : 2);
+			default:return flags_scan_modrm(big_addr,mod,reg);
+		}
+	}
+	switch (opcode) {
+		case 0x26:case 0x2e:case 0x36:case 0x3e:case 0x64:case 0x65:
+			goto restart_prefix;
+		case 0x66:big_op=!cpu.code.big;goto restart_prefix;
+		case 0x67:big_addr=!cpu.code.big;goto restart_prefix;
+		case 0xf2:case 0xf3:rep=true;goto restart_prefix;
+
+		case 0x06:case 0x0e:case 0x16:case 0x1e:	// push seg
+		case 0x07:case 0x17:case 0x1f:				// pop seg
+		case 0x50:case 0x51:case 0x52:case 0x53:case 0x54:case 0x55:case 0x56:case 0x57:
+		case 0x58:case 0x59:case 0x5a:case 0x5b:case 0x5c:case 0x5d:case 0x5e:case 0x5f:
+		case 0x60:case 0x61:						// pusha/popa
+		case 0x90:case 0x9b:case 0xf0:				// nop/wait/lock
+		case 0x91:case 0x92:case 0x93:case 0x94:case 0x95:case 0x96:case 0x97:
+		case 0x98:case 0x99:						// cbw/cwd
+		case 0xc9:									// leave
+		case 0xec:case 0xed:case 0xee:case 0xef:	// in/out dx
+		case 0xfa:case 0xfb:case 0xfc:case 0xfd:	// cli/sti/cld/std
+			return true;
+
+		case 0x40:case 0x41:case 0x42:case 0x43:case 0x44:case 0x45:case 0x46:case 0x47:
+		case 0x48:case 0x49:case 0x4a:case 0x4b:case 0x4c:case 0x4d:case 0x4e:case 0x4f:
+			// inc/dec keep the carry flag
+			def=FMASK_TEST & ~FLAG_CF;
+			return true;
+
+		case 0x68:return flags_scan_skip(big_op ? 4 : 2);
+		case 0x6a:return flags_scan_skip(1);
+
+		case 0x69:
+			def=FLAG_CF|FLAG_OF;
+			return flags_scan_modrm(big_addr,mod,reg) && flags_scan_skip(big_op ? 4 : 2);
+		case 0x6b:
+			def=FLAG_CF|FLAG_OF;
+			return flags_scan_modrm(big_addr,mod,reg) && flags_scan_skip(1);
+
+		case 0x80:case 0x81:case 0x82:case 0x83:
+			if (!flags_scan_modrm(big_addr,mod,reg)) return false;
+			if ((reg==2) || (reg==3)) use=FLAG_CF;
+			def=FMASK_TEST;
+			return flags_scan_skip((opcode==0x81) ? (big_op ? 4 : 2) : 1);
+
+		case 0x84:case 0x85:
+			def=FMASK_TEST;
+			return flags_scan_modrm(big_addr,mod,reg);
+
+		case 0x86:case 0x87:case 0x88:case 0x89:case 0x8a:case 0x8b:
+		case 0x8c:case 0x8d:case 0x8f:
+			return flags_scan_modrm(big_addr,mod,reg);
+		case 0x8e:
+			return flags_scan_modrm(big_addr,mod,reg) && (reg!=1);
+
+		case 0x9c:	// pushf
+			use=FMASK_TEST;
+			return true;
+		case 0x9d:	// popf
+			def=FMASK_TEST;
+			return true;
+		case 0x9e:	// sahf
+			def=FMASK_TEST & ~FLAG_OF;
+			return true;
+
+		case 0xa0:case 0xa1:case 0xa2:case 0xa3:
+			return flags_scan_skip(big_addr ? 4 : 2);
+
+		case 0xa4:case 0xa5:case 0xaa:case 0xab:case 0xac:case 0xad:
+			// repeated string instructions can leave the block in-between
+			if (rep) use=FMASK_TEST;
+			return true;
+
+		case 0xa8:
+			def=FMASK_TEST;
+			return flags_scan_skip(1);
+		case 0xa9:
+			def=FMASK_TEST;
+			return flags_scan_skip(big_op ? 4 : 2);
+
+		case 0xb0:case 0xb1:case 0xb2:case 0xb3:case 0xb4:case 0xb5:case 0xb6:case 0xb7:
+			return flags_scan_skip(1);
+		case 0xb8:case 0xb9:case 0xba:case 0xbb:case 0xbc:case 0xbd:case 0xbe:case 0xbf:
+			return flags_scan_skip(big_op ? 4 : 2);
+
+		case 0xc0:case 0xc1:case 0xd0:case 0xd1:case 0xd2:case 0xd3:
+			if (!flags_scan_modrm(big_addr,mod,reg)) return false;
+			if ((reg==2) || (reg==3)) use=FLAG_CF;
+			if (opcode>=0xd2) return true;	// shift count in cl might be zero
+			if (opcode<=0xc1) {
+				if (!flags_scan_fetchb(imm)) return false;
+			} else imm=1;
+			if (!(imm&0x1f)) return true;
+			if (reg<2) def=FLAG_CF|FLAG_OF;
+			else if (reg>3) def=FMASK_TEST;
+			return true;
+
+		case 0xc4:case 0xc5:
+			return flags_scan_modrm(big_addr,mod,reg) && (mod!=3);
+		case 0xc6:
+			return flags_scan_modrm(big_addr,mod,reg) && flags_scan_skip(1);
+		case 0xc7:
+			return flags_scan_modrm(big_addr,mod,reg) && flags_scan_skip(big_op ? 4 : 2);
+		case 0xc8:
+			return flags_scan_skip(3);
+
+#ifdef CPU_FPU
+		case 0xd8:case 0xd9:case 0xda:case 0xdb:case 0xdc:case 0xdd:case 0xde:case 0xdf:
+			return flags_scan_modrm(big_addr,mod,reg);
+#endif
+
+		case 0xe4:case 0xe5:case 0xe6:case 0xe7:
+			return flags_scan_skip(1);
+
+		case 0xf5:	// cmc
+			use=FLAG_CF;
+			def=FLAG_CF;
+			return true;
+		case 0xf8:case 0xf9:	// clc/stc
+			def=FLAG_CF;
+			return true;
+
+		case 0xf6:case 0xf7:
+			if (!flags_scan_modrm(big_addr,mod,reg)) return false;
+			switch (reg) {
+				case 0:		// test
+					def=FMASK_TEST;
+					return flags_scan_skip((opcode==0xf7) ? (big_op ? 4 : 2) : 1);
+				case 1:
+					return false;
+				case 3:		// neg
+					def=FMASK_TEST;
+					return true;
+				case 4:case 5:	// mul/imul
+					def=FLAG_CF|FLAG_OF;
+					return true;
+			}
+			return true;
+
+		case 0xfe:case 0xff:
+			if (!flags_scan_modrm(big_addr,mod,reg)) return false;
+			if (reg<2) {
+				def=FMASK_TEST & ~FLAG_CF;
+				return true;
+			}
+			// push ev
+			return (opcode==0xff) && (reg==6);
+
+		case 0x0f:
+			if (!flags_scan_fetchb(opcode)) return false;
+			switch (opcode) {
+				case 0xa0:case 0xa1:case 0xa8:case 0xa9:	// push/pop fs/gs
+					return true;
+				case 0xa4:case 0xac:	// shld/shrd, a zero count keeps the flags
+					return flags_scan_modrm(big_addr,mod,reg) && flags_scan_skip(1);
+				case 0xa5:case 0xad:
+					return flags_scan_modrm(big_addr,mod,reg);
+				case 0xaf:
+					def=FLAG_CF|FLAG_OF;
+					return flags_scan_modrm(big_addr,mod,reg);
+				case 0xb4:case 0xb5:
+					return flags_scan_modrm(big_addr,mod,reg) && (mod!=3);
+				case 0xb6:case 0xb7:case 0xbe:case 0xbf:
+					return flags_scan_modrm(big_addr,mod,reg);
+			}
+			return false;
+	}
+	// jumps, calls, interrupts and everything that is not translated
+	return false;
+}
+
+// scan the instructions the block will be translated from
+static void dyn_flags_analyze(Bitu max_opcodes) {
+	flags_scan.code=decode.code;
+	flags_scan.index=decode.page.index;
+	flags_scan.count=0;
+	flags_scan.current=0;
+#ifdef DRC_FLAGS_INVALIDATION
+	Bitu use[FLAGS_SCAN_MAX],def[FLAGS_SCAN_MAX];
+	if (max_opcodes>FLAGS_SCAN_MAX) max_opcodes=FLAGS_SCAN_MAX;
+	while (flags_scan.count<max_opcodes) {
+		if (!flags_scan_instruction(use[flags_scan.count],def[flags_scan.count])) break;
+		flags_scan.count++;
+	}
+	// all flags are live at the end of the block
+	Bitu live=FMASK_TEST;
+	for (Bitu ct=flags_scan.count; ct>0; ct--) {
+		flags_scan.dead[ct-1]=(live==0);
+		live=(live & ~def[ct-1]) | use[ct-1];
+	}
+#endif
+}
+
+// called after each translated instruction, if none of the flags are read
+// anymore all queued functions can be replaced
+static void dyn_flags_check(void) {
+#ifdef DRC_FLAGS_INVALIDATION
+	if ((flags_scan.current<flags_scan.count) && flags_scan.dead[flags_scan.current]) {
+		InvalidateFlags();
+	}
+	flags_scan.current++;
+#endif
+}
@@ -400,6 +400,7 @@ static void dyn_lea(void) {
 
 static void dyn_push_seg(Bit8u seg) {
 	MOV_SEG_VAL_TO_HOST_REG(FC_OP1,seg);
+	gen_release_regs(1<<DRC_REG_ESP);
 	if (decode.big_op) {
 		gen_extend_word(false,FC_OP1);
 		gen_call_function_raw((void*)&dynrec_push_dword);
@@ -415,11 +416,13 @@ static void dyn_pop_seg(Bit8u seg) {
 
 static void dyn_push_reg(Bit8u reg) {
 	MOV_REG_WORD_TO_HOST_REG(FC_OP1,reg,decode.big_op);
+	gen_release_regs(1<<DRC_REG_ESP);
 	if (decode.big_op) gen_call_function_raw((void*)&dynrec_push_dword);
 	else gen_call_function_raw((void*)&dynrec_push_word);
 }
 
 static void dyn_pop_reg(Bit8u reg) {
+	gen_release_regs(1<<DRC_REG_ESP);
 	if (decode.big_op) gen_call_function_raw((void*)&dynrec_pop_dword);
 	else gen_call_function_raw((void*)&dynrec_pop_word);
 	MOV_REG_WORD_FROM_HOST_REG(FC_RETOP,reg,decode.big_op);
@@ -427,11 +430,13 @@ static void dyn_pop_reg(Bit8u reg) {
 
 static void dyn_push_byte_imm(Bit8s imm) {
 	gen_mov_dword_to_reg_imm(FC_OP1,(Bit32u)imm);
+	gen_release_regs(1<<DRC_REG_ESP);
 	if (decode.big_op) gen_call_function_raw((void*)&dynrec_push_dword);
 	else gen_call_function_raw((void*)&dynrec_push_word);
 }
 
 static void dyn_push_word_imm(Bitu imm) {
+	gen_release_regs(1<<DRC_REG_ESP);
 	if (decode.big_op) {
 		gen_mov_dword_to_reg_imm(FC_OP1,imm);
 		gen_call_function_raw((void*)&dynrec_push_dword);
@@ -447,12 +452,14 @@ static void dyn_pop_ev(void) {
 /*		dyn_fill_ea(FC_ADDR);
 		gen_protect_addr_reg();
 		dyn_read_word(FC_ADDR,FC_OP1,decode.big_op);	// dummy read to trigger possible page faults */
+		gen_release_regs(1<<DRC_REG_ESP);
 		if (decode.big_op) gen_call_function_raw((void*)&dynrec_pop_dword);
 		else gen_call_function_raw((void*)&dynrec_pop_word);
 		dyn_fill_ea(FC_ADDR);
 //		gen_restore_addr_reg();
 		dyn_write_word(FC_ADDR,FC_RETOP,decode.big_op);
 	} else {
+		gen_release_regs(1<<DRC_REG_ESP);
 		if (decode.big_op) gen_call_function_raw((void*)&dynrec_pop_dword);
 		else gen_call_function_raw((void*)&dynrec_pop_word);
 		MOV_REG_WORD_FROM_HOST_REG(FC_RETOP,decode.modrm.rm,decode.big_op);
@@ -712,16 +719,20 @@ static void dyn_grp3_eb(void) {
 		dyn_sop_byte_gencall(SOP_NEG);
 		break;
 	case 0x4:	// mul Eb
+		gen_release_regs(1<<DRC_REG_EAX);
 		gen_call_function_raw((void*)&dynrec_mul_byte);
 		return;
 	case 0x5:	// imul Eb
+		gen_release_regs(1<<DRC_REG_EAX);
 		gen_call_function_raw((void*)&dynrec_imul_byte);
 		return;
 	case 0x6:	// div Eb
+		gen_release_regs(1<<DRC_REG_EAX);
 		gen_call_function_raw((void*)&dynrec_div_byte);
 		dyn_check_exception(FC_RETOP);
 		return;
 	case 0x7:	// idiv Eb
+		gen_release_regs(1<<DRC_REG_EAX);
 		gen_call_function_raw((void*)&dynrec_idiv_byte);
 		dyn_check_exception(FC_RETOP);
 		return;
@@ -757,19 +768,23 @@ static void dyn_grp3_ev(void) {
 		dyn_sop_word_gencall(SOP_NEG,decode.big_op);
 		break;
 	case 0x4:	// mul Eb
+		gen_release_regs((1<<DRC_REG_EAX)|(1<<DRC_REG_EDX));
 		if (decode.big_op) gen_call_function_raw((void*)&dynrec_mul_dword);
 		else gen_call_function_raw((void*)&dynrec_mul_word);
 		return;
 	case 0x5:	// imul Eb
+		gen_release_regs((1<<DRC_REG_EAX)|(1<<DRC_REG_EDX));
 		if (decode.big_op) gen_call_function_raw((void*)&dynrec_imul_dword);
 		else gen_call_function_raw((void*)&dynrec_imul_word);
 		return;
 	case 0x6:	// div Eb
+		gen_release_regs((1<<DRC_REG_EAX)|(1<<DRC_REG_EDX));
 		if (decode.big_op) gen_call_function_raw((void*)&dynrec_div_dword);
 		else gen_call_function_raw((void*)&dynrec_div_word);
 		dyn_check_exception(FC_RETOP);
 		return;
 	case 0x7:	// idiv Eb
+		gen_release_regs((1<<DRC_REG_EAX)|(1<<DRC_REG_EDX));
 		if (decode.big_op) gen_call_function_raw((void*)&dynrec_idiv_dword);
 		else gen_call_function_raw((void*)&dynrec_idiv_word);
 		dyn_check_exception(FC_RETOP);
@@ -842,6 +857,7 @@ static Bitu dyn_grp4_ev(void) {
 		gen_protect_addr_reg();
 		gen_mov_word_to_reg(FC_OP1,decode.big_op?(void*)(&reg_eip):(void*)(&reg_ip),decode.big_op);
 		gen_add_imm(FC_OP1,(Bit32u)(decode.code-decode.code_start));
+		gen_release_regs(1<<DRC_REG_ESP);
 		if (decode.big_op) gen_call_function_raw((void*)&dynrec_push_dword);
 		else gen_call_function_raw((void*)&dynrec_push_word);
 
@@ -866,6 +882,7 @@ static Bitu dyn_grp4_ev(void) {
 			decode.big_op,FC_OP2,FC_ADDR,FC_RETOP);
 		return 1;
 	case 0x6:		// PUSH Ev
+		gen_release_regs(1<<DRC_REG_ESP);
 		if (decode.big_op) gen_call_function_raw((void*)&dynrec_push_dword);
 		else gen_call_function_raw((void*)&dynrec_push_word);
 		break;
@@ -1174,6 +1191,7 @@ static void dyn_loop(LoopTypes type) {
 static void dyn_ret_near(Bitu bytes) {
 	dyn_reduce_cycles();
 
+	gen_release_regs(1<<DRC_REG_ESP);
 	if (decode.big_op) gen_call_function_raw((void*)&dynrec_pop_dword);
 	else {
 		gen_call_function_raw((void*)&dynrec_pop_word);
@@ -1191,6 +1209,7 @@ static void dyn_call_near_imm(void) {
 	if (decode.big_op) imm=(Bit32s)decode_fetchd();
 	else imm=(Bit16s)decode_fetchw();
 	dyn_set_eip_end(FC_OP1);
+	gen_release_regs(1<<DRC_REG_ESP);
 	if (decode.big_op) gen_call_function_raw((void*)&dynrec_push_dword);
 	else gen_call_function_raw((void*)&dynrec_push_word);
 
@@ -1399,6 +1418,7 @@ static void dynrec_leave_dword(void) {
 }
 
 static void dyn_leave(void) {
+	gen_release_regs((1<<DRC_REG_ESP)|(1<<DRC_REG_EBP));
 	if (decode.big_op) gen_call_function_raw((void *)dynrec_leave_dword);
 	else gen_call_function_raw((void *)dynrec_leave_word);
 }
@@ -67,8 +67,86 @@ static INLINE void dyn_fpu_top_swapped() {
 	gen_mov_word_to_reg(FC_OP2,(void*)(&TOP),true);
 }
 
+#if defined(DRC_USE_SSE2_FPU) && !C_FPU_X86
+// the fpu registers are plain doubles, the backend does the arithmetic inline
+#define DYN_FPU_SSE2
+#endif
+
+enum FpuArith {
+	FARITH_ADD,FARITH_MUL,FARITH_SUB,FARITH_SUBR,FARITH_DIV,FARITH_DIVR
+};
+
+// register FC_OP1 = register FC_OP1 op register FC_OP2
+static void dyn_fpu_arith(FpuArith op) {
+#ifdef DYN_FPU_SSE2
+	static const Bit8u sse2_ops[6]={0x58,0x59,0x5c,0x5c,0x5e,0x5e};
+	gen_fpu_sse2_arith(sse2_ops[op],(op==FARITH_SUBR) || (op==FARITH_DIVR),
+		FC_OP1,FC_OP2,(void*)&fpu.regs[0]);
+#else
+	switch (op) {
+	case FARITH_ADD:gen_call_function_RR((void*)&FPU_FADD,FC_OP1,FC_OP2);break;
+	case FARITH_MUL:gen_call_function_RR((void*)&FPU_FMUL,FC_OP1,FC_OP2);break;
+	case FARITH_SUB:gen_call_function_RR((void*)&FPU_FSUB,FC_OP1,FC_OP2);break;
+	case FARITH_SUBR:gen_call_function_RR((void*)&FPU_FSUBR,FC_OP1,FC_OP2);break;
+	case FARITH_DIV:gen_call_function_RR((void*)&FPU_FDIV,FC_OP1,FC_OP2);break;
+	case FARITH_DIVR:gen_call_function_RR((void*)&FPU_FDIVR,FC_OP1,FC_OP2);break;
+	}
+#endif
+}
+
+// compare register FC_OP1 with register FC_OP2 (FCOM and FUCOM)
+static void dyn_fpu_fcom(void) {
+#ifdef DYN_FPU_SSE2
+	gen_fpu_sse2_compare(FC_OP1,FC_OP2,(void*)&fpu.regs[0],(void*)&fpu.tags[0],(void*)&fpu.sw);
+#else
+	gen_call_function_RR((void*)&FPU_FCOM,FC_OP1,FC_OP2);
+#endif
+}
+
+// copy register FC_OP1 to register FC_OP2
+static void dyn_fpu_fst(void) {
+#ifdef DYN_FPU_SSE2
+	gen_fpu_sse2_copy(FC_OP1,FC_OP2,(void*)&fpu.regs[0],(void*)&fpu.tags[0]);
+#else
+	gen_call_function_RR((void*)&FPU_FST,FC_OP1,FC_OP2);
+#endif
+}
+
 static void dyn_eatree() {
 	Bitu group=(decode.modrm.val >> 3) & 7;
+#ifdef DYN_FPU_SSE2
+	// the memory operand has been loaded into register 8
+	gen_mov_dword_to_reg_imm(FC_OP2,8);
+	switch (group){
+	case 0x00:		// FADD ST,STi
+		dyn_fpu_arith(FARITH_ADD);
+		break;
+	case 0x01:		// FMUL  ST,STi
+		dyn_fpu_arith(FARITH_MUL);
+		break;
+	case 0x02:		// FCOM  STi
+		dyn_fpu_fcom();
+		break;
+	case 0x03:		// FCOMP STi
+		dyn_fpu_fcom();
+		gen_call_function_raw((void*)&FPU_FPOP);
+		break;
+	case 0x04:		// FSUB  ST,STi
+		dyn_fpu_arith(FARITH_SUB);
+		break;
+	case 0x05:		// FSUBR ST,STi
+		dyn_fpu_arith(FARITH_SUBR);
+		break;
+	case 0x06:		// FDIV  ST,STi
+		dyn_fpu_arith(FARITH_DIV);
+		break;
+	case 0x07:		// FDIVR ST,STi
+		dyn_fpu_arith(FARITH_DIVR);
+		break;
+	default:
+		break;
+	}
+#else
 	switch (group){
 	case 0x00:		// FADD ST,STi
 		gen_call_function_R((void*)&FPU_FADD_EA,FC_OP1);
@@ -98,6 +176,7 @@ static void dyn_eatree() {
 	default:
 		break;
 	}
+#endif
 }
 
 static void dyn_fpu_esc0(){
@@ -106,29 +185,29 @@ static void dyn_fpu_esc0(){
 		dyn_fpu_top();
 		switch (decode.modrm.reg){
 		case 0x00:		//FADD ST,STi
-			gen_call_function_RR((void*)&FPU_FADD,FC_OP1,FC_OP2);
+			dyn_fpu_arith(FARITH_ADD);
 			break;
 		case 0x01:		// FMUL  ST,STi
-			gen_call_function_RR((void*)&FPU_FMUL,FC_OP1,FC_OP2);
+			dyn_fpu_arith(FARITH_MUL);
 			break;
 		case 0x02:		// FCOM  STi
-			gen_call_function_RR((void*)&FPU_FCOM,FC_OP1,FC_OP2);
+			dyn_fpu_fcom();
 			break;
 		case 0x03:		// FCOMP STi
-			gen_call_function_RR((void*)&FPU_FCOM,FC_OP1,FC_OP2);
+			dyn_fpu_fcom();
 			gen_call_function_raw((void*)&FPU_FPOP);
 			break;
 		case 0x04:		// FSUB  ST,STi
-			gen_call_function_RR((void*)&FPU_FSUB,FC_OP1,FC_OP2);
+			dyn_fpu_arith(FARITH_SUB);
 			break;	
 		case 0x05:		// FSUBR ST,STi
-			gen_call_function_RR((void*)&FPU_FSUBR,FC_OP1,FC_OP2);
+			dyn_fpu_arith(FARITH_SUBR);
 			break;
 		case 0x06:		// FDIV  ST,STi
-			gen_call_function_RR((void*)&FPU_FDIV,FC_OP1,FC_OP2);
+			dyn_fpu_arith(FARITH_DIV);
 			break;
 		case 0x07:		// FDIVR ST,STi
-			gen_call_function_RR((void*)&FPU_FDIVR,FC_OP1,FC_OP2);
+			dyn_fpu_arith(FARITH_DIVR);
 			break;
 		default:
 			break;
@@ -154,7 +233,7 @@ static void dyn_fpu_esc1(){
 			gen_call_function_raw((void*)&FPU_PREP_PUSH); 
 			gen_mov_word_to_reg(FC_OP2,(void*)(&TOP),true);
 			gen_restore_reg(FC_OP1);
-			gen_call_function_RR((void*)&FPU_FST,FC_OP1,FC_OP2);
+			dyn_fpu_fst();
 			break;
 		case 0x01: /* FXCH STi */
 			dyn_fpu_top();
@@ -165,7 +244,7 @@ static void dyn_fpu_esc1(){
 			break;
 		case 0x03: /* FSTP STi */
 			dyn_fpu_top();
-			gen_call_function_RR((void*)&FPU_FST,FC_OP1,FC_OP2);
+			dyn_fpu_fst();
 			gen_call_function_raw((void*)&FPU_FPOP);
 			break;   
 		case 0x04:
@@ -340,7 +419,7 @@ static void dyn_fpu_esc2(){
 				gen_add_imm(FC_OP2,1);
 				gen_and_imm(FC_OP2,7);
 				gen_mov_word_to_reg(FC_OP1,(void*)(&TOP),true);
-				gen_call_function_RR((void *)&FPU_FUCOM,FC_OP1,FC_OP2);
+				dyn_fpu_fcom();
 				gen_call_function_raw((void *)&FPU_FPOP);
 				gen_call_function_raw((void *)&FPU_FPOP);
 				break;
@@ -431,36 +510,36 @@ static void dyn_fpu_esc4(){
 		switch(decode.modrm.reg){
 		case 0x00:	/* FADD STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FADD,FC_OP1,FC_OP2);
+			dyn_fpu_arith(FARITH_ADD);
 			break;
 		case 0x01:	/* FMUL STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FMUL,FC_OP1,FC_OP2);
+			dyn_fpu_arith(FARITH_MUL);
 			break;
 		case 0x02:  /* FCOM*/
 			dyn_fpu_top();
-			gen_call_function_RR((void*)&FPU_FCOM,FC_OP1,FC_OP2);
+			dyn_fpu_fcom();
 			break;
 		case 0x03:  /* FCOMP*/
 			dyn_fpu_top();
-			gen_call_function_RR((void*)&FPU_FCOM,FC_OP1,FC_OP2);
+			dyn_fpu_fcom();
 			gen_call_function_raw((void*)&FPU_FPOP);
 			break;
 		case 0x04:  /* FSUBR STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FSUBR,FC_OP1,FC_OP2);
+			dyn_fpu_arith(FARITH_SUBR);
 			break;
 		case 0x05:  /* FSUB  STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FSUB,FC_OP1,FC_OP2);
+			dyn_fpu_arith(FARITH_SUB);
 			break;
 		case 0x06:  /* FDIVR STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FDIVR,FC_OP1,FC_OP2);
+			dyn_fpu_arith(FARITH_DIVR);
 			break;
 		case 0x07:  /* FDIV STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FDIV,FC_OP1,FC_OP2);
+			dyn_fpu_arith(FARITH_DIV);
 			break;
 		default:
 			break;
@@ -485,17 +564,17 @@ static void dyn_fpu_esc5(){
 			gen_call_function_RR((void*)&FPU_FXCH,FC_OP1,FC_OP2);
 			break;
 		case 0x02: /* FST STi */
-			gen_call_function_RR((void*)&FPU_FST,FC_OP1,FC_OP2);
+			dyn_fpu_fst();
 			break;
 		case 0x03:  /* FSTP STi*/
-			gen_call_function_RR((void*)&FPU_FST,FC_OP1,FC_OP2);
+			dyn_fpu_fst();
 			gen_call_function_raw((void*)&FPU_FPOP);
 			break;
 		case 0x04:	/* FUCOM STi */
-			gen_call_function_RR((void*)&FPU_FUCOM,FC_OP1,FC_OP2);
+			dyn_fpu_fcom();
 			break;
 		case 0x05:	/*FUCOMP STi */
-			gen_call_function_RR((void*)&FPU_FUCOM,FC_OP1,FC_OP2);
+			dyn_fpu_fcom();
 			gen_call_function_raw((void*)&FPU_FPOP);
 			break;
 		default:
@@ -549,15 +628,15 @@ static void dyn_fpu_esc6(){
 		switch(decode.modrm.reg){
 		case 0x00:	/*FADDP STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FADD,FC_OP1,FC_OP2);
+			dyn_fpu_arith(FARITH_ADD);
 			break;
 		case 0x01:	/* FMULP STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FMUL,FC_OP1,FC_OP2);
+			dyn_fpu_arith(FARITH_MUL);
 			break;
 		case 0x02:  /* FCOMP5*/
 			dyn_fpu_top();
-			gen_call_function_RR((void*)&FPU_FCOM,FC_OP1,FC_OP2);
+			dyn_fpu_fcom();
 			break;	/* TODO IS THIS ALLRIGHT ????????? */
 		case 0x03:  /*FCOMPP*/
 			if(decode.modrm.rm != 1) {
@@ -568,24 +647,24 @@ static void dyn_fpu_esc6(){
 			gen_add_imm(FC_OP2,1);
 			gen_and_imm(FC_OP2,7);
 			gen_mov_word_to_reg(FC_OP1,(void*)(&TOP),true);
-			gen_call_function_RR((void*)&FPU_FCOM,FC_OP1,FC_OP2);
+			dyn_fpu_fcom();
 			gen_call_function_raw((void*)&FPU_FPOP); /* extra pop at the bottom*/
 			break;
 		case 0x04:  /* FSUBRP STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FSUBR,FC_OP1,FC_OP2);
+			dyn_fpu_arith(FARITH_SUBR);
 			break;
 		case 0x05:  /* FSUBP  STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FSUB,FC_OP1,FC_OP2);
+			dyn_fpu_arith(FARITH_SUB);
 			break;
 		case 0x06:	/* FDIVRP STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FDIVR,FC_OP1,FC_OP2);
+			dyn_fpu_arith(FARITH_DIVR);
 			break;
 		case 0x07:  /* FDIVP STi,ST*/
 			dyn_fpu_top_swapped();
-			gen_call_function_RR((void*)&FPU_FDIV,FC_OP1,FC_OP2);
+			dyn_fpu_arith(FARITH_DIV);
 			break;
 		default:
 			break;
@@ -615,7 +694,7 @@ static void dyn_fpu_esc7(){
 		case 0x02:  /* FSTP STi*/
 		case 0x03:  /* FSTP STi*/
 			dyn_fpu_top();
-			gen_call_function_RR((void*)&FPU_FST,FC_OP1,FC_OP2);
+			dyn_fpu_fst();
 			gen_call_function_raw((void*)&FPU_FPOP);
 			break;
 		case 0x04:
@@ -0,0 +1,402 @@
+/*
+ *  Copyright (C) 2002-2019  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+
+/*
+	The persistent cache keeps translated blocks across sessions.
+	When a block is translated its code is stored together with the
+	guest code it was translated from and the host addresses it uses
+	(see cache_addreloc). The next session looks up new blocks in the
+	stored ones first; a block whose guest code is still the same is
+	copied into the cache and relocated instead of being translated.
+
+	Host addresses either point into the CacheBlockDynRec of the block
+	or into the dosbox image, the latter are stored relative to an
+	anchor in the image so they stay valid with a relocated executable.
+	Blocks using any other address are not stored.
+
+	Image offsets are only valid for the very same build, so the file
+	carries the size and a hash of the executable it was written by and
+	is ignored by any other one.
+*/
+
+#ifdef DRC_PERSISTENT_CACHE
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "cross.h"
+
+#define PERSIST_HASH	(16*1024)
+#define PERSIST_LIMIT	(32*1024*1024)	// size of the file at most
+#define PERSIST_VERSION	(2)
+
+#define PERSIST_ANCHOR	((Bit8u*)&core_dynrec)
+
+enum PersistTargets {
+	PTARGET_BLOCK,		// offset into the CacheBlockDynRec
+	PTARGET_IMAGE		// offset to PERSIST_ANCHOR
+};
+
+struct PersistReloc {
+	Bit16u pos;			// offset of the address field in the code
+	Bit8u type;			// RelocTypes
+	Bit8u extra;
+	Bit8u target;		// PersistTargets
+	Bit8u pad[3];
+	Bit64s offset;
+};
+
+struct PersistEntry {
+	Bit16u start,end;	// guest code inside the page
+	Bit16u code_size;
+	Bit16u reloc_count;
+	Bit8u mode;			// see persist_mode
+	Bit8u pad[3];
+};
+
+struct PersistFileHeader {
+	char magic[8];
+	Bit32u version;
+	Bit32u block_size;	// sizeof(CacheBlockDynRec)
+	Bit64u build[2];	// size and hash of the executable
+	Bit32u count;
+	Bit32u pad;
+};
+
+struct PersistBlock {
+	PersistEntry entry;
+	Bit32u hash_next;	// index+1 of the next block in the chain
+	bool used;			// loaded or translated in this session
+	Bit8u * data;		// relocations, guest code, host code
+};
+
+static struct {
+	bool wanted;
+	bool loaded;
+	bool changed;
+	Bit64u build[2];
+	PersistBlock * blocks;
+	Bitu count;
+	Bitu capacity;
+	Bitu size;
+	Bit32u hash[PERSIST_HASH];	// index+1 of the first block, 0 if none
+} persist;
+
+
+// the parts of the cpu state that change the translation of the same code
+static Bit8u persist_mode(void) {
+	return (cpu.code.big ? 1 : 0) | (cpu.pmode ? 2 : 0) |
+		((reg_flags & FLAG_VM) ? 4 : 0) | (cpu.cpl ? 8 : 0);
+}
+
+static Bitu persist_hashkey(Bitu start,Bit8u mode,const Bit8u * code) {
+	Bitu key=start*31+mode;
+	for (Bitu i=0;i<4;i++) key=key*131+code[i];
+	return (key^(key>>14))&(PERSIST_HASH-1);
+}
+
+// identify the build by the size and a FNV-1a hash of the executable
+static bool persist_build(Bit64u * build) {
+	std::string path;
+	if (!Cross::GetExecutablePath(path)) return false;
+	FILE * f=fopen(path.c_str(),"rb");
+	if (!f) return false;
+	Bit64u size=0,hash=0xcbf29ce484222325ULL;
+	Bit8u buf[16384];
+	size_t len;
+	while ((len=fread(buf,1,sizeof(buf),f))>0) {
+		for (size_t i=0;i<len;i++) hash=(hash^buf[i])*0x100000001b3ULL;
+		size+=len;
+	}
+	bool ok=!ferror(f) && size;
+	fclose(f);
+	build[0]=size;
+	build[1]=hash;
+	return ok;
+}
+
+static INLINE Bitu persist_datasize(PersistEntry * entry) {
+	return entry->reloc_count*sizeof(PersistReloc)+
+		(entry->end-entry->start+1)+entry->code_size;
+}
+
+static PersistBlock * persist_newblock(PersistEntry * entry,Bit8u * data) {
+	if (persist.count>=persist.capacity) {
+		Bitu capacity=persist.capacity ? persist.capacity*2 : 1024;
+		PersistBlock * blocks=(PersistBlock*)realloc(persist.blocks,capacity*sizeof(PersistBlock));
+		if (!blocks) return NULL;
+		persist.blocks=blocks;
+		persist.capacity=capacity;
+	}
+	PersistBlock * pblock=&persist.blocks[persist.count++];
+	pblock->entry=*entry;
+	pblock->used=false;
+	pblock->data=data;
+	// newer blocks come first in the chain
+	Bitu key=persist_hashkey(entry->start,entry->mode,
+		data+entry->reloc_count*sizeof(PersistReloc));
+	pblock->hash_next=persist.hash[key];
+	persist.hash[key]=(Bit32u)persist.count;
+	persist.size+=sizeof(PersistEntry)+persist_datasize(entry);
+	return pblock;
+}
+
+// copy a stored block into the cache and fill in the host addresses
+static bool persist_relocate(PersistBlock * pblock,CacheBlockDynRec * block) {
+	PersistReloc * relocs=(PersistReloc*)pblock->data;
+	Bit8u * code=pblock->data+pblock->entry.reloc_count*sizeof(PersistReloc)+
+		(pblock->entry.end-pblock->entry.start+1);
+	Bit8u * dest=block->cache.start;
+	memcpy(dest,code,pblock->entry.code_size);
+	for (Bitu i=0;i<pblock->entry.reloc_count;i++) {
+		Bit8u * target=(relocs[i].target==PTARGET_BLOCK ? (Bit8u*)block : PERSIST_ANCHOR)+relocs[i].offset;
+		Bit8u * field=dest+relocs[i].pos;
+		switch (relocs[i].type) {
+			case RELOC_ABS64:
+				*(Bit64u*)field=(Bit64u)target;
+				break;
+			case RELOC_ABS32:
+				if ((Bit64u)target>=0x100000000LL) return false;
+				*(Bit32u*)field=(Bit32u)(Bit64u)target;
+				break;
+			case RELOC_REL32: {
+				Bit64s diff=target-(field+4+relocs[i].extra);
+				if ((diff>>63)!=(diff>>31)) return false;
+				*(Bit32u*)field=(Bit32u)(((Bit64u)diff)&0xffffffffLL);
+				} break;
+			default:
+				return false;
+		}
+	}
+	return true;
+}
+
+// prepare the recording of the host addresses of a new block
+static void persist_startblock(void) {
+	cache_relocs.used=0;
+	cache_relocs.overflow=false;
+}
+
+// try to take the block that starts at start from the persistent cache,
+// the block has been opened already and gets closed when it is found
+static bool persist_loadblock(CodePageHandlerDynRec * codepage,PhysPt start,CacheBlockDynRec * block) {
+	if (!persist.count || codepage->invalidation_map) return false;
+	Bitu index=start&4095;
+	if (index>4092) return false;
+	Bit8u mode=persist_mode();
+	Bit8u head[4];
+	for (Bitu i=0;i<4;i++) head[i]=mem_readb(start+i);
+	for (Bit32u next=persist.hash[persist_hashkey(index,mode,head)];next;) {
+		PersistBlock * pblock=&persist.blocks[next-1];
+		next=pblock->hash_next;
+		if (pblock->entry.start!=index || pblock->entry.mode!=mode) continue;
+		// the guest code has to be the same as when the block was translated
+		Bit8u * guest=pblock->data+pblock->entry.reloc_count*sizeof(PersistReloc);
+		Bitu len=pblock->entry.end-pblock->entry.start+1;
+		Bitu i;
+		for (i=0;i<len;i++) {
+			if (mem_readb(start+i)!=guest[i]) break;
+		}
+		if (i<len) continue;
+
+		if (!persist_relocate(pblock,block)) return false;
+		block->page.start=(Bit16u)index;
+		block->page.end=pblock->entry.end;
+		codepage->AddCacheBlock(block);
+		for (i=index;i<=pblock->entry.end;i++) codepage->write_map[i]++;
+		cache.pos=block->cache.start+pblock->entry.code_size;
+		cache_block_before_close();
+		cache_closeblock();
+		cache_block_closing(block->cache.start,block->cache.size);
+		pblock->used=true;
+		cache.stats.loaded++;
+		return true;
+	}
+	return false;
+}
+
+// store the block that has just been translated
+static void persist_addblock(CodePageHandlerDynRec * codepage) {
+	if (!persist.loaded || persist.size>=PERSIST_LIMIT) return;
+	CacheBlockDynRec * block=decode.block;
+	// only blocks inside a single page that don't need to check
+	// for self modification
+	if (decode.active_block!=block || block->cache.wmapmask || codepage->invalidation_map) return;
+	if (cache_relocs.overflow || cache_relocs.written>CACHE_MAXSIZE) return;
+	if (block->page.end<block->page.start+3) return;
+
+	PersistEntry entry;
+	memset(&entry,0,sizeof(entry));
+	entry.start=block->page.start;
+	entry.end=block->page.end;
+	entry.code_size=(Bit16u)cache_relocs.written;
+	entry.reloc_count=(Bit16u)cache_relocs.used;
+	entry.mode=persist_mode();
+	Bit8u * data=(Bit8u*)malloc(persist_datasize(&entry));
+	if (!data) return;
+
+	PersistReloc * relocs=(PersistReloc*)data;
+	Bit8u * code=block->cache.start;
+	for (Bitu i=0;i<cache_relocs.used;i++) {
+		Bit8u * field=cache_relocs.list[i].pos;
+		Bitu field_size=(cache_relocs.list[i].type==RELOC_ABS64) ? 8 : 4;
+		if (field<code || field+field_size>code+entry.code_size) goto refuse;
+		Bit8u * target;
+		switch (cache_relocs.list[i].type) {
+			case RELOC_ABS64:
+				target=(Bit8u*)*(Bit64u*)field;
+				break;
+			case RELOC_ABS32:
+				target=(Bit8u*)(Bit64u)*(Bit32u*)field;
+				break;
+			default:
+				target=field+4+cache_relocs.list[i].extra+(Bit32s)*(Bit32u*)field;
+				break;
+		}
+		memset(&relocs[i],0,sizeof(PersistReloc));
+		relocs[i].pos=(Bit16u)(field-code);
+		relocs[i].type=cache_relocs.list[i].type;
+		relocs[i].extra=cache_relocs.list[i].extra;
+		if (target>=(Bit8u*)block && target<(Bit8u*)(block+1)) {
+			relocs[i].target=PTARGET_BLOCK;
+			relocs[i].offset=target-(Bit8u*)block;
+		} else {
+			Bit64s offset=target-PERSIST_ANCHOR;
+			// not in the image, possibly memory that is allocated at runtime
+			if ((offset>>63)!=(offset>>31)) goto refuse;
+			relocs[i].target=PTARGET_IMAGE;
+			relocs[i].offset=offset;
+		}
+	}
+	{
+		Bit8u * guest=data+entry.reloc_count*sizeof(PersistReloc);
+		Bitu len=entry.end-entry.start+1;
+		for (Bitu i=0;i<len;i++) guest[i]=mem_readb(decode.code_start+i);
+		memcpy(guest+len,code,entry.code_size);
+		PersistBlock * pblock=persist_newblock(&entry,data);
+		if (!pblock) goto refuse;
+		pblock->used=true;
+		persist.changed=true;
+	}
+	return;
+refuse:
+	free(data);
+}
+
+static void persist_filename(std::string & path,bool create) {
+	if (create) Cross::CreatePlatformConfigDir(path);
+	else Cross::GetPlatformConfigDir(path);
+	path+="dynrec.cache";
+}
+
+static void persist_setup(bool enable) {
+	persist.wanted=enable;
+}
+
+// read the blocks stored by an earlier session
+static void persist_init(void) {
+	if (!persist.wanted || persist.loaded) return;
+	if (!persist_build(persist.build)) {
+		// without a build identity stored code can't be trusted
+		LOG_MSG("Dynamic core: can't identify the executable, no persistent cache");
+		persist.wanted=false;
+		return;
+	}
+	persist.loaded=true;
+	std::string path;
+	persist_filename(path,false);
+	FILE * f=fopen(path.c_str(),"rb");
+	if (!f) return;
+	PersistFileHeader header;
+	if (fread(&header,sizeof(header),1,f)!=1 || memcmp(header.magic,"DRCCACHE",8) ||
+		header.version!=PERSIST_VERSION || header.block_size!=sizeof(CacheBlockDynRec) ||
+		memcmp(header.build,persist.build,sizeof(persist.build))) {
+		// written by a different build
+		fclose(f);
+		return;
+	}
+	for (Bitu i=0;i<header.count;i++) {
+		PersistEntry entry;
+		if (fread(&entry,sizeof(entry),1,f)!=1) break;
+		if (entry.end<entry.start+3 || entry.end>4095 || entry.code_size>CACHE_MAXSIZE) break;
+		Bitu size=persist_datasize(&entry);
+		Bit8u * data=(Bit8u*)malloc(size);
+		if (!data) break;
+		if (fread(data,size,1,f)!=1 || !persist_newblock(&entry,data)) {
+			free(data);
+			break;
+		}
+	}
+	fclose(f);
+	persist.changed=false;
+	LOG_MSG("Dynamic core: %d blocks in the persistent cache",(int)persist.count);
+}
+
+static void persist_write(FILE * f,bool used,Bitu & size,Bit32u & count) {
+	for (Bitu i=0;i<persist.count;i++) {
+		PersistBlock * pblock=&persist.blocks[i];
+		if (pblock->used!=used) continue;
+		Bitu block_size=sizeof(PersistEntry)+persist_datasize(&pblock->entry);
+		if (size+block_size>PERSIST_LIMIT) continue;
+		if (fwrite(&pblock->entry,sizeof(PersistEntry),1,f)!=1) return;
+		if (fwrite(pblock->data,block_size-sizeof(PersistEntry),1,f)!=1) return;
+		size+=block_size;
+		count++;
+	}
+}
+
+// write the blocks back, the ones used in this session first
+static void persist_close(void) {
+	if (persist.loaded && persist.changed) {
+		std::string path;
+		persist_filename(path,true);
+		FILE * f=fopen(path.c_str(),"wb");
+		if (f) {
+			PersistFileHeader header;
+			memset(&header,0,sizeof(header));
+			memcpy(header.magic,"DRCCACHE",8);
+			header.version=PERSIST_VERSION;
+			header.block_size=sizeof(CacheBlockDynRec);
+			memcpy(header.build,persist.build,sizeof(header.build));
+			fwrite(&header,sizeof(header),1,f);
+			Bitu size=sizeof(header);
+			persist_write(f,true,size,header.count);
+			persist_write(f,false,size,header.count);
+			// now the number of blocks is known
+			fseek(f,0,SEEK_SET);
+			fwrite(&header,sizeof(header),1,f);
+			fclose(f);
+		} else LOG_MSG("Dynamic core: can't write %s",path.c_str());
+	}
+	for (Bitu i=0;i<persist.count;i++) free(persist.blocks[i].data);
+	free(persist.blocks);
+	persist.blocks=NULL;
+	persist.count=persist.capacity=persist.size=0;
+	memset(persist.hash,0,sizeof(persist.hash));
+	persist.loaded=persist.changed=false;
+}
+
+#else
+
+static INLINE void persist_setup(bool /*enable*/) {}
+static INLINE void persist_init(void) {}
+static INLINE void persist_close(void) {}
+
+#endif
@@ -29,6 +29,17 @@
 // try to replace _simple functions by code
 #define DRC_FLAGS_INVALIDATION_DCODE
 
+// keep guest registers in host registers while a block runs
+#define DRC_USE_REGS_ADDR
+#define DRC_USE_REGS_CACHE
+
+// all host addresses in the generated code are recorded with cache_addreloc
+// so blocks can be stored in the persistent cache
+#define DRC_PERSISTENT_CACHE
+
+// fpu register arithmetic is done inline with scalar sse2 instructions
+#define DRC_USE_SSE2_FPU
+
 // type with the same size as a pointer
 #define DRC_PTR_SIZE_IM Bit64u
 
@@ -81,6 +92,28 @@ typedef Bit8u HostReg;
 #define TEMP_REG_DRC HOST_ESI
 
 
+// The guest registers cpu_regs.regs[] are cached in r12-r15 within a block.
+// These are preserved across function calls, but every helper call can
+// fault or read cpu_regs, so modified values are written back before it.
+// Values are also written back at block exits, before branches to the
+// exception and cycle exits and when a host register is needed for
+// another guest register.
+// Between a short branch and its target nothing is cached, so both paths
+// arrive with the same state.
+#define REGCACHE_HOST_REGS	4
+#define REGCACHE_NONE		8
+
+static struct {
+	Bitu guest[REGCACHE_HOST_REGS];		// guest register held, REGCACHE_NONE if unused
+	bool dirty[REGCACHE_HOST_REGS];		// the host register is newer than cpu_regs
+	Bitu used[REGCACHE_HOST_REGS];		// for replacing the least recently used
+	Bitu clock;
+	Bitu branches;						// short branches not yet filled
+} regcache={{REGCACHE_NONE,REGCACHE_NONE,REGCACHE_NONE,REGCACHE_NONE}};
+
+static void gen_regcache_release_mem(void* data);
+
+
 // move a full register from reg_src to reg_dst
 static void gen_mov_regs(HostReg reg_dst,HostReg reg_src) {
 	cache_addb(0x8b);					// mov reg_dst,reg_src
@@ -92,11 +125,12 @@ static void gen_mov_reg_qword(HostReg dest_reg,Bit64u imm) {
 	cache_addb(0x48);
 	cache_addb(0xb8+dest_reg);			// mov dest_reg,imm
 	cache_addq(imm);
+	cache_addreloc(cache.pos-8,RELOC_ABS64);
 }
 
 
 // This function generates an instruction with register addressing and a memory location
-static INLINE void gen_reg_memaddr(HostReg reg,void* data,Bit8u op,Bit8u prefix=0) {
+static INLINE void gen_reg_memaddr_direct(HostReg reg,void* data,Bit8u op,Bit8u prefix=0) {
 	Bit64s diff = (Bit64s)data-((Bit64s)cache.pos+(prefix?7:6));
 //	if ((diff<0x80000000LL) && (diff>-0x80000000LL)) { //clang messes itself up on this...
 	if ( (diff>>63) == (diff>>31) ) { //signed bit extend, test to see if value fits in a Bit32s
@@ -106,12 +140,14 @@ static INLINE void gen_reg_memaddr(HostReg reg,void* data,Bit8u op,Bit8u prefix=
 		cache_addb(0x05+(reg<<3));
 		// RIP-relative addressing is offset after the instruction 
 		cache_addd((Bit32u)(((Bit64u)diff)&0xffffffffLL)); 
+		cache_addreloc(cache.pos-4,RELOC_REL32);
 	} else if ((Bit64u)data<0x100000000LL) {
 		// mov reg,[data] (or similar, depending on the op) when absolute address of data is <4GB
 		if(prefix) cache_addb(prefix);
 		cache_addb(op);
 		cache_addw(0x2504+(reg<<3));
 		cache_addd((Bit32u)(((Bit64u)data)&0xffffffffLL));
+		cache_addreloc(cache.pos-4,RELOC_ABS32);
 	} else {
 		// load 64-bit data into tmp_reg and do mov reg,[tmp_reg] (or similar, depending on the op)
 		HostReg tmp_reg = HOST_EAX;
@@ -128,8 +164,15 @@ static INLINE void gen_reg_memaddr(HostReg reg,void* data,Bit8u op,Bit8u prefix=
 	}
 }
 
+// guest registers accessed through their address are taken out of the cache
+static INLINE void gen_reg_memaddr(HostReg reg,void* data,Bit8u op,Bit8u prefix=0) {
+	gen_regcache_release_mem(data);
+	gen_reg_memaddr_direct(reg,data,op,prefix);
+}
+
 // Same as above, but with immediate addressing and a memory location
 static INLINE void gen_memaddr(Bitu modreg,void* data,Bitu off,Bitu imm,Bit8u op,Bit8u prefix=0) {
+	gen_regcache_release_mem(data);
 	Bit64s diff = (Bit64s)data-((Bit64s)cache.pos+off+(prefix?7:6));
 //	if ((diff<0x80000000LL) && (diff>-0x80000000LL)) {
 	if ( (diff>>63) == (diff>>31) ) {
@@ -137,6 +180,7 @@ static INLINE void gen_memaddr(Bitu modreg,void* data,Bitu off,Bitu imm,Bit8u op
 		if(prefix) cache_addb(prefix);
 		cache_addw(op+((modreg+1)<<8));
 		cache_addd((Bit32u)(((Bit64u)diff)&0xffffffffLL));
+		cache_addreloc(cache.pos-4,RELOC_REL32,off);
 
 		switch(off) {
 			case 1: cache_addb(((Bit8u)imm&0xff)); break;
@@ -149,6 +193,7 @@ static INLINE void gen_memaddr(Bitu modreg,void* data,Bitu off,Bitu imm,Bit8u op
 		cache_addw(op+(modreg<<8));
 		cache_addb(0x25);
 		cache_addd((Bit32u)(((Bit64u)data)&0xffffffffLL));
+		cache_addreloc(cache.pos-4,RELOC_ABS32);
 
 		switch(off) {
 			case 1: cache_addb(((Bit8u)imm&0xff)); break;
@@ -175,6 +220,72 @@ static INLINE void gen_memaddr(Bitu modreg,void* data,Bitu off,Bitu imm,Bit8u op
 	}
 }
 
+// write a cached guest register back into cpu_regs
+static void gen_regcache_writeback(Bitu slot) {
+	if (!regcache.dirty[slot]) return;
+	regcache.dirty[slot]=false;
+	// mov [cpu_regs.regs[guest]],r12d+slot
+	gen_reg_memaddr_direct(4+slot,&cpu_regs.regs[regcache.guest[slot]].dword[0],0x89,0x44);
+}
+
+// write back and forget the guest registers in mask
+static void gen_release_regs(Bitu mask) {
+	for (Bitu slot=0;slot<REGCACHE_HOST_REGS;slot++) {
+		if (regcache.guest[slot]==REGCACHE_NONE || !(mask&(1<<regcache.guest[slot]))) continue;
+		gen_regcache_writeback(slot);
+		regcache.guest[slot]=REGCACHE_NONE;
+	}
+}
+
+// write back all modified guest registers but keep them cached
+static void gen_regcache_sync(void) {
+	for (Bitu slot=0;slot<REGCACHE_HOST_REGS;slot++) gen_regcache_writeback(slot);
+}
+
+// another access to the guest register at data bypasses the cache
+static void gen_regcache_release_mem(void* data) {
+	Bitu offset=(Bitu)((Bit8u*)data-(Bit8u*)&cpu_regs.regs[0]);
+	if (offset<sizeof(cpu_regs.regs)) gen_release_regs(1<<(offset/sizeof(cpu_regs.regs[0])));
+}
+
+// host register slot holding the guest register, loaded from memory
+// if load is set, or -1 if nothing can be cached at this point
+static Bits gen_regcache_get(Bitu guest,bool load) {
+	if (regcache.branches) return -1;
+	Bitu slot;
+	for (slot=0;slot<REGCACHE_HOST_REGS;slot++) {
+		if (regcache.guest[slot]==guest) {
+			regcache.used[slot]=++regcache.clock;
+			return (Bits)slot;
+		}
+	}
+	slot=0;
+	for (Bitu i=1;i<REGCACHE_HOST_REGS;i++) {
+		if (regcache.guest[slot]==REGCACHE_NONE) break;
+		if (regcache.guest[i]==REGCACHE_NONE || regcache.used[i]<regcache.used[slot]) slot=i;
+	}
+	if (regcache.guest[slot]!=REGCACHE_NONE) {
+		gen_regcache_writeback(slot);
+		regcache.guest[slot]=REGCACHE_NONE;
+	}
+	// mov r12d+slot,[cpu_regs.regs[guest]]
+	if (load) gen_reg_memaddr_direct(4+slot,&cpu_regs.regs[guest].dword[0],0x8b,0x44);
+	regcache.guest[slot]=guest;
+	regcache.dirty[slot]=false;
+	regcache.used[slot]=++regcache.clock;
+	return (Bits)slot;
+}
+
+// forget the cached registers without writing them back,
+// all paths out of a block have done that already
+static void gen_regcache_reset(void) {
+	for (Bitu slot=0;slot<REGCACHE_HOST_REGS;slot++) {
+		regcache.guest[slot]=REGCACHE_NONE;
+		regcache.dirty[slot]=false;
+	}
+	regcache.branches=0;
+}
+
 // move a 32bit (dword==true) or 16bit (dword==false) value from memory into dest_reg
 // 16bit moves may destroy the upper 16bit of the destination register
 static void gen_mov_word_to_reg(HostReg dest_reg,void* data,bool dword,Bit8u prefix=0) {
@@ -364,6 +475,9 @@ static INLINE void gen_lea(HostReg dest_reg,Bitu scale,Bits imm) {
 
 // generate a call to a parameterless function
 static void INLINE gen_call_function_raw(void * func) {
+	// the helper may fault or read the guest registers, helpers that
+	// change them release them at the call site
+	gen_regcache_sync();
 //	cache_addb(0x48); 
 //	cache_addw(0xec83); 
 #if defined (_WIN64)
@@ -378,6 +492,7 @@ static void INLINE gen_call_function_raw(void * func) {
 //	cache_addb(0xb8);	// mov reg,imm64
 	cache_addw(0xb848);
 	cache_addq((Bit64u)func);
+	cache_addreloc(cache.pos-8,RELOC_ABS64);
 	cache_addw(0xd0ff);
 
 //	cache_addb(0x48); 
@@ -395,6 +510,9 @@ static void INLINE gen_call_function_raw(void * func) {
 // note: the parameters are loaded in the architecture specific way
 // using the gen_load_param_ functions below
 static Bit64u INLINE gen_call_function_setup(void * func,Bitu paramcount,bool fastcall=false) {
+	// the called function may work on any guest register
+	gen_release_regs(0xff);
+
 	// align the stack
 	cache_addb(0x48);
 	cache_addw(0xc48b);		// mov rax,rsp
@@ -434,6 +552,7 @@ static Bit64u INLINE gen_call_function_setup(void * func,Bitu paramcount,bool fa
 //	cache_addb(0xb8);		// mov reg,imm64
 	cache_addw(0xb848);
 	cache_addq((Bit64u)func);
+	cache_addreloc(cache.pos-8,RELOC_ABS64);
 
 	cache_addw(0xd0ff);
 
@@ -498,10 +617,12 @@ static void INLINE gen_load_param_addr(DRC_PTR_SIZE_IM addr,Bitu param) {
 		case 2:			// mov r8,addr64
 			cache_addw(0xb849);
 			cache_addq(addr);
+			cache_addreloc(cache.pos-8,RELOC_ABS64);
 			break;
 		case 3:			// mov r9,addr64
 			cache_addw(0xb949);
 			cache_addq(addr);
+			cache_addreloc(cache.pos-8,RELOC_ABS64);
 			break;
 #else
 		case 2:			// mov rdx,addr64
@@ -585,8 +706,10 @@ static void INLINE gen_load_param_mem(Bitu mem,Bitu param) {
 
 // jump to an address pointed at by ptr, offset is in imm
 static void gen_jmp_ptr(void * ptr,Bits imm=0) {
+	gen_release_regs(0xff);
 	cache_addw(0xa148);		// mov rax,[data]
 	cache_addq((Bit64u)ptr);
+	cache_addreloc(cache.pos-8,RELOC_ABS64);
 
 	cache_addb(0xff);		// jmp [rax+imm]
 	if (!imm) {
@@ -604,6 +727,8 @@ static void gen_jmp_ptr(void * ptr,Bits imm=0) {
 // short conditional jump (+-127 bytes) if register is zero
 // the destination is set by gen_fill_branch() later
 static Bit64u gen_create_branch_on_zero(HostReg reg,bool dword) {
+	gen_release_regs(0xff);
+	regcache.branches++;
 	if (!dword) cache_addb(0x66);
 	cache_addb(0x0b);					// or reg,reg
 	cache_addb(0xc0+reg+(reg<<3));
@@ -615,6 +740,8 @@ static Bit64u gen_create_branch_on_zero(HostReg reg,bool dword) {
 // short conditional jump (+-127 bytes) if register is nonzero
 // the destination is set by gen_fill_branch() later
 static Bit64u gen_create_branch_on_nonzero(HostReg reg,bool dword) {
+	gen_release_regs(0xff);
+	regcache.branches++;
 	if (!dword) cache_addb(0x66);
 	cache_addb(0x0b);					// or reg,reg
 	cache_addb(0xc0+reg+(reg<<3));
@@ -631,12 +758,15 @@ static void gen_fill_branch(DRC_PTR_SIZE_IM data) {
 	if (len>126) LOG_MSG("Big jump %d",len);
 #endif
 	*(Bit8u*)data=(Bit8u)((Bit64u)cache.pos-data-1);
+	if (regcache.branches) regcache.branches--;
 }
 
 // conditional jump if register is nonzero
 // for isdword==true the 32bit of the register are tested
 // for isdword==false the lowest 8bit of the register are tested
 static Bit64u gen_create_branch_long_nonzero(HostReg reg,bool isdword) {
+	// the target is an exit at the end of the block
+	gen_regcache_sync();
 	// isdword: cmp reg32,0
 	// not isdword: cmp reg8,0
 	cache_addb(0x0a+(isdword?1:0));				// or reg,reg
@@ -649,6 +779,7 @@ static Bit64u gen_create_branch_long_nonzero(HostReg reg,bool isdword) {
 
 // compare 32bit-register against zero and jump if value less/equal than zero
 static Bit64u gen_create_branch_long_leqzero(HostReg reg) {
+	gen_regcache_sync();
 	cache_addw(0xf883+(reg<<8));
 	cache_addb(0x00);		// cmp reg,0
 
@@ -668,7 +799,11 @@ static void gen_run_code(void) {
 #if defined (_WIN64)
 	cache_addw(0x5657);			// push rdi; push rsi
 #endif
+	cache_addd(0x55415441);		// push r12; push r13
+	cache_addd(0x57415641);		// push r14; push r15
 	cache_addw(0xd0ff+(FC_OP1<<8));		// call rdi
+	cache_addd(0x5e415f41);		// pop r15; pop r14
+	cache_addd(0x5c415d41);		// pop r13; pop r12
 #if defined (_WIN64)
 	cache_addw(0x5f5e);			// pop rsi; pop rdi
 #endif
@@ -677,9 +812,89 @@ static void gen_run_code(void) {
 
 // return from a function
 static void gen_return_function(void) {
+	gen_release_regs(0xff);
 	cache_addb(0xc3);		// ret
 }
 
+
+#ifdef DRC_USE_SSE2_FPU
+// The fpu registers are an array of doubles, the functions below work on
+// them with sse2 instructions. The registers st and other hold indices into
+// the array; rax, r8-r11 and xmm0 are destroyed.
+
+// op reg,[rax+index*(1<<scale)+disp] where reg is a register or xmm register
+static void gen_fpu_memop(Bit8u prefix,Bit16u opcode,Bitu reg,HostReg index,Bitu scale,Bit32s disp) {
+	if (prefix) cache_addb(prefix);
+	if (reg>7) cache_addb(0x44);		// REX.R for r8-r15
+	if ((opcode&0xff)==0x0f) cache_addw(opcode);
+	else cache_addb((Bit8u)opcode);
+	cache_addb((disp ? 0x84 : 0x04)+((reg&7)<<3));
+	cache_addb((Bit8u)((scale<<6)+(index<<3)+HOST_EAX));
+	if (disp) cache_addd((Bit32u)disp);
+}
+
+// regs[st]=regs[st] op regs[other], or regs[other] op regs[st] if reverse
+// op is the sse2 opcode (0x58 addsd, 0x59 mulsd, 0x5c subsd, 0x5e divsd)
+static void gen_fpu_sse2_arith(Bit8u op,bool reverse,HostReg st,HostReg other,void* regs) {
+	gen_mov_reg_qword(HOST_EAX,(Bit64u)regs);
+	gen_fpu_memop(0xf2,0x100f,0,reverse ? other : st,3,0);		// movsd xmm0,[first]
+	gen_fpu_memop(0xf2,(Bit16u)(0x0f+(op<<8)),0,reverse ? st : other,3,0);	// op xmm0,[second]
+	gen_fpu_memop(0xf2,0x110f,0,st,3,0);		// movsd [st],xmm0
+}
+
+// regs[dest]=regs[src], tags[dest]=tags[src]
+static void gen_fpu_sse2_copy(HostReg src,HostReg dest,void* regs,void* tags) {
+	Bit32s tags_disp=(Bit32s)((Bit8u*)tags-(Bit8u*)regs);
+	gen_mov_reg_qword(HOST_EAX,(Bit64u)regs);
+	gen_fpu_memop(0xf2,0x100f,0,src,3,0);		// movsd xmm0,[src]
+	gen_fpu_memop(0xf2,0x110f,0,dest,3,0);		// movsd [dest],xmm0
+	gen_fpu_memop(0,0x8b,8,src,2,tags_disp);	// mov r8d,[tags+src*4]
+	gen_fpu_memop(0,0x89,8,dest,2,tags_disp);	// mov [tags+dest*4],r8d
+}
+
+// compare regs[st] with regs[other] and set C3/C2/C0 in the status word sw
+// like FPU_FCOM does: all three when a tag isn't valid or zero, none
+// when the values are unordered
+static void gen_fpu_sse2_compare(HostReg st,HostReg other,void* regs,void* tags,void* sw) {
+	Bit32s tags_disp=(Bit32s)((Bit8u*)tags-(Bit8u*)regs);
+	Bit32s sw_disp=(Bit32s)((Bit8u*)sw-(Bit8u*)regs);
+	gen_mov_reg_qword(HOST_EAX,(Bit64u)regs);
+	gen_fpu_memop(0,0x8b,8,st,2,tags_disp);		// mov r8d,[tags+st*4]
+	gen_fpu_memop(0,0x0b,8,other,2,tags_disp);	// or r8d,[tags+other*4]
+	gen_fpu_memop(0xf2,0x100f,0,st,3,0);		// movsd xmm0,[st]
+	gen_fpu_memop(0x66,0x2e0f,0,other,3,0);		// ucomisd xmm0,[other]
+	cache_addd(0xc1920f41);		// setb r9b
+	cache_addd(0xc29b0f41);		// setnp r10b
+	cache_addd(0xc3940f41);		// setz r11b
+	cache_addd(0xc9b60f45);		// movzx r9d,r9b
+	cache_addd(0xd2b60f45);		// movzx r10d,r10b
+	cache_addd(0xdbb60f45);		// movzx r11d,r11b
+	cache_addd(0x06e3c141);		// shl r11d,6
+	cache_addw(0x0945);			// or r9d,r11d
+	cache_addb(0xd9);
+	cache_addw(0xf741);			// neg r10d
+	cache_addb(0xda);
+	cache_addw(0x2145);			// and r9d,r10d
+	cache_addb(0xd1);
+	// r8d is 0 or 1 if both tags are valid or zero
+	cache_addd(0x02f88341);		// cmp r8d,2
+	cache_addw(0x1945);			// sbb r8d,r8d
+	cache_addb(0xc0);
+	cache_addw(0xf741);			// not r8d
+	cache_addb(0xd0);
+	cache_addd(0x45e08341);		// and r8d,0x45
+	cache_addw(0x0945);			// or r9d,r8d
+	cache_addb(0xc1);
+	cache_addd(0x08e1c141);		// shl r9d,8
+	cache_addw(0x8166);			// and word [sw],~(C3|C2|C0)
+	cache_addb(0xa0);
+	cache_addd((Bit32u)sw_disp);
+	cache_addw(0xbaff);
+	cache_addd(0x88094466);		// or word [sw],r9w
+	cache_addd((Bit32u)sw_disp);
+}
+#endif
+
 #ifdef DRC_FLAGS_INVALIDATION
 // called when a call to a function can be replaced by a
 // call to a simpler function
@@ -687,6 +902,8 @@ static void gen_return_function(void) {
 // for the targeted code
 static void gen_fill_function_ptr(Bit8u * pos,void* fct_ptr,Bitu flags_type) {
 #ifdef DRC_FLAGS_INVALIDATION_DCODE
+	// the function pointer gets overwritten by code in most cases
+	cache_delreloc(pos+6);
 	// try to avoid function calls but rather directly fill in code
 	switch (flags_type) {
 		case t_ADDb:
@@ -807,6 +1024,7 @@ static void gen_fill_function_ptr(Bit8u * pos,void* fct_ptr,Bitu flags_type) {
 			break;
 		default:
 			*(Bit64u*)(pos+6)=(Bit64u)fct_ptr;		// fill function pointer
+			cache_addreloc(pos+6,RELOC_ABS64);
 			break;
 	}
 #else
@@ -815,6 +1033,126 @@ static void gen_fill_function_ptr(Bit8u * pos,void* fct_ptr,Bitu flags_type) {
 }
 #endif
 
-static void cache_block_closing(Bit8u* block_start,Bitu block_size) { }
+static void cache_block_closing(Bit8u* block_start,Bitu block_size) {
+	gen_regcache_reset();
+}
 
 static void cache_block_before_close(void) { }
+
+#ifdef DRC_USE_REGS_ADDR
+
+// the guest register cpu_regs[index] is in, -1 if it can't be cached
+static INLINE Bits gen_regcache_slot(Bitu index,bool load) {
+	return gen_regcache_get(index/sizeof(cpu_regs.regs[0]),load);
+}
+
+// mov 16bit value from cpu_regs[index] into dest_reg (index modulo 2 must be zero)
+// 16bit moves may destroy the upper 16bit of the destination register
+static void gen_mov_regval16_to_reg(HostReg dest_reg,Bitu index) {
+	Bits slot=(index&3) ? -1 : gen_regcache_slot(index,true);
+	if (slot<0) {
+		gen_mov_word_to_reg(dest_reg,(Bit8u*)&cpu_regs+index,false);
+		return;
+	}
+	cache_addd(0xc0b70f41+(((dest_reg<<3)+4+slot)<<24));	// movzx dest_reg,r12w+slot
+}
+
+// mov 32bit value from cpu_regs[index] into dest_reg (index modulo 4 must be zero)
+static void gen_mov_regval32_to_reg(HostReg dest_reg,Bitu index) {
+	Bits slot=gen_regcache_slot(index,true);
+	if (slot<0) {
+		gen_mov_word_to_reg(dest_reg,(Bit8u*)&cpu_regs+index,true);
+		return;
+	}
+	cache_addb(0x41);
+	cache_addw(0xc08b+(((dest_reg<<3)+4+slot)<<8));	// mov dest_reg,r12d+slot
+}
+
+// move a 32bit (dword==true) or 16bit (dword==false) value from cpu_regs[index] into dest_reg (if dword==true index modulo 4 must be zero) (if dword==false index modulo 2 must be zero)
+// 16bit moves may destroy the upper 16bit of the destination register
+static void gen_mov_regword_to_reg(HostReg dest_reg,Bitu index,bool dword) {
+	if (dword) gen_mov_regval32_to_reg(dest_reg,index);
+	else gen_mov_regval16_to_reg(dest_reg,index);
+}
+
+// move an 8bit value from cpu_regs[index] into dest_reg
+// the upper 24bit of the destination register can be destroyed
+// this function does not use FC_OP1/FC_OP2 as dest_reg as these
+// registers might not be directly byte-accessible on some architectures
+static void gen_mov_regbyte_to_reg_low(HostReg dest_reg,Bitu index) {
+	Bits slot=((index&3)>1) ? -1 : gen_regcache_slot(index,true);
+	if (slot<0) {
+		gen_mov_byte_to_reg_low(dest_reg,(Bit8u*)&cpu_regs+index);
+	} else if (!(index&3)) {
+		cache_addd(0xc0b60f41+(((dest_reg<<3)+4+slot)<<24));	// movzx dest_reg,r12b+slot
+	} else {
+		cache_addd(0xc0b70f41+(((dest_reg<<3)+4+slot)<<24));	// movzx dest_reg,r12w+slot
+		cache_addw(0xe8c1+(dest_reg<<8));		// shr dest_reg,8
+		cache_addb(0x08);
+	}
+}
+
+// move an 8bit value from cpu_regs[index] into dest_reg
+// the upper 24bit of the destination register can be destroyed
+// this function can use FC_OP1/FC_OP2 as dest_reg which are
+// not directly byte-accessible on some architectures
+static void gen_mov_regbyte_to_reg_low_canuseword(HostReg dest_reg,Bitu index) {
+	gen_mov_regbyte_to_reg_low(dest_reg,index);
+}
+
+
+// add a 32bit value from cpu_regs[index] to a full register (index modulo 4 must be zero)
+static void gen_add_regval32_to_reg(HostReg reg,Bitu index) {
+	Bits slot=gen_regcache_slot(index,true);
+	if (slot<0) {
+		gen_add(reg,(Bit8u*)&cpu_regs+index);
+		return;
+	}
+	cache_addb(0x41);
+	cache_addw(0xc003+(((reg<<3)+4+slot)<<8));		// add reg,r12d+slot
+}
+
+
+// move 16bit of register into cpu_regs[index] (index modulo 2 must be zero)
+static void gen_mov_regval16_from_reg(HostReg src_reg,Bitu index) {
+	Bits slot=(index&3) ? -1 : gen_regcache_slot(index,true);
+	if (slot<0) {
+		gen_mov_word_from_reg(src_reg,(Bit8u*)&cpu_regs+index,false);
+		return;
+	}
+	cache_addd(0xc0894166+(((src_reg<<3)+4+slot)<<24));	// mov r12w+slot,src_reg
+	regcache.dirty[slot]=true;
+}
+
+// move 32bit of register into cpu_regs[index] (index modulo 4 must be zero)
+static void gen_mov_regval32_from_reg(HostReg src_reg,Bitu index) {
+	Bits slot=gen_regcache_slot(index,false);
+	if (slot<0) {
+		gen_mov_word_from_reg(src_reg,(Bit8u*)&cpu_regs+index,true);
+		return;
+	}
+	cache_addb(0x41);
+	cache_addw(0xc089+(((src_reg<<3)+4+slot)<<8));	// mov r12d+slot,src_reg
+	regcache.dirty[slot]=true;
+}
+
+// move 32bit (dword==true) or 16bit (dword==false) of a register into cpu_regs[index] (if dword==true index modulo 4 must be zero) (if dword==false index modulo 2 must be zero)
+static void gen_mov_regword_from_reg(HostReg src_reg,Bitu index,bool dword) {
+	if (dword) gen_mov_regval32_from_reg(src_reg,index);
+	else gen_mov_regval16_from_reg(src_reg,index);
+}
+
+// move the lowest 8bit of a register into cpu_regs[index]
+static void gen_mov_regbyte_from_reg_low(HostReg src_reg,Bitu index) {
+	// the high byte goes through memory
+	Bits slot=(index&3) ? -1 : gen_regcache_slot(index,true);
+	if (slot<0) {
+		gen_mov_byte_from_reg_low(src_reg,(Bit8u*)&cpu_regs+index);
+		return;
+	}
+	cache_addb(0x41);
+	cache_addw(0xc088+(((src_reg<<3)+4+slot)<<8));	// mov r12b+slot,src_reg
+	regcache.dirty[slot]=true;
+}
+
+#endif
@@ -0,0 +1,303 @@
+/*
+ *  Copyright (C) 2002-2019  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/*
+	Decoded instruction cache of the normal core.
+	The modrm forms of the ALU, TEST, MOV and LEA instructions make up
+	most of the executed code, and for those the prefixes, the modrm and
+	sib bytes, the displacement and the immediate are decoded once into
+	an entry. Later runs of the instruction only compute the effective
+	address from the cached register pointers and execute the operation.
+
+	An entry is tagged with the linear address and keeps the instruction
+	bytes, which are compared with the memory on every hit. That makes
+	self modifying code and paging changes safe without write hooks on
+	the code pages. Instructions that are not handled here, longer than
+	8 bytes or at the end of a page go through the normal decoder.
+*/
+
+#define DC_ENTRIES		2048
+
+enum {
+	DC_NONE=0,
+	DC_EG,		// ALU Ex,Gx
+	DC_GE,		// ALU Gx,Ex
+	DC_EI,		// ALU Ex,Ix
+	DC_TEST,	// TEST Ex,Gx
+	DC_MOV_EG,	// MOV Ex,Gx
+	DC_MOV_GE,	// MOV Gx,Ex
+	DC_MOV_EI,	// MOV Ex,Ix
+	DC_LEA		// LEA Gx,M
+};
+
+#define DC_MEM			0x20
+#define DC_OP(_KIND,_MEM,_WIDTH,_ALU) (((_KIND)<<6)|((_MEM)*DC_MEM)|((_WIDTH)<<3)|(_ALU))
+#define DC_MASK(_LEN) ((_LEN)>=8 ? ~(Bit64u)0 : (((Bit64u)1<<((_LEN)*8))-1))
+
+union DecodeRegister {
+	Bit8u * b;
+	Bit16u * w;
+	Bit32u * d;
+};
+
+struct DecodeEntry {
+	PhysPt cseip;				// linear address of the instruction
+	Bit8u big;					// cpu.code.big at decode time
+	Bit8u len;
+	Bit16u code;				// DC_OP of the handler, DC_NONE goes to the normal decoder
+	Bit64u bytes;				// instruction bytes and the mask of the valid ones
+	Bit64u mask;
+	DecodeRegister reg;			// Gx operand
+	DecodeRegister rm;			// Ex operand for register forms
+	PhysPt * segbase;			// effective address parts for memory forms
+	Bit32u * base;
+	Bit32u * index;
+	Bit32u disp;
+	Bit32u eamask;
+	Bit32u imm;
+	Bit8u scale;
+};
+
+static DecodeEntry decode_cache[DC_ENTRIES];
+static PhysPt decode_nobase=0;
+
+static Bit32u * const decode_ea16_base[8]={
+	&reg_ebx,&reg_ebx,&reg_ebp,&reg_ebp,&reg_esi,&reg_edi,&reg_ebp,&reg_ebx
+};
+static Bit32u * const decode_ea16_index[8]={
+	&reg_esi,&reg_edi,&reg_esi,&reg_edi,&SIBZero,&SIBZero,&SIBZero,&SIBZero
+};
+static Bit32u * const decode_ea32_base[8]={
+	&reg_eax,&reg_ecx,&reg_edx,&reg_ebx,&reg_esp,&reg_ebp,&reg_esi,&reg_edi
+};
+
+static void DecodeCache_Decode(DecodeEntry * e,PhysPt cseip,Bit64u bytes) {
+	/* Zero padded so the decoder can run past the 8 bytes and check the length afterwards */
+	Bit8u code[24];
+	for (Bitu i=0;i<24;i++) code[i]=(i<8) ? (Bit8u)(bytes >> (i*8)) : 0;
+	e->cseip=cseip;
+	e->big=cpu.code.big;
+	e->bytes=bytes;
+	e->code=DC_NONE;
+	bool opsize=cpu.code.big;
+	bool addr32=cpu.code.big;
+	Bits seg=-1;
+	Bitu pos=0;
+	for (;;pos++) {
+		if (pos>=8) {
+			e->mask=DC_MASK(8);
+			return;
+		}
+		switch (code[pos]) {
+		case 0x26:seg=es;continue;
+		case 0x2e:seg=cs;continue;
+		case 0x36:seg=ss;continue;
+		case 0x3e:seg=ds;continue;
+		case 0x64:seg=fs;continue;
+		case 0x65:seg=gs;continue;
+		case 0x66:opsize=!cpu.code.big;continue;
+		case 0x67:addr32=!cpu.code.big;continue;
+		}
+		break;
+	}
+	Bitu op=code[pos++];
+	/* Until the entry is complete it only covers the bytes looked at so far */
+	e->mask=DC_MASK(pos+1);
+	Bitu kind;Bitu alu=0;Bitu imm_size=0;bool imm_sign=false;
+	Bitu width=(op&1) ? (opsize ? 2 : 1) : 0;
+	if (op<0x40 && (op&7)<4) {
+		kind=(op&2) ? DC_GE : DC_EG;
+		alu=(op>>3)&7;
+	} else switch (op) {
+	case 0x80:case 0x82:
+		kind=DC_EI;width=0;imm_size=1;break;
+	case 0x81:
+		kind=DC_EI;imm_size=opsize ? 4 : 2;break;
+	case 0x83:
+		kind=DC_EI;imm_size=1;imm_sign=true;break;
+	case 0x84:case 0x85:
+		kind=DC_TEST;break;
+	case 0x88:
+		/* MOV Eb,Gb checks for a code segment in ds with this form */
+		if (code[pos]==0x05) return;
+	case 0x89:
+		kind=DC_MOV_EG;break;
+	case 0x8a:case 0x8b:
+		kind=DC_MOV_GE;break;
+	case 0x8d:
+		kind=DC_LEA;width=opsize ? 2 : 1;break;
+	case 0xc6:case 0xc7:
+		kind=DC_MOV_EI;imm_size=(op&1) ? (opsize ? 4 : 2) : 1;break;
+	default:
+		return;
+	}
+	Bitu rm=code[pos++];
+	if (kind==DC_EI) alu=(rm>>3)&7;
+	switch (width) {
+	case 0:e->reg.b=lookupRMregb[rm];break;
+	case 1:e->reg.w=lookupRMregw[rm];break;
+	case 2:e->reg.d=lookupRMregd[rm];break;
+	}
+	e->segbase=&decode_nobase;
+	e->base=&SIBZero;
+	e->index=&SIBZero;
+	e->disp=0;
+	e->scale=0;
+	e->eamask=0;
+	Bitu mem=0;
+	if (rm>=0xc0) {
+		if (kind==DC_LEA) return;
+		switch (width) {
+		case 0:e->rm.b=lookupRMEAregb[rm];break;
+		case 1:e->rm.w=lookupRMEAregw[rm];break;
+		case 2:e->rm.d=lookupRMEAregd[rm];break;
+		}
+	} else {
+		Bitu mod=rm>>6;
+		Bitu r=rm&7;
+		bool stack=false;
+		mem=1;
+		if (!addr32) {
+			e->eamask=0xffff;
+			if (mod==0 && r==6) {
+				e->disp=code[pos] | (code[pos+1] << 8);
+				pos+=2;
+			} else {
+				e->base=decode_ea16_base[r];
+				e->index=decode_ea16_index[r];
+				stack=(r==2 || r==3 || r==6);
+			}
+			if (mod==1) e->disp=(Bit32u)(Bit8s)code[pos++];
+			else if (mod==2) {
+				e->disp=code[pos] | (code[pos+1] << 8);
+				pos+=2;
+			}
+		} else {
+			e->eamask=0xffffffff;
+			if (r==4) {
+				Bitu sib=code[pos++];
+				e->index=SIBIndex[(sib >> 3) & 7];
+				e->scale=(Bit8u)(sib >> 6);
+				r=sib&7;
+				if (r==5 && mod==0) {
+					e->disp=code[pos] | (code[pos+1] << 8) | (code[pos+2] << 16) | ((Bit32u)code[pos+3] << 24);
+					pos+=4;
+				} else {
+					e->base=decode_ea32_base[r];
+					stack=(r==4 || r==5);
+				}
+			} else if (r==5 && mod==0) {
+				e->disp=code[pos] | (code[pos+1] << 8) | (code[pos+2] << 16) | ((Bit32u)code[pos+3] << 24);
+				pos+=4;
+			} else {
+				e->base=decode_ea32_base[r];
+				stack=(r==5);
+			}
+			if (mod==1) e->disp+=(Bit32u)(Bit8s)code[pos++];
+			else if (mod==2) {
+				e->disp+=code[pos] | (code[pos+1] << 8) | (code[pos+2] << 16) | ((Bit32u)code[pos+3] << 24);
+				pos+=4;
+			}
+		}
+		if (kind!=DC_LEA) {
+			if (seg<0) seg=stack ? ss : ds;
+			e->segbase=&Segs.phys[seg];
+		}
+	}
+	switch (imm_size) {
+	case 0:e->imm=0;break;
+	case 1:e->imm=imm_sign ? (Bit32u)(Bit8s)code[pos] : code[pos];break;
+	case 2:e->imm=code[pos] | (code[pos+1] << 8);break;
+	case 4:e->imm=code[pos] | (code[pos+1] << 8) | (code[pos+2] << 16) | ((Bit32u)code[pos+3] << 24);break;
+	}
+	pos+=imm_size;
+	if (pos>8) {
+		e->mask=DC_MASK(8);
+		return;
+	}
+	e->len=(Bit8u)pos;
+	e->mask=DC_MASK(pos);
+	e->code=DC_OP(kind,mem,width,alu);
+}
+
+#define DC_ALU_WIDTH(_ALU,_WIDTH,_INSTR,_F,_T,_LR,_SR,_LM,_SM)							\
+	case DC_OP(DC_EG,0,_WIDTH,_ALU):_INSTR(*e->rm._F,*e->reg._F,_LR,_SR);break;			\
+	case DC_OP(DC_EG,1,_WIDTH,_ALU):_INSTR(eaa,*e->reg._F,_LM,_SM);break;				\
+	case DC_OP(DC_GE,0,_WIDTH,_ALU):_INSTR(*e->reg._F,*e->rm._F,_LR,_SR);break;			\
+	case DC_OP(DC_GE,1,_WIDTH,_ALU):_INSTR(*e->reg._F,_LM(eaa),_LR,_SR);break;			\
+	case DC_OP(DC_EI,0,_WIDTH,_ALU):_INSTR(*e->rm._F,(_T)e->imm,_LR,_SR);break;			\
+	case DC_OP(DC_EI,1,_WIDTH,_ALU):_INSTR(eaa,(_T)e->imm,_LM,_SM);break;
+
+#define DC_ALU(_ALU,_B,_W,_D)															\
+	DC_ALU_WIDTH(_ALU,0,_B,b,Bit8u,LoadRb,SaveRb,LoadMb,SaveMb)						\
+	DC_ALU_WIDTH(_ALU,1,_W,w,Bit16u,LoadRw,SaveRw,LoadMw,SaveMw)					\
+	DC_ALU_WIDTH(_ALU,2,_D,d,Bit32u,LoadRd,SaveRd,LoadMd,SaveMd)
+
+#define DC_MOV_WIDTH(_WIDTH,_F,_T,_LM,_SM)												\
+	case DC_OP(DC_MOV_EG,0,_WIDTH,0):*e->rm._F=*e->reg._F;break;						\
+	case DC_OP(DC_MOV_EG,1,_WIDTH,0):_SM(eaa,*e->reg._F);break;						\
+	case DC_OP(DC_MOV_GE,0,_WIDTH,0):*e->reg._F=*e->rm._F;break;						\
+	case DC_OP(DC_MOV_GE,1,_WIDTH,0):*e->reg._F=_LM(eaa);break;						\
+	case DC_OP(DC_MOV_EI,0,_WIDTH,0):*e->rm._F=(_T)e->imm;break;						\
+	case DC_OP(DC_MOV_EI,1,_WIDTH,0):_SM(eaa,(_T)e->imm);break;
+
+/* Runs the instruction at core.cseip from the cache, false if it has to be decoded normally */
+static bool DecodeCache_Run(void) {
+	PhysPt cseip=core.cseip;
+	if (GCC_UNLIKELY((cseip & 4095)>(4096-8))) return false;
+	HostPt tlb_addr=get_tlb_read(cseip);
+	if (GCC_UNLIKELY(!tlb_addr)) return false;
+	Bit64u bytes=host_readd(tlb_addr+cseip) | ((Bit64u)host_readd(tlb_addr+cseip+4) << 32);
+	DecodeEntry * e=&decode_cache[(cseip ^ (cseip >> 12)) & (DC_ENTRIES-1)];
+	if (e->cseip!=cseip || e->big!=cpu.code.big || ((bytes ^ e->bytes) & e->mask)) {
+		DecodeCache_Decode(e,cseip,bytes);
+	}
+	if (!e->code) return false;
+	core.cseip+=e->len;
+	PhysPt eaa=*e->segbase+((e->disp+*e->base+(*e->index << e->scale)) & e->eamask);
+	switch (e->code) {
+	DC_ALU(0,ADDB,ADDW,ADDD)
+	DC_ALU(1,ORB,ORW,ORD)
+	DC_ALU(2,ADCB,ADCW,ADCD)
+	DC_ALU(3,SBBB,SBBW,SBBD)
+	DC_ALU(4,ANDB,ANDW,ANDD)
+	DC_ALU(5,SUBB,SUBW,SUBD)
+	DC_ALU(6,XORB,XORW,XORD)
+	DC_ALU(7,CMPB,CMPW,CMPD)
+	case DC_OP(DC_TEST,0,0,0):TESTB(*e->rm.b,*e->reg.b,LoadRb,SaveRb);break;
+	case DC_OP(DC_TEST,1,0,0):TESTB(eaa,*e->reg.b,LoadMb,SaveMb);break;
+	case DC_OP(DC_TEST,0,1,0):TESTW(*e->rm.w,*e->reg.w,LoadRw,SaveRw);break;
+	case DC_OP(DC_TEST,1,1,0):TESTW(eaa,*e->reg.w,LoadMw,SaveMw);break;
+	case DC_OP(DC_TEST,0,2,0):TESTD(*e->rm.d,*e->reg.d,LoadRd,SaveRd);break;
+	case DC_OP(DC_TEST,1,2,0):TESTD(eaa,*e->reg.d,LoadMd,SaveMd);break;
+	DC_MOV_WIDTH(0,b,Bit8u,LoadMb,SaveMb)
+	DC_MOV_WIDTH(1,w,Bit16u,LoadMw,SaveMw)
+	DC_MOV_WIDTH(2,d,Bit32u,LoadMd,SaveMd)
+	case DC_OP(DC_LEA,1,1,0):*e->reg.w=(Bit16u)eaa;break;
+	case DC_OP(DC_LEA,1,2,0):*e->reg.d=(Bit32u)eaa;break;
+	}
+	return true;
+}
+
+/* Hook for the top of the run loop of the normal core, _NEXT goes on
+   with the next instruction after a run from the cache */
+#define DECODE_CACHE_CHECK(_NEXT)					\
+	if (CPU_DecodeCache && DecodeCache_Run()) {		\
+		SAVEIP;										\
+		_NEXT;										\
+	}
@@ -141,21 +141,30 @@
 	}																		\
 }
 
+// the threaded cores give each handler a label, see threaded.h
+#define CASE_LABEL(_NAME)
+
+// how a handler goes on to the next instruction, threaded.h
+// makes each of them dispatch on its own
+#define DISPATCH			break					// the ip gets saved
+#define DISPATCH_NEWIP		continue				// reg_eip is set already
+#define DISPATCH_PREFIX		goto restart_opcode		// the opcode after a prefix
+
 #define CASE_W(_WHICH)							\
-	case (OPCODE_NONE+_WHICH):
+	case (OPCODE_NONE+_WHICH): CASE_LABEL(op_w_ ## _WHICH)
 
 #define CASE_D(_WHICH)							\
-	case (OPCODE_SIZE+_WHICH):
+	case (OPCODE_SIZE+_WHICH): CASE_LABEL(op_d_ ## _WHICH)
 
 #define CASE_B(_WHICH)							\
 	CASE_W(_WHICH)								\
 	CASE_D(_WHICH)
 
 #define CASE_0F_W(_WHICH)						\
-	case ((OPCODE_0F|OPCODE_NONE)+_WHICH):
+	case ((OPCODE_0F|OPCODE_NONE)+_WHICH): CASE_LABEL(op_0f_w_ ## _WHICH)
 
 #define CASE_0F_D(_WHICH)						\
-	case ((OPCODE_0F|OPCODE_SIZE)+_WHICH):
+	case ((OPCODE_0F|OPCODE_SIZE)+_WHICH): CASE_LABEL(op_0f_d_ ## _WHICH)
 
 #define CASE_0F_B(_WHICH)						\
 	CASE_0F_W(_WHICH)							\
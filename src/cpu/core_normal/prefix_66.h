@@ -17,145 +17,145 @@
  */
 
 	CASE_D(0x01)												/* ADD Ed,Gd */
-		RMEdGd(ADDD);break;	
+		RMEdGd(ADDD);DISPATCH;	
 	CASE_D(0x03)												/* ADD Gd,Ed */
-		RMGdEd(ADDD);break;
+		RMGdEd(ADDD);DISPATCH;
 	CASE_D(0x05)												/* ADD EAX,Id */
-		EAXId(ADDD);break;
+		EAXId(ADDD);DISPATCH;
 	CASE_D(0x06)												/* PUSH ES */		
-		Push_32(SegValue(es));break;
+		Push_32(SegValue(es));DISPATCH;
 	CASE_D(0x07)												/* POP ES */
 		if (CPU_PopSeg(es,true)) RUNEXCEPTION();
-		break;
+		DISPATCH;
 	CASE_D(0x09)												/* OR Ed,Gd */
-		RMEdGd(ORD);break;
+		RMEdGd(ORD);DISPATCH;
 	CASE_D(0x0b)												/* OR Gd,Ed */
-		RMGdEd(ORD);break;
+		RMGdEd(ORD);DISPATCH;
 	CASE_D(0x0d)												/* OR EAX,Id */
-		EAXId(ORD);break;
+		EAXId(ORD);DISPATCH;
 	CASE_D(0x0e)												/* PUSH CS */		
-		Push_32(SegValue(cs));break;
+		Push_32(SegValue(cs));DISPATCH;
 	CASE_D(0x11)												/* ADC Ed,Gd */
-		RMEdGd(ADCD);break;	
+		RMEdGd(ADCD);DISPATCH;	
 	CASE_D(0x13)												/* ADC Gd,Ed */
-		RMGdEd(ADCD);break;
+		RMGdEd(ADCD);DISPATCH;
 	CASE_D(0x15)												/* ADC EAX,Id */
-		EAXId(ADCD);break;
+		EAXId(ADCD);DISPATCH;
 	CASE_D(0x16)												/* PUSH SS */
-		Push_32(SegValue(ss));break;
+		Push_32(SegValue(ss));DISPATCH;
 	CASE_D(0x17)												/* POP SS */
 		if (CPU_PopSeg(ss,true)) RUNEXCEPTION();
 		CPU_Cycles++;
-		break;
+		DISPATCH;
 	CASE_D(0x19)												/* SBB Ed,Gd */
-		RMEdGd(SBBD);break;
+		RMEdGd(SBBD);DISPATCH;
 	CASE_D(0x1b)												/* SBB Gd,Ed */
-		RMGdEd(SBBD);break;
+		RMGdEd(SBBD);DISPATCH;
 	CASE_D(0x1d)												/* SBB EAX,Id */
-		EAXId(SBBD);break;
+		EAXId(SBBD);DISPATCH;
 	CASE_D(0x1e)												/* PUSH DS */		
-		Push_32(SegValue(ds));break;
+		Push_32(SegValue(ds));DISPATCH;
 	CASE_D(0x1f)												/* POP DS */
 		if (CPU_PopSeg(ds,true)) RUNEXCEPTION();
-		break;
+		DISPATCH;
 	CASE_D(0x21)												/* AND Ed,Gd */
-		RMEdGd(ANDD);break;	
+		RMEdGd(ANDD);DISPATCH;	
 	CASE_D(0x23)												/* AND Gd,Ed */
-		RMGdEd(ANDD);break;
+		RMGdEd(ANDD);DISPATCH;
 	CASE_D(0x25)												/* AND EAX,Id */
-		EAXId(ANDD);break;
+		EAXId(ANDD);DISPATCH;
 	CASE_D(0x29)												/* SUB Ed,Gd */
-		RMEdGd(SUBD);break;
+		RMEdGd(SUBD);DISPATCH;
 	CASE_D(0x2b)												/* SUB Gd,Ed */
-		RMGdEd(SUBD);break;
+		RMGdEd(SUBD);DISPATCH;
 	CASE_D(0x2d)												/* SUB EAX,Id */
-		EAXId(SUBD);break;
+		EAXId(SUBD);DISPATCH;
 	CASE_D(0x31)												/* XOR Ed,Gd */
-		RMEdGd(XORD);break;	
+		RMEdGd(XORD);DISPATCH;	
 	CASE_D(0x33)												/* XOR Gd,Ed */
-		RMGdEd(XORD);break;
+		RMGdEd(XORD);DISPATCH;
 	CASE_D(0x35)												/* XOR EAX,Id */
-		EAXId(XORD);break;
+		EAXId(XORD);DISPATCH;
 	CASE_D(0x39)												/* CMP Ed,Gd */
-		RMEdGd(CMPD);break;
+		RMEdGd(CMPD);DISPATCH;
 	CASE_D(0x3b)												/* CMP Gd,Ed */
-		RMGdEd(CMPD);break;
+		RMGdEd(CMPD);DISPATCH;
 	CASE_D(0x3d)												/* CMP EAX,Id */
-		EAXId(CMPD);break;
+		EAXId(CMPD);DISPATCH;
 	CASE_D(0x40)												/* INC EAX */
-		INCD(reg_eax,LoadRd,SaveRd);break;
+		INCD(reg_eax,LoadRd,SaveRd);DISPATCH;
 	CASE_D(0x41)												/* INC ECX */
-		INCD(reg_ecx,LoadRd,SaveRd);break;
+		INCD(reg_ecx,LoadRd,SaveRd);DISPATCH;
 	CASE_D(0x42)												/* INC EDX */
-		INCD(reg_edx,LoadRd,SaveRd);break;
+		INCD(reg_edx,LoadRd,SaveRd);DISPATCH;
 	CASE_D(0x43)												/* INC EBX */
-		INCD(reg_ebx,LoadRd,SaveRd);break;
+		INCD(reg_ebx,LoadRd,SaveRd);DISPATCH;
 	CASE_D(0x44)												/* INC ESP */
-		INCD(reg_esp,LoadRd,SaveRd);break;
+		INCD(reg_esp,LoadRd,SaveRd);DISPATCH;
 	CASE_D(0x45)												/* INC EBP */
-		INCD(reg_ebp,LoadRd,SaveRd);break;
+		INCD(reg_ebp,LoadRd,SaveRd);DISPATCH;
 	CASE_D(0x46)												/* INC ESI */
-		INCD(reg_esi,LoadRd,SaveRd);break;
+		INCD(reg_esi,LoadRd,SaveRd);DISPATCH;
 	CASE_D(0x47)												/* INC EDI */
-		INCD(reg_edi,LoadRd,SaveRd);break;
+		INCD(reg_edi,LoadRd,SaveRd);DISPATCH;
 	CASE_D(0x48)												/* DEC EAX */
-		DECD(reg_eax,LoadRd,SaveRd);break;
+		DECD(reg_eax,LoadRd,SaveRd);DISPATCH;
 	CASE_D(0x49)												/* DEC ECX */
-		DECD(reg_ecx,LoadRd,SaveRd);break;
+		DECD(reg_ecx,LoadRd,SaveRd);DISPATCH;
 	CASE_D(0x4a)												/* DEC EDX */
-		DECD(reg_edx,LoadRd,SaveRd);break;
+		DECD(reg_edx,LoadRd,SaveRd);DISPATCH;
 	CASE_D(0x4b)												/* DEC EBX */
-		DECD(reg_ebx,LoadRd,SaveRd);break;
+		DECD(reg_ebx,LoadRd,SaveRd);DISPATCH;
 	CASE_D(0x4c)												/* DEC ESP */
-		DECD(reg_esp,LoadRd,SaveRd);break;
+		DECD(reg_esp,LoadRd,SaveRd);DISPATCH;
 	CASE_D(0x4d)												/* DEC EBP */
-		DECD(reg_ebp,LoadRd,SaveRd);break;
+		DECD(reg_ebp,LoadRd,SaveRd);DISPATCH;
 	CASE_D(0x4e)												/* DEC ESI */
-		DECD(reg_esi,LoadRd,SaveRd);break;
+		DECD(reg_esi,LoadRd,SaveRd);DISPATCH;
 	CASE_D(0x4f)												/* DEC EDI */
-		DECD(reg_edi,LoadRd,SaveRd);break;
+		DECD(reg_edi,LoadRd,SaveRd);DISPATCH;
 	CASE_D(0x50)												/* PUSH EAX */
-		Push_32(reg_eax);break;
+		Push_32(reg_eax);DISPATCH;
 	CASE_D(0x51)												/* PUSH ECX */
-		Push_32(reg_ecx);break;
+		Push_32(reg_ecx);DISPATCH;
 	CASE_D(0x52)												/* PUSH EDX */
-		Push_32(reg_edx);break;
+		Push_32(reg_edx);DISPATCH;
 	CASE_D(0x53)												/* PUSH EBX */
-		Push_32(reg_ebx);break;
+		Push_32(reg_ebx);DISPATCH;
 	CASE_D(0x54)												/* PUSH ESP */
-		Push_32(reg_esp);break;
+		Push_32(reg_esp);DISPATCH;
 	CASE_D(0x55)												/* PUSH EBP */
-		Push_32(reg_ebp);break;
+		Push_32(reg_ebp);DISPATCH;
 	CASE_D(0x56)												/* PUSH ESI */
-		Push_32(reg_esi);break;
+		Push_32(reg_esi);DISPATCH;
 	CASE_D(0x57)												/* PUSH EDI */
-		Push_32(reg_edi);break;
+		Push_32(reg_edi);DISPATCH;
 	CASE_D(0x58)												/* POP EAX */
-		reg_eax=Pop_32();break;
+		reg_eax=Pop_32();DISPATCH;
 	CASE_D(0x59)												/* POP ECX */
-		reg_ecx=Pop_32();break;
+		reg_ecx=Pop_32();DISPATCH;
 	CASE_D(0x5a)												/* POP EDX */
-		reg_edx=Pop_32();break;
+		reg_edx=Pop_32();DISPATCH;
 	CASE_D(0x5b)												/* POP EBX */
-		reg_ebx=Pop_32();break;
+		reg_ebx=Pop_32();DISPATCH;
 	CASE_D(0x5c)												/* POP ESP */
-		reg_esp=Pop_32();break;
+		reg_esp=Pop_32();DISPATCH;
 	CASE_D(0x5d)												/* POP EBP */
-		reg_ebp=Pop_32();break;
+		reg_ebp=Pop_32();DISPATCH;
 	CASE_D(0x5e)												/* POP ESI */
-		reg_esi=Pop_32();break;
+		reg_esi=Pop_32();DISPATCH;
 	CASE_D(0x5f)												/* POP EDI */
-		reg_edi=Pop_32();break;
+		reg_edi=Pop_32();DISPATCH;
 	CASE_D(0x60)												/* PUSHAD */
 	{
 		Bitu tmpesp = reg_esp;
 		Push_32(reg_eax);Push_32(reg_ecx);Push_32(reg_edx);Push_32(reg_ebx);
 		Push_32(tmpesp);Push_32(reg_ebp);Push_32(reg_esi);Push_32(reg_edi);
-	}; break;
+	}; DISPATCH;
 	CASE_D(0x61)												/* POPAD */
 		reg_edi=Pop_32();reg_esi=Pop_32();reg_ebp=Pop_32();Pop_32();//Don't save ESP
 		reg_ebx=Pop_32();reg_edx=Pop_32();reg_ecx=Pop_32();reg_eax=Pop_32();
-		break;
+		DISPATCH;
 	CASE_D(0x62)												/* BOUND Ed */
 		{
 			Bit32s bound_min, bound_max;
@@ -166,7 +166,7 @@
 				EXCEPTION(5);
 			}
 		}
-		break;
+		DISPATCH;
 	CASE_D(0x63)												/* ARPL Ed,Rd */
 		{
 			if (((cpu.pmode) && (reg_flags & FLAG_VM)) || (!cpu.pmode)) goto illegal_opcode;
@@ -181,55 +181,55 @@
 				SaveMd(eaa,(Bit32u)new_sel);
 			}
 		}
-		break;
+		DISPATCH;
 	CASE_D(0x68)												/* PUSH Id */
-		Push_32(Fetchd());break;
+		Push_32(Fetchd());DISPATCH;
 	CASE_D(0x69)												/* IMUL Gd,Ed,Id */
 		RMGdEdOp3(DIMULD,Fetchds());
-		break;
+		DISPATCH;
 	CASE_D(0x6a)												/* PUSH Ib */
-		Push_32(Fetchbs());break;
+		Push_32(Fetchbs());DISPATCH;
 	CASE_D(0x6b)												/* IMUL Gd,Ed,Ib */
 		RMGdEdOp3(DIMULD,Fetchbs());
-		break;
+		DISPATCH;
 	CASE_D(0x6d)												/* INSD */
 		if (CPU_IO_Exception(reg_dx,4)) RUNEXCEPTION();
-		DoString(R_INSD);break;
+		DoString(R_INSD);DISPATCH;
 	CASE_D(0x6f)												/* OUTSD */
 		if (CPU_IO_Exception(reg_dx,4)) RUNEXCEPTION();
-		DoString(R_OUTSD);break;
+		DoString(R_OUTSD);DISPATCH;
 	CASE_D(0x70)												/* JO */
-		JumpCond32_b(TFLG_O);break;
+		JumpCond32_b(TFLG_O);DISPATCH;
 	CASE_D(0x71)												/* JNO */
-		JumpCond32_b(TFLG_NO);break;
+		JumpCond32_b(TFLG_NO);DISPATCH;
 	CASE_D(0x72)												/* JB */
-		JumpCond32_b(TFLG_B);break;
+		JumpCond32_b(TFLG_B);DISPATCH;
 	CASE_D(0x73)												/* JNB */
-		JumpCond32_b(TFLG_NB);break;
+		JumpCond32_b(TFLG_NB);DISPATCH;
 	CASE_D(0x74)												/* JZ */
-  		JumpCond32_b(TFLG_Z);break;
+  		JumpCond32_b(TFLG_Z);DISPATCH;
 	CASE_D(0x75)												/* JNZ */
-		JumpCond32_b(TFLG_NZ);break;
+		JumpCond32_b(TFLG_NZ);DISPATCH;
 	CASE_D(0x76)												/* JBE */
-		JumpCond32_b(TFLG_BE);break;
+		JumpCond32_b(TFLG_BE);DISPATCH;
 	CASE_D(0x77)												/* JNBE */
-		JumpCond32_b(TFLG_NBE);break;
+		JumpCond32_b(TFLG_NBE);DISPATCH;
 	CASE_D(0x78)												/* JS */
-		JumpCond32_b(TFLG_S);break;
+		JumpCond32_b(TFLG_S);DISPATCH;
 	CASE_D(0x79)												/* JNS */
-		JumpCond32_b(TFLG_NS);break;
+		JumpCond32_b(TFLG_NS);DISPATCH;
 	CASE_D(0x7a)												/* JP */
-		JumpCond32_b(TFLG_P);break;
+		JumpCond32_b(TFLG_P);DISPATCH;
 	CASE_D(0x7b)												/* JNP */
-		JumpCond32_b(TFLG_NP);break;
+		JumpCond32_b(TFLG_NP);DISPATCH;
 	CASE_D(0x7c)												/* JL */
-		JumpCond32_b(TFLG_L);break;
+		JumpCond32_b(TFLG_L);DISPATCH;
 	CASE_D(0x7d)												/* JNL */
-		JumpCond32_b(TFLG_NL);break;
+		JumpCond32_b(TFLG_NL);DISPATCH;
 	CASE_D(0x7e)												/* JLE */
-		JumpCond32_b(TFLG_LE);break;
+		JumpCond32_b(TFLG_LE);DISPATCH;
 	CASE_D(0x7f)												/* JNLE */
-		JumpCond32_b(TFLG_NLE);break;
+		JumpCond32_b(TFLG_NLE);DISPATCH;
 	CASE_D(0x81)												/* Grpl Ed,Id */
 		{
 			GetRM;Bitu which=(rm>>3)&7;
@@ -259,7 +259,7 @@
 				}
 			}
 		}
-		break;
+		DISPATCH;
 	CASE_D(0x83)												/* Grpl Ed,Ix */
 		{
 			GetRM;Bitu which=(rm>>3)&7;
@@ -289,29 +289,29 @@
 				}
 			}
 		}
-		break;
+		DISPATCH;
 	CASE_D(0x85)												/* TEST Ed,Gd */
-		RMEdGd(TESTD);break;
+		RMEdGd(TESTD);DISPATCH;
 	CASE_D(0x87)												/* XCHG Ed,Gd */
 		{	
 			GetRMrd;Bit32u oldrmrd=*rmrd;
 			if (rm >= 0xc0 ) {GetEArd;*rmrd=*eard;*eard=oldrmrd;}
 			else {GetEAa;*rmrd=LoadMd(eaa);SaveMd(eaa,oldrmrd);}
-			break;
+			DISPATCH;
 		}
 	CASE_D(0x89)												/* MOV Ed,Gd */
 		{	
 			GetRMrd;
 			if (rm >= 0xc0 ) {GetEArd;*eard=*rmrd;}
 			else {GetEAa;SaveMd(eaa,*rmrd);}
-			break;
+			DISPATCH;
 		}
 	CASE_D(0x8b)												/* MOV Gd,Ed */
 		{	
 			GetRMrd;
 			if (rm >= 0xc0 ) {GetEArd;*rmrd=*eard;}
 			else {GetEAa;*rmrd=LoadMd(eaa);}
-			break;
+			DISPATCH;
 		}
 	CASE_D(0x8c)												/* Mov Ew,Sw */
 			{
@@ -335,7 +335,7 @@
 				}
 				if (rm >= 0xc0 ) {GetEArd;*eard=val;}
 				else {GetEAa;SaveMw(eaa,val);}
-				break;
+				DISPATCH;
 			}	
 	CASE_D(0x8d)												/* LEA Gd */
 		{
@@ -347,7 +347,7 @@
 			} else {
 				*rmrd=(Bit32u)(*EATable[rm])();
 			}
-			break;
+			DISPATCH;
 		}
 	CASE_D(0x8f)												/* POP Ed */
 		{
@@ -355,34 +355,34 @@
 			GetRM;
 			if (rm >= 0xc0 ) {GetEArd;*eard=val;}
 			else {GetEAa;SaveMd(eaa,val);}
-			break;
+			DISPATCH;
 		}
 	CASE_D(0x91)												/* XCHG ECX,EAX */
-		{ Bit32u temp=reg_eax;reg_eax=reg_ecx;reg_ecx=temp;break;}
+		{ Bit32u temp=reg_eax;reg_eax=reg_ecx;reg_ecx=temp;DISPATCH;}
 	CASE_D(0x92)												/* XCHG EDX,EAX */
-		{ Bit32u temp=reg_eax;reg_eax=reg_edx;reg_edx=temp;break;}
-		break;
+		{ Bit32u temp=reg_eax;reg_eax=reg_edx;reg_edx=temp;DISPATCH;}
+		DISPATCH;
 	CASE_D(0x93)												/* XCHG EBX,EAX */
-		{ Bit32u temp=reg_eax;reg_eax=reg_ebx;reg_ebx=temp;break;}
-		break;
+		{ Bit32u temp=reg_eax;reg_eax=reg_ebx;reg_ebx=temp;DISPATCH;}
+		DISPATCH;
 	CASE_D(0x94)												/* XCHG ESP,EAX */
-		{ Bit32u temp=reg_eax;reg_eax=reg_esp;reg_esp=temp;break;}
-		break;
+		{ Bit32u temp=reg_eax;reg_eax=reg_esp;reg_esp=temp;DISPATCH;}
+		DISPATCH;
 	CASE_D(0x95)												/* XCHG EBP,EAX */
-		{ Bit32u temp=reg_eax;reg_eax=reg_ebp;reg_ebp=temp;break;}
-		break;
+		{ Bit32u temp=reg_eax;reg_eax=reg_ebp;reg_ebp=temp;DISPATCH;}
+		DISPATCH;
 	CASE_D(0x96)												/* XCHG ESI,EAX */
-		{ Bit32u temp=reg_eax;reg_eax=reg_esi;reg_esi=temp;break;}
-		break;
+		{ Bit32u temp=reg_eax;reg_eax=reg_esi;reg_esi=temp;DISPATCH;}
+		DISPATCH;
 	CASE_D(0x97)												/* XCHG EDI,EAX */
-		{ Bit32u temp=reg_eax;reg_eax=reg_edi;reg_edi=temp;break;}
-		break;
+		{ Bit32u temp=reg_eax;reg_eax=reg_edi;reg_edi=temp;DISPATCH;}
+		DISPATCH;
 	CASE_D(0x98)												/* CWDE */
-		reg_eax=(Bit16s)reg_ax;break;
+		reg_eax=(Bit16s)reg_ax;DISPATCH;
 	CASE_D(0x99)												/* CDQ */
 		if (reg_eax & 0x80000000) reg_edx=0xffffffff;
 		else reg_edx=0;
-		break;
+		DISPATCH;
 	CASE_D(0x9a)												/* CALL FAR Ad */
 		{ 
 			Bit32u newip=Fetchd();Bit16u newcs=Fetchw();
@@ -394,11 +394,11 @@
 				return CBRET_NONE;
 			}
 #endif
-			continue;
+			DISPATCH_NEWIP;
 		}
 	CASE_D(0x9c)												/* PUSHFD */
 		if (CPU_PUSHF(true)) RUNEXCEPTION();
-		break;
+		DISPATCH;
 	CASE_D(0x9d)												/* POPFD */
 		if (CPU_POPF(true)) RUNEXCEPTION();
 #if CPU_TRAP_CHECK
@@ -410,56 +410,56 @@
 #if CPU_PIC_CHECK
 		if (GETFLAG(IF) && PIC_IRQCheck) goto decode_end;
 #endif
-		break;
+		DISPATCH;
 	CASE_D(0xa1)												/* MOV EAX,Od */
 		{
 			GetEADirect;
 			reg_eax=LoadMd(eaa);
 		}
-		break;
+		DISPATCH;
 	CASE_D(0xa3)												/* MOV Od,EAX */
 		{
 			GetEADirect;
 			SaveMd(eaa,reg_eax);
 		}
-		break;
+		DISPATCH;
 	CASE_D(0xa5)												/* MOVSD */
-		DoString(R_MOVSD);break;
+		DoString(R_MOVSD);DISPATCH;
 	CASE_D(0xa7)												/* CMPSD */
-		DoString(R_CMPSD);break;
+		DoString(R_CMPSD);DISPATCH;
 	CASE_D(0xa9)												/* TEST EAX,Id */
-		EAXId(TESTD);break;
+		EAXId(TESTD);DISPATCH;
 	CASE_D(0xab)												/* STOSD */
-		DoString(R_STOSD);break;
+		DoString(R_STOSD);DISPATCH;
 	CASE_D(0xad)												/* LODSD */
-		DoString(R_LODSD);break;
+		DoString(R_LODSD);DISPATCH;
 	CASE_D(0xaf)												/* SCASD */
-		DoString(R_SCASD);break;
+		DoString(R_SCASD);DISPATCH;
 	CASE_D(0xb8)												/* MOV EAX,Id */
-		reg_eax=Fetchd();break;
+		reg_eax=Fetchd();DISPATCH;
 	CASE_D(0xb9)												/* MOV ECX,Id */
-		reg_ecx=Fetchd();break;
+		reg_ecx=Fetchd();DISPATCH;
 	CASE_D(0xba)												/* MOV EDX,Iw */
-		reg_edx=Fetchd();break;
+		reg_edx=Fetchd();DISPATCH;
 	CASE_D(0xbb)												/* MOV EBX,Id */
-		reg_ebx=Fetchd();break;
+		reg_ebx=Fetchd();DISPATCH;
 	CASE_D(0xbc)												/* MOV ESP,Id */
-		reg_esp=Fetchd();break;
+		reg_esp=Fetchd();DISPATCH;
 	CASE_D(0xbd)												/* MOV EBP.Id */
-		reg_ebp=Fetchd();break;
+		reg_ebp=Fetchd();DISPATCH;
 	CASE_D(0xbe)												/* MOV ESI,Id */
-		reg_esi=Fetchd();break;
+		reg_esi=Fetchd();DISPATCH;
 	CASE_D(0xbf)												/* MOV EDI,Id */
-		reg_edi=Fetchd();break;
+		reg_edi=Fetchd();DISPATCH;
 	CASE_D(0xc1)												/* GRP2 Ed,Ib */
-		GRP2D(Fetchb());break;
+		GRP2D(Fetchb());DISPATCH;
 	CASE_D(0xc2)												/* RETN Iw */
 		reg_eip=Pop_32();
 		reg_esp+=Fetchw();
-		continue;
+		DISPATCH_NEWIP;
 	CASE_D(0xc3)												/* RETN */
 		reg_eip=Pop_32();
-		continue;
+		DISPATCH_NEWIP;
 	CASE_D(0xc4)												/* LES */
 		{	
 			GetRMrd;
@@ -467,7 +467,7 @@
 			GetEAa;
 			if (CPU_SetSegGeneral(es,LoadMw(eaa+4))) RUNEXCEPTION();
 			*rmrd=LoadMd(eaa);
-			break;
+			DISPATCH;
 		}
 	CASE_D(0xc5)												/* LDS */
 		{	
@@ -476,14 +476,14 @@
 			GetEAa;
 			if (CPU_SetSegGeneral(ds,LoadMw(eaa+4))) RUNEXCEPTION();
 			*rmrd=LoadMd(eaa);
-			break;
+			DISPATCH;
 		}
 	CASE_D(0xc7)												/* MOV Ed,Id */
 		{
 			GetRM;
 			if (rm >= 0xc0) {GetEArd;*eard=Fetchd();}
 			else {GetEAa;SaveMd(eaa,Fetchd());}
-			break;
+			DISPATCH;
 		}
 	CASE_D(0xc8)												/* ENTER Iw,Ib */
 		{
@@ -491,24 +491,24 @@
 			Bitu level=Fetchb();
 			CPU_ENTER(true,bytes,level);
 		}
-		break;
+		DISPATCH;
 	CASE_D(0xc9)												/* LEAVE */
 		reg_esp&=cpu.stack.notmask;
 		reg_esp|=(reg_ebp&cpu.stack.mask);
 		reg_ebp=Pop_32();
-		break;
+		DISPATCH;
 	CASE_D(0xca)												/* RETF Iw */
 		{ 
 			Bitu words=Fetchw();
 			FillFlags();
 			CPU_RET(true,words,GETIP);
-			continue;
+			DISPATCH_NEWIP;
 		}
 	CASE_D(0xcb)												/* RETF */			
 		{ 
 			FillFlags();
             CPU_RET(true,0,GETIP);
-			continue;
+			DISPATCH_NEWIP;
 		}
 	CASE_D(0xcf)												/* IRET */
 		{
@@ -522,49 +522,49 @@
 #if CPU_PIC_CHECK
 			if (GETFLAG(IF) && PIC_IRQCheck) return CBRET_NONE;
 #endif
-			continue;
+			DISPATCH_NEWIP;
 		}
 	CASE_D(0xd1)												/* GRP2 Ed,1 */
-		GRP2D(1);break;
+		GRP2D(1);DISPATCH;
 	CASE_D(0xd3)												/* GRP2 Ed,CL */
-		GRP2D(reg_cl);break;
+		GRP2D(reg_cl);DISPATCH;
 	CASE_D(0xe0)												/* LOOPNZ */
 		if (TEST_PREFIX_ADDR) {
 			JumpCond32_b(--reg_ecx && !get_ZF());
 		} else {
 			JumpCond32_b(--reg_cx && !get_ZF());
 		}
-		break;
+		DISPATCH;
 	CASE_D(0xe1)												/* LOOPZ */
 		if (TEST_PREFIX_ADDR) {
 			JumpCond32_b(--reg_ecx && get_ZF());
 		} else {
 			JumpCond32_b(--reg_cx && get_ZF());
 		}
-		break;
+		DISPATCH;
 	CASE_D(0xe2)												/* LOOP */
 		if (TEST_PREFIX_ADDR) {	
 			JumpCond32_b(--reg_ecx);
 		} else {
 			JumpCond32_b(--reg_cx);
 		}
-		break;
+		DISPATCH;
 	CASE_D(0xe3)												/* JCXZ */
 		JumpCond32_b(!(reg_ecx & AddrMaskTable[core.prefixes& PREFIX_ADDR]));
-		break;
+		DISPATCH;
 	CASE_D(0xe5)												/* IN EAX,Ib */
 		{
 			Bitu port=Fetchb();
 			if (CPU_IO_Exception(port,4)) RUNEXCEPTION();
 			reg_eax=IO_ReadD(port);
-			break;
+			DISPATCH;
 		}
 	CASE_D(0xe7)												/* OUT Ib,EAX */
 		{
 			Bitu port=Fetchb();
 			if (CPU_IO_Exception(port,4)) RUNEXCEPTION();
 			IO_WriteD(port,reg_eax);
-			break;
+			DISPATCH;
 		}
 	CASE_D(0xe8)												/* CALL Jd */
 		{ 
@@ -572,14 +572,14 @@
 			SAVEIP;
 			Push_32(reg_eip);
 			reg_eip+=addip;
-			continue;
+			DISPATCH_NEWIP;
 		}
 	CASE_D(0xe9)												/* JMP Jd */
 		{ 
 			Bit32s addip=Fetchds();
 			SAVEIP;
 			reg_eip+=addip;
-			continue;
+			DISPATCH_NEWIP;
 		}
 	CASE_D(0xea)												/* JMP Ad */
 		{ 
@@ -593,21 +593,22 @@
 				return CBRET_NONE;
 			}
 #endif
-			continue;
+			DISPATCH_NEWIP;
 		}
 	CASE_D(0xeb)												/* JMP Jb */
 		{ 
 			Bit32s addip=Fetchbs();
 			SAVEIP;
 			reg_eip+=addip;
-			continue;
+			if (addip<0) POLL_LOOP_CHECK(addip);
+			DISPATCH_NEWIP;
 		}
 	CASE_D(0xed)												/* IN EAX,DX */
 		reg_eax=IO_ReadD(reg_dx);
-		break;
+		DISPATCH;
 	CASE_D(0xef)												/* OUT DX,EAX */
 		IO_WriteD(reg_dx,reg_eax);
-		break;
+		DISPATCH;
 	CASE_D(0xf7)												/* GRP3 Ed(,Id) */
 		{ 
 			GetRM;Bitu which=(rm>>3)&7;
@@ -650,7 +651,7 @@
 				RMEd(IDIVD);
 				break;
 			}
-			break;
+			DISPATCH;
 		}
 	CASE_D(0xff)												/* GRP 5 Ed */
 		{
@@ -666,7 +667,7 @@
 				if (rm >= 0xc0 ) {GetEArd;reg_eip=*eard;}
 				else {GetEAa;reg_eip=LoadMd(eaa);}
 				Push_32(GETIP);
-				continue;
+				DISPATCH_NEWIP;
 			case 0x03:											/* CALL FAR Ed */
 				{
 					if (rm >= 0xc0) goto illegal_opcode;
@@ -681,12 +682,12 @@
 						return CBRET_NONE;
 					}
 #endif
-					continue;
+					DISPATCH_NEWIP;
 				}
 			case 0x04:											/* JMP NEAR Ed */	
 				if (rm >= 0xc0 ) {GetEArd;reg_eip=*eard;}
 				else {GetEAa;reg_eip=LoadMd(eaa);}
-				continue;
+				DISPATCH_NEWIP;
 			case 0x05:											/* JMP FAR Ed */	
 				{
 					if (rm >= 0xc0) goto illegal_opcode;
@@ -701,7 +702,7 @@
 						return CBRET_NONE;
 					}
 #endif
-					continue;
+					DISPATCH_NEWIP;
 				}
 				break;
 			case 0x06:											/* Push Ed */
@@ -712,7 +713,7 @@
 				LOG(LOG_CPU,LOG_ERROR)("CPU:66:GRP5:Illegal call %2X",which);
 				goto illegal_opcode;
 			}
-			break;
+			DISPATCH;
 		}
 
 
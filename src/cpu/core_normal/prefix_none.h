@@ -17,214 +17,214 @@
  */
 
 	CASE_B(0x00)												/* ADD Eb,Gb */
-		RMEbGb(ADDB);break;
+		RMEbGb(ADDB);DISPATCH;
 	CASE_W(0x01)												/* ADD Ew,Gw */
-		RMEwGw(ADDW);break;	
+		RMEwGw(ADDW);DISPATCH;	
 	CASE_B(0x02)												/* ADD Gb,Eb */
-		RMGbEb(ADDB);break;
+		RMGbEb(ADDB);DISPATCH;
 	CASE_W(0x03)												/* ADD Gw,Ew */
-		RMGwEw(ADDW);break;
+		RMGwEw(ADDW);DISPATCH;
 	CASE_B(0x04)												/* ADD AL,Ib */
-		ALIb(ADDB);break;
+		ALIb(ADDB);DISPATCH;
 	CASE_W(0x05)												/* ADD AX,Iw */
-		AXIw(ADDW);break;
+		AXIw(ADDW);DISPATCH;
 	CASE_W(0x06)												/* PUSH ES */		
-		Push_16(SegValue(es));break;
+		Push_16(SegValue(es));DISPATCH;
 	CASE_W(0x07)												/* POP ES */
 		if (CPU_PopSeg(es,false)) RUNEXCEPTION();
-		break;
+		DISPATCH;
 	CASE_B(0x08)												/* OR Eb,Gb */
-		RMEbGb(ORB);break;
+		RMEbGb(ORB);DISPATCH;
 	CASE_W(0x09)												/* OR Ew,Gw */
-		RMEwGw(ORW);break;
+		RMEwGw(ORW);DISPATCH;
 	CASE_B(0x0a)												/* OR Gb,Eb */
-		RMGbEb(ORB);break;
+		RMGbEb(ORB);DISPATCH;
 	CASE_W(0x0b)												/* OR Gw,Ew */
-		RMGwEw(ORW);break;
+		RMGwEw(ORW);DISPATCH;
 	CASE_B(0x0c)												/* OR AL,Ib */
-		ALIb(ORB);break;
+		ALIb(ORB);DISPATCH;
 	CASE_W(0x0d)												/* OR AX,Iw */
-		AXIw(ORW);break;
+		AXIw(ORW);DISPATCH;
 	CASE_W(0x0e)												/* PUSH CS */		
-		Push_16(SegValue(cs));break;
+		Push_16(SegValue(cs));DISPATCH;
 	CASE_B(0x0f)												/* 2 byte opcodes*/		
 		core.opcode_index|=OPCODE_0F;
-		goto restart_opcode;
-		break;
+		DISPATCH_PREFIX;
+		DISPATCH;
 	CASE_B(0x10)												/* ADC Eb,Gb */
-		RMEbGb(ADCB);break;
+		RMEbGb(ADCB);DISPATCH;
 	CASE_W(0x11)												/* ADC Ew,Gw */
-		RMEwGw(ADCW);break;	
+		RMEwGw(ADCW);DISPATCH;	
 	CASE_B(0x12)												/* ADC Gb,Eb */
-		RMGbEb(ADCB);break;
+		RMGbEb(ADCB);DISPATCH;
 	CASE_W(0x13)												/* ADC Gw,Ew */
-		RMGwEw(ADCW);break;
+		RMGwEw(ADCW);DISPATCH;
 	CASE_B(0x14)												/* ADC AL,Ib */
-		ALIb(ADCB);break;
+		ALIb(ADCB);DISPATCH;
 	CASE_W(0x15)												/* ADC AX,Iw */
-		AXIw(ADCW);break;
+		AXIw(ADCW);DISPATCH;
 	CASE_W(0x16)												/* PUSH SS */		
-		Push_16(SegValue(ss));break;
+		Push_16(SegValue(ss));DISPATCH;
 	CASE_W(0x17)												/* POP SS */		
 		if (CPU_PopSeg(ss,false)) RUNEXCEPTION();
 		CPU_Cycles++; //Always do another instruction
-		break;
+		DISPATCH;
 	CASE_B(0x18)												/* SBB Eb,Gb */
-		RMEbGb(SBBB);break;
+		RMEbGb(SBBB);DISPATCH;
 	CASE_W(0x19)												/* SBB Ew,Gw */
-		RMEwGw(SBBW);break;
+		RMEwGw(SBBW);DISPATCH;
 	CASE_B(0x1a)												/* SBB Gb,Eb */
-		RMGbEb(SBBB);break;
+		RMGbEb(SBBB);DISPATCH;
 	CASE_W(0x1b)												/* SBB Gw,Ew */
-		RMGwEw(SBBW);break;
+		RMGwEw(SBBW);DISPATCH;
 	CASE_B(0x1c)												/* SBB AL,Ib */
-		ALIb(SBBB);break;
+		ALIb(SBBB);DISPATCH;
 	CASE_W(0x1d)												/* SBB AX,Iw */
-		AXIw(SBBW);break;
+		AXIw(SBBW);DISPATCH;
 	CASE_W(0x1e)												/* PUSH DS */		
-		Push_16(SegValue(ds));break;
+		Push_16(SegValue(ds));DISPATCH;
 	CASE_W(0x1f)												/* POP DS */
 		if (CPU_PopSeg(ds,false)) RUNEXCEPTION();
-		break;
+		DISPATCH;
 	CASE_B(0x20)												/* AND Eb,Gb */
-		RMEbGb(ANDB);break;
+		RMEbGb(ANDB);DISPATCH;
 	CASE_W(0x21)												/* AND Ew,Gw */
-		RMEwGw(ANDW);break;	
+		RMEwGw(ANDW);DISPATCH;	
 	CASE_B(0x22)												/* AND Gb,Eb */
-		RMGbEb(ANDB);break;
+		RMGbEb(ANDB);DISPATCH;
 	CASE_W(0x23)												/* AND Gw,Ew */
-		RMGwEw(ANDW);break;
+		RMGwEw(ANDW);DISPATCH;
 	CASE_B(0x24)												/* AND AL,Ib */
-		ALIb(ANDB);break;
+		ALIb(ANDB);DISPATCH;
 	CASE_W(0x25)												/* AND AX,Iw */
-		AXIw(ANDW);break;
+		AXIw(ANDW);DISPATCH;
 	CASE_B(0x26)												/* SEG ES: */
-		DO_PREFIX_SEG(es);break;
+		DO_PREFIX_SEG(es);DISPATCH;
 	CASE_B(0x27)												/* DAA */
-		DAA();break;
+		DAA();DISPATCH;
 	CASE_B(0x28)												/* SUB Eb,Gb */
-		RMEbGb(SUBB);break;
+		RMEbGb(SUBB);DISPATCH;
 	CASE_W(0x29)												/* SUB Ew,Gw */
-		RMEwGw(SUBW);break;
+		RMEwGw(SUBW);DISPATCH;
 	CASE_B(0x2a)												/* SUB Gb,Eb */
-		RMGbEb(SUBB);break;
+		RMGbEb(SUBB);DISPATCH;
 	CASE_W(0x2b)												/* SUB Gw,Ew */
-		RMGwEw(SUBW);break;
+		RMGwEw(SUBW);DISPATCH;
 	CASE_B(0x2c)												/* SUB AL,Ib */
-		ALIb(SUBB);break;
+		ALIb(SUBB);DISPATCH;
 	CASE_W(0x2d)												/* SUB AX,Iw */
-		AXIw(SUBW);break;
+		AXIw(SUBW);DISPATCH;
 	CASE_B(0x2e)												/* SEG CS: */
-		DO_PREFIX_SEG(cs);break;
+		DO_PREFIX_SEG(cs);DISPATCH;
 	CASE_B(0x2f)												/* DAS */
-		DAS();break;  
+		DAS();DISPATCH;  
 	CASE_B(0x30)												/* XOR Eb,Gb */
-		RMEbGb(XORB);break;
+		RMEbGb(XORB);DISPATCH;
 	CASE_W(0x31)												/* XOR Ew,Gw */
-		RMEwGw(XORW);break;	
+		RMEwGw(XORW);DISPATCH;	
 	CASE_B(0x32)												/* XOR Gb,Eb */
-		RMGbEb(XORB);break;
+		RMGbEb(XORB);DISPATCH;
 	CASE_W(0x33)												/* XOR Gw,Ew */
-		RMGwEw(XORW);break;
+		RMGwEw(XORW);DISPATCH;
 	CASE_B(0x34)												/* XOR AL,Ib */
-		ALIb(XORB);break;
+		ALIb(XORB);DISPATCH;
 	CASE_W(0x35)												/* XOR AX,Iw */
-		AXIw(XORW);break;
+		AXIw(XORW);DISPATCH;
 	CASE_B(0x36)												/* SEG SS: */
-		DO_PREFIX_SEG(ss);break;
+		DO_PREFIX_SEG(ss);DISPATCH;
 	CASE_B(0x37)												/* AAA */
-		AAA();break;  
+		AAA();DISPATCH;  
 	CASE_B(0x38)												/* CMP Eb,Gb */
-		RMEbGb(CMPB);break;
+		RMEbGb(CMPB);DISPATCH;
 	CASE_W(0x39)												/* CMP Ew,Gw */
-		RMEwGw(CMPW);break;
+		RMEwGw(CMPW);DISPATCH;
 	CASE_B(0x3a)												/* CMP Gb,Eb */
-		RMGbEb(CMPB);break;
+		RMGbEb(CMPB);DISPATCH;
 	CASE_W(0x3b)												/* CMP Gw,Ew */
-		RMGwEw(CMPW);break;
+		RMGwEw(CMPW);DISPATCH;
 	CASE_B(0x3c)												/* CMP AL,Ib */
-		ALIb(CMPB);break;
+		ALIb(CMPB);DISPATCH;
 	CASE_W(0x3d)												/* CMP AX,Iw */
-		AXIw(CMPW);break;
+		AXIw(CMPW);DISPATCH;
 	CASE_B(0x3e)												/* SEG DS: */
-		DO_PREFIX_SEG(ds);break;
+		DO_PREFIX_SEG(ds);DISPATCH;
 	CASE_B(0x3f)												/* AAS */
-		AAS();break;
+		AAS();DISPATCH;
 	CASE_W(0x40)												/* INC AX */
-		INCW(reg_ax,LoadRw,SaveRw);break;
+		INCW(reg_ax,LoadRw,SaveRw);DISPATCH;
 	CASE_W(0x41)												/* INC CX */
-		INCW(reg_cx,LoadRw,SaveRw);break;
+		INCW(reg_cx,LoadRw,SaveRw);DISPATCH;
 	CASE_W(0x42)												/* INC DX */
-		INCW(reg_dx,LoadRw,SaveRw);break;
+		INCW(reg_dx,LoadRw,SaveRw);DISPATCH;
 	CASE_W(0x43)												/* INC BX */
-		INCW(reg_bx,LoadRw,SaveRw);break;
+		INCW(reg_bx,LoadRw,SaveRw);DISPATCH;
 	CASE_W(0x44)												/* INC SP */
-		INCW(reg_sp,LoadRw,SaveRw);break;
+		INCW(reg_sp,LoadRw,SaveRw);DISPATCH;
 	CASE_W(0x45)												/* INC BP */
-		INCW(reg_bp,LoadRw,SaveRw);break;
+		INCW(reg_bp,LoadRw,SaveRw);DISPATCH;
 	CASE_W(0x46)												/* INC SI */
-		INCW(reg_si,LoadRw,SaveRw);break;
+		INCW(reg_si,LoadRw,SaveRw);DISPATCH;
 	CASE_W(0x47)												/* INC DI */
-		INCW(reg_di,LoadRw,SaveRw);break;
+		INCW(reg_di,LoadRw,SaveRw);DISPATCH;
 	CASE_W(0x48)												/* DEC AX */
-		DECW(reg_ax,LoadRw,SaveRw);break;
+		DECW(reg_ax,LoadRw,SaveRw);DISPATCH;
 	CASE_W(0x49)												/* DEC CX */
-  		DECW(reg_cx,LoadRw,SaveRw);break;
+  		DECW(reg_cx,LoadRw,SaveRw);DISPATCH;
 	CASE_W(0x4a)												/* DEC DX */
-		DECW(reg_dx,LoadRw,SaveRw);break;
+		DECW(reg_dx,LoadRw,SaveRw);DISPATCH;
 	CASE_W(0x4b)												/* DEC BX */
-		DECW(reg_bx,LoadRw,SaveRw);break;
+		DECW(reg_bx,LoadRw,SaveRw);DISPATCH;
 	CASE_W(0x4c)												/* DEC SP */
-		DECW(reg_sp,LoadRw,SaveRw);break;
+		DECW(reg_sp,LoadRw,SaveRw);DISPATCH;
 	CASE_W(0x4d)												/* DEC BP */
-		DECW(reg_bp,LoadRw,SaveRw);break;
+		DECW(reg_bp,LoadRw,SaveRw);DISPATCH;
 	CASE_W(0x4e)												/* DEC SI */
-		DECW(reg_si,LoadRw,SaveRw);break;
+		DECW(reg_si,LoadRw,SaveRw);DISPATCH;
 	CASE_W(0x4f)												/* DEC DI */
-		DECW(reg_di,LoadRw,SaveRw);break;
+		DECW(reg_di,LoadRw,SaveRw);DISPATCH;
 	CASE_W(0x50)												/* PUSH AX */
-		Push_16(reg_ax);break;
+		Push_16(reg_ax);DISPATCH;
 	CASE_W(0x51)												/* PUSH CX */
-		Push_16(reg_cx);break;
+		Push_16(reg_cx);DISPATCH;
 	CASE_W(0x52)												/* PUSH DX */
-		Push_16(reg_dx);break;
+		Push_16(reg_dx);DISPATCH;
 	CASE_W(0x53)												/* PUSH BX */
-		Push_16(reg_bx);break;
+		Push_16(reg_bx);DISPATCH;
 	CASE_W(0x54)												/* PUSH SP */
-		Push_16(reg_sp);break;
+		Push_16(reg_sp);DISPATCH;
 	CASE_W(0x55)												/* PUSH BP */
-		Push_16(reg_bp);break;
+		Push_16(reg_bp);DISPATCH;
 	CASE_W(0x56)												/* PUSH SI */
-		Push_16(reg_si);break;
+		Push_16(reg_si);DISPATCH;
 	CASE_W(0x57)												/* PUSH DI */
-		Push_16(reg_di);break;
+		Push_16(reg_di);DISPATCH;
 	CASE_W(0x58)												/* POP AX */
-		reg_ax=Pop_16();break;
+		reg_ax=Pop_16();DISPATCH;
 	CASE_W(0x59)												/* POP CX */
-		reg_cx=Pop_16();break;
+		reg_cx=Pop_16();DISPATCH;
 	CASE_W(0x5a)												/* POP DX */
-		reg_dx=Pop_16();break;
+		reg_dx=Pop_16();DISPATCH;
 	CASE_W(0x5b)												/* POP BX */
-		reg_bx=Pop_16();break;
+		reg_bx=Pop_16();DISPATCH;
 	CASE_W(0x5c)												/* POP SP */
-		reg_sp=Pop_16();break;
+		reg_sp=Pop_16();DISPATCH;
 	CASE_W(0x5d)												/* POP BP */
-		reg_bp=Pop_16();break;
+		reg_bp=Pop_16();DISPATCH;
 	CASE_W(0x5e)												/* POP SI */
-		reg_si=Pop_16();break;
+		reg_si=Pop_16();DISPATCH;
 	CASE_W(0x5f)												/* POP DI */
-		reg_di=Pop_16();break;
+		reg_di=Pop_16();DISPATCH;
 	CASE_W(0x60)												/* PUSHA */
 		{
 			Bit16u old_sp=reg_sp;
 			Push_16(reg_ax);Push_16(reg_cx);Push_16(reg_dx);Push_16(reg_bx);
 			Push_16(old_sp);Push_16(reg_bp);Push_16(reg_si);Push_16(reg_di);
 		}
-		break;
+		DISPATCH;
 	CASE_W(0x61)												/* POPA */
 		reg_di=Pop_16();reg_si=Pop_16();reg_bp=Pop_16();Pop_16();//Don't save SP
 		reg_bx=Pop_16();reg_dx=Pop_16();reg_cx=Pop_16();reg_ax=Pop_16();
-		break;
+		DISPATCH;
 	CASE_W(0x62)												/* BOUND */
 		{
 			Bit16s bound_min, bound_max;
@@ -235,7 +235,7 @@
 				EXCEPTION(5);
 			}
 		}
-		break;
+		DISPATCH;
 	CASE_W(0x63)												/* ARPL Ew,Rw */
 		{
 			if ((reg_flags & FLAG_VM) || (!cpu.pmode)) goto illegal_opcode;
@@ -250,71 +250,71 @@
 				SaveMw(eaa,(Bit16u)new_sel);
 			}
 		}
-		break;
+		DISPATCH;
 	CASE_B(0x64)												/* SEG FS: */
-		DO_PREFIX_SEG(fs);break;
+		DO_PREFIX_SEG(fs);DISPATCH;
 	CASE_B(0x65)												/* SEG GS: */
-		DO_PREFIX_SEG(gs);break;
+		DO_PREFIX_SEG(gs);DISPATCH;
 	CASE_B(0x66)												/* Operand Size Prefix */
 		core.opcode_index=(cpu.code.big^0x1)*0x200;
-		goto restart_opcode;
+		DISPATCH_PREFIX;
 	CASE_B(0x67)												/* Address Size Prefix */
 		DO_PREFIX_ADDR();
 	CASE_W(0x68)												/* PUSH Iw */
-		Push_16(Fetchw());break;
+		Push_16(Fetchw());DISPATCH;
 	CASE_W(0x69)												/* IMUL Gw,Ew,Iw */
 		RMGwEwOp3(DIMULW,Fetchws());
-		break;
+		DISPATCH;
 	CASE_W(0x6a)												/* PUSH Ib */
 		Push_16(Fetchbs());
-		break;
+		DISPATCH;
 	CASE_W(0x6b)												/* IMUL Gw,Ew,Ib */
 		RMGwEwOp3(DIMULW,Fetchbs());
-		break;
+		DISPATCH;
 	CASE_B(0x6c)												/* INSB */
 		if (CPU_IO_Exception(reg_dx,1)) RUNEXCEPTION();
-		DoString(R_INSB);break;
+		DoString(R_INSB);DISPATCH;
 	CASE_W(0x6d)												/* INSW */
 		if (CPU_IO_Exception(reg_dx,2)) RUNEXCEPTION();
-		DoString(R_INSW);break;
+		DoString(R_INSW);DISPATCH;
 	CASE_B(0x6e)												/* OUTSB */
 		if (CPU_IO_Exception(reg_dx,1)) RUNEXCEPTION();
-		DoString(R_OUTSB);break;
+		DoString(R_OUTSB);DISPATCH;
 	CASE_W(0x6f)												/* OUTSW */
 		if (CPU_IO_Exception(reg_dx,2)) RUNEXCEPTION();
-		DoString(R_OUTSW);break;
+		DoString(R_OUTSW);DISPATCH;
 	CASE_W(0x70)												/* JO */
-		JumpCond16_b(TFLG_O);break;
+		JumpCond16_b(TFLG_O);DISPATCH;
 	CASE_W(0x71)												/* JNO */
-		JumpCond16_b(TFLG_NO);break;
+		JumpCond16_b(TFLG_NO);DISPATCH;
 	CASE_W(0x72)												/* JB */
-		JumpCond16_b(TFLG_B);break;
+		JumpCond16_b(TFLG_B);DISPATCH;
 	CASE_W(0x73)												/* JNB */
-		JumpCond16_b(TFLG_NB);break;
+		JumpCond16_b(TFLG_NB);DISPATCH;
 	CASE_W(0x74)												/* JZ */
-  		JumpCond16_b(TFLG_Z);break;
+  		JumpCond16_b(TFLG_Z);DISPATCH;
 	CASE_W(0x75)												/* JNZ */
-		JumpCond16_b(TFLG_NZ);break;
+		JumpCond16_b(TFLG_NZ);DISPATCH;
 	CASE_W(0x76)												/* JBE */
-		JumpCond16_b(TFLG_BE);break;
+		JumpCond16_b(TFLG_BE);DISPATCH;
 	CASE_W(0x77)												/* JNBE */
-		JumpCond16_b(TFLG_NBE);break;
+		JumpCond16_b(TFLG_NBE);DISPATCH;
 	CASE_W(0x78)												/* JS */
-		JumpCond16_b(TFLG_S);break;
+		JumpCond16_b(TFLG_S);DISPATCH;
 	CASE_W(0x79)												/* JNS */
-		JumpCond16_b(TFLG_NS);break;
+		JumpCond16_b(TFLG_NS);DISPATCH;
 	CASE_W(0x7a)												/* JP */
-		JumpCond16_b(TFLG_P);break;
+		JumpCond16_b(TFLG_P);DISPATCH;
 	CASE_W(0x7b)												/* JNP */
-		JumpCond16_b(TFLG_NP);break;
+		JumpCond16_b(TFLG_NP);DISPATCH;
 	CASE_W(0x7c)												/* JL */
-		JumpCond16_b(TFLG_L);break;
+		JumpCond16_b(TFLG_L);DISPATCH;
 	CASE_W(0x7d)												/* JNL */
-		JumpCond16_b(TFLG_NL);break;
+		JumpCond16_b(TFLG_NL);DISPATCH;
 	CASE_W(0x7e)												/* JLE */
-		JumpCond16_b(TFLG_LE);break;
+		JumpCond16_b(TFLG_LE);DISPATCH;
 	CASE_W(0x7f)												/* JNLE */
-		JumpCond16_b(TFLG_NLE);break;
+		JumpCond16_b(TFLG_NLE);DISPATCH;
 	CASE_B(0x80)												/* Grpl Eb,Ib */
 	CASE_B(0x82)												/* Grpl Eb,Ib Mirror instruction*/
 		{
@@ -344,7 +344,7 @@
 				case 0x07:CMPB(eaa,ib,LoadMb,SaveMb);break;
 				}
 			}
-			break;
+			DISPATCH;
 		}
 	CASE_W(0x81)												/* Grpl Ew,Iw */
 		{
@@ -374,7 +374,7 @@
 				case 0x07:CMPW(eaa,iw,LoadMw,SaveMw);break;
 				}
 			}
-			break;
+			DISPATCH;
 		}
 	CASE_W(0x83)												/* Grpl Ew,Ix */
 		{
@@ -404,27 +404,27 @@
 				case 0x07:CMPW(eaa,iw,LoadMw,SaveMw);break;
 				}
 			}
-			break;
+			DISPATCH;
 		}
 	CASE_B(0x84)												/* TEST Eb,Gb */
 		RMEbGb(TESTB);
-		break;
+		DISPATCH;
 	CASE_W(0x85)												/* TEST Ew,Gw */
 		RMEwGw(TESTW);
-		break;
+		DISPATCH;
 	CASE_B(0x86)												/* XCHG Eb,Gb */
 		{	
 			GetRMrb;Bit8u oldrmrb=*rmrb;
 			if (rm >= 0xc0 ) {GetEArb;*rmrb=*earb;*earb=oldrmrb;}
 			else {GetEAa;*rmrb=LoadMb(eaa);SaveMb(eaa,oldrmrb);}
-			break;
+			DISPATCH;
 		}
 	CASE_W(0x87)												/* XCHG Ew,Gw */
 		{	
 			GetRMrw;Bit16u oldrmrw=*rmrw;
 			if (rm >= 0xc0 ) {GetEArw;*rmrw=*earw;*earw=oldrmrw;}
 			else {GetEAa;*rmrw=LoadMw(eaa);SaveMw(eaa,oldrmrw);}
-			break;
+			DISPATCH;
 		}
 	CASE_B(0x88)												/* MOV Eb,Gb */
 		{	
@@ -437,34 +437,34 @@
 						cpu.gdt.GetDescriptor(SegValue(core.base_val_ds),desc);
 						if ((desc.Type()==DESC_CODE_R_NC_A) || (desc.Type()==DESC_CODE_R_NC_NA)) {
 							CPU_Exception(EXCEPTION_GP,SegValue(core.base_val_ds) & 0xfffc);
-							continue;
+							DISPATCH_NEWIP;
 						}
 					}
 				}
 				GetEAa;SaveMb(eaa,*rmrb);
 			}
-			break;
+			DISPATCH;
 		}
 	CASE_W(0x89)												/* MOV Ew,Gw */
 		{	
 			GetRMrw;
 			if (rm >= 0xc0 ) {GetEArw;*earw=*rmrw;}
 			else {GetEAa;SaveMw(eaa,*rmrw);}
-			break;
+			DISPATCH;
 		}
 	CASE_B(0x8a)												/* MOV Gb,Eb */
 		{	
 			GetRMrb;
 			if (rm >= 0xc0 ) {GetEArb;*rmrb=*earb;}
 			else {GetEAa;*rmrb=LoadMb(eaa);}
-			break;
+			DISPATCH;
 		}
 	CASE_W(0x8b)												/* MOV Gw,Ew */
 		{	
 			GetRMrw;
 			if (rm >= 0xc0 ) {GetEArw;*rmrw=*earw;}
 			else {GetEAa;*rmrw=LoadMw(eaa);}
-			break;
+			DISPATCH;
 		}
 	CASE_W(0x8c)												/* Mov Ew,Sw */
 		{
@@ -488,7 +488,7 @@
 			}
 			if (rm >= 0xc0 ) {GetEArw;*earw=val;}
 			else {GetEAa;SaveMw(eaa,val);}
-			break;
+			DISPATCH;
 		}
 	CASE_W(0x8d)												/* LEA Gw */
 		{
@@ -500,7 +500,7 @@
 			} else {
 				*rmrw=(Bit16u)(*EATable[rm])();
 			}
-			break;
+			DISPATCH;
 		}
 	CASE_B(0x8e)												/* MOV Sw,Ew */
 		{
@@ -519,7 +519,7 @@
 			default:
 				goto illegal_opcode;
 			}
-			break;
+			DISPATCH;
 		}							
 	CASE_W(0x8f)												/* POP Ew */
 		{
@@ -527,36 +527,36 @@
 			GetRM;
 			if (rm >= 0xc0 ) {GetEArw;*earw=val;}
 			else {GetEAa;SaveMw(eaa,val);}
-			break;
+			DISPATCH;
 		}
 	CASE_B(0x90)												/* NOP */
-		break;
+		DISPATCH;
 	CASE_W(0x91)												/* XCHG CX,AX */
 		{ Bit16u temp=reg_ax;reg_ax=reg_cx;reg_cx=temp; }
-		break;
+		DISPATCH;
 	CASE_W(0x92)												/* XCHG DX,AX */
 		{ Bit16u temp=reg_ax;reg_ax=reg_dx;reg_dx=temp; }
-		break;
+		DISPATCH;
 	CASE_W(0x93)												/* XCHG BX,AX */
 		{ Bit16u temp=reg_ax;reg_ax=reg_bx;reg_bx=temp; }
-		break;
+		DISPATCH;
 	CASE_W(0x94)												/* XCHG SP,AX */
 		{ Bit16u temp=reg_ax;reg_ax=reg_sp;reg_sp=temp; }
-		break;
+		DISPATCH;
 	CASE_W(0x95)												/* XCHG BP,AX */
 		{ Bit16u temp=reg_ax;reg_ax=reg_bp;reg_bp=temp; }
-		break;
+		DISPATCH;
 	CASE_W(0x96)												/* XCHG SI,AX */
 		{ Bit16u temp=reg_ax;reg_ax=reg_si;reg_si=temp; }
-		break;
+		DISPATCH;
 	CASE_W(0x97)												/* XCHG DI,AX */
 		{ Bit16u temp=reg_ax;reg_ax=reg_di;reg_di=temp; }
-		break;
+		DISPATCH;
 	CASE_W(0x98)												/* CBW */
-		reg_ax=(Bit8s)reg_al;break;
+		reg_ax=(Bit8s)reg_al;DISPATCH;
 	CASE_W(0x99)												/* CWD */
 		if (reg_ax & 0x8000) reg_dx=0xffff;else reg_dx=0;
-		break;
+		DISPATCH;
 	CASE_W(0x9a)												/* CALL Ap */
 		{ 
 			FillFlags();
@@ -568,13 +568,13 @@
 				return CBRET_NONE;
 			}
 #endif
-			continue;
+			DISPATCH_NEWIP;
 		}
 	CASE_B(0x9b)												/* WAIT */
-		break; /* No waiting here */
+		DISPATCH; /* No waiting here */
 	CASE_W(0x9c)												/* PUSHF */
 		if (CPU_PUSHF(false)) RUNEXCEPTION();
-		break;
+		DISPATCH;
 	CASE_W(0x9d)												/* POPF */
 		if (CPU_POPF(false)) RUNEXCEPTION();
 #if CPU_TRAP_CHECK
@@ -586,105 +586,105 @@
 #if	CPU_PIC_CHECK
 		if (GETFLAG(IF) && PIC_IRQCheck) goto decode_end;
 #endif
-		break;
+		DISPATCH;
 	CASE_B(0x9e)												/* SAHF */
 		SETFLAGSb(reg_ah);
-		break;
+		DISPATCH;
 	CASE_B(0x9f)												/* LAHF */
 		FillFlags();
 		reg_ah=reg_flags&0xff;
-		break;
+		DISPATCH;
 	CASE_B(0xa0)												/* MOV AL,Ob */
 		{
 			GetEADirect;
 			reg_al=LoadMb(eaa);
 		}
-		break;
+		DISPATCH;
 	CASE_W(0xa1)												/* MOV AX,Ow */
 		{
 			GetEADirect;
 			reg_ax=LoadMw(eaa);
 		}
-		break;
+		DISPATCH;
 	CASE_B(0xa2)												/* MOV Ob,AL */
 		{
 			GetEADirect;
 			SaveMb(eaa,reg_al);
 		}
-		break;
+		DISPATCH;
 	CASE_W(0xa3)												/* MOV Ow,AX */
 		{
 			GetEADirect;
 			SaveMw(eaa,reg_ax);
 		}
-		break;
+		DISPATCH;
 	CASE_B(0xa4)												/* MOVSB */
-		DoString(R_MOVSB);break;
+		DoString(R_MOVSB);DISPATCH;
 	CASE_W(0xa5)												/* MOVSW */
-		DoString(R_MOVSW);break;
+		DoString(R_MOVSW);DISPATCH;
 	CASE_B(0xa6)												/* CMPSB */
-		DoString(R_CMPSB);break;
+		DoString(R_CMPSB);DISPATCH;
 	CASE_W(0xa7)												/* CMPSW */
-		DoString(R_CMPSW);break;
+		DoString(R_CMPSW);DISPATCH;
 	CASE_B(0xa8)												/* TEST AL,Ib */
-		ALIb(TESTB);break;
+		ALIb(TESTB);DISPATCH;
 	CASE_W(0xa9)												/* TEST AX,Iw */
-		AXIw(TESTW);break;
+		AXIw(TESTW);DISPATCH;
 	CASE_B(0xaa)												/* STOSB */
-		DoString(R_STOSB);break;
+		DoString(R_STOSB);DISPATCH;
 	CASE_W(0xab)												/* STOSW */
-		DoString(R_STOSW);break;
+		DoString(R_STOSW);DISPATCH;
 	CASE_B(0xac)												/* LODSB */
-		DoString(R_LODSB);break;
+		DoString(R_LODSB);DISPATCH;
 	CASE_W(0xad)												/* LODSW */
-		DoString(R_LODSW);break;
+		DoString(R_LODSW);DISPATCH;
 	CASE_B(0xae)												/* SCASB */
-		DoString(R_SCASB);break;
+		DoString(R_SCASB);DISPATCH;
 	CASE_W(0xaf)												/* SCASW */
-		DoString(R_SCASW);break;
+		DoString(R_SCASW);DISPATCH;
 	CASE_B(0xb0)												/* MOV AL,Ib */
-		reg_al=Fetchb();break;
+		reg_al=Fetchb();DISPATCH;
 	CASE_B(0xb1)												/* MOV CL,Ib */
-		reg_cl=Fetchb();break;
+		reg_cl=Fetchb();DISPATCH;
 	CASE_B(0xb2)												/* MOV DL,Ib */
-		reg_dl=Fetchb();break;
+		reg_dl=Fetchb();DISPATCH;
 	CASE_B(0xb3)												/* MOV BL,Ib */
-		reg_bl=Fetchb();break;
+		reg_bl=Fetchb();DISPATCH;
 	CASE_B(0xb4)												/* MOV AH,Ib */
-		reg_ah=Fetchb();break;
+		reg_ah=Fetchb();DISPATCH;
 	CASE_B(0xb5)												/* MOV CH,Ib */
-		reg_ch=Fetchb();break;
+		reg_ch=Fetchb();DISPATCH;
 	CASE_B(0xb6)												/* MOV DH,Ib */
-		reg_dh=Fetchb();break;
+		reg_dh=Fetchb();DISPATCH;
 	CASE_B(0xb7)												/* MOV BH,Ib */
-		reg_bh=Fetchb();break;
+		reg_bh=Fetchb();DISPATCH;
 	CASE_W(0xb8)												/* MOV AX,Iw */
-		reg_ax=Fetchw();break;
+		reg_ax=Fetchw();DISPATCH;
 	CASE_W(0xb9)												/* MOV CX,Iw */
-		reg_cx=Fetchw();break;
+		reg_cx=Fetchw();DISPATCH;
 	CASE_W(0xba)												/* MOV DX,Iw */
-		reg_dx=Fetchw();break;
+		reg_dx=Fetchw();DISPATCH;
 	CASE_W(0xbb)												/* MOV BX,Iw */
-		reg_bx=Fetchw();break;
+		reg_bx=Fetchw();DISPATCH;
 	CASE_W(0xbc)												/* MOV SP,Iw */
-		reg_sp=Fetchw();break;
+		reg_sp=Fetchw();DISPATCH;
 	CASE_W(0xbd)												/* MOV BP.Iw */
-		reg_bp=Fetchw();break;
+		reg_bp=Fetchw();DISPATCH;
 	CASE_W(0xbe)												/* MOV SI,Iw */
-		reg_si=Fetchw();break;
+		reg_si=Fetchw();DISPATCH;
 	CASE_W(0xbf)												/* MOV DI,Iw */
-		reg_di=Fetchw();break;
+		reg_di=Fetchw();DISPATCH;
 	CASE_B(0xc0)												/* GRP2 Eb,Ib */
-		GRP2B(Fetchb());break;
+		GRP2B(Fetchb());DISPATCH;
 	CASE_W(0xc1)												/* GRP2 Ew,Ib */
-		GRP2W(Fetchb());break;
+		GRP2W(Fetchb());DISPATCH;
 	CASE_W(0xc2)												/* RETN Iw */
 		reg_eip=Pop_16();
 		reg_esp+=Fetchw();
-		continue;
+		DISPATCH_NEWIP;
 	CASE_W(0xc3)												/* RETN */
 		reg_eip=Pop_16();
-		continue;
+		DISPATCH_NEWIP;
 	CASE_W(0xc4)												/* LES */
 		{	
 			GetRMrw;
@@ -692,7 +692,7 @@
 			GetEAa;
 			if (CPU_SetSegGeneral(es,LoadMw(eaa+2))) RUNEXCEPTION();
 			*rmrw=LoadMw(eaa);
-			break;
+			DISPATCH;
 		}
 	CASE_W(0xc5)												/* LDS */
 		{	
@@ -701,21 +701,21 @@
 			GetEAa;
 			if (CPU_SetSegGeneral(ds,LoadMw(eaa+2))) RUNEXCEPTION();
 			*rmrw=LoadMw(eaa);
-			break;
+			DISPATCH;
 		}
 	CASE_B(0xc6)												/* MOV Eb,Ib */
 		{
 			GetRM;
 			if (rm >= 0xc0) {GetEArb;*earb=Fetchb();}
 			else {GetEAa;SaveMb(eaa,Fetchb());}
-			break;
+			DISPATCH;
 		}
 	CASE_W(0xc7)												/* MOV EW,Iw */
 		{
 			GetRM;
 			if (rm >= 0xc0) {GetEArw;*earw=Fetchw();}
 			else {GetEAa;SaveMw(eaa,Fetchw());}
-			break;
+			DISPATCH;
 		}
 	CASE_W(0xc8)												/* ENTER Iw,Ib */
 		{
@@ -723,23 +723,23 @@
 			Bitu level=Fetchb();
 			CPU_ENTER(false,bytes,level);
 		}
-		break;
+		DISPATCH;
 	CASE_W(0xc9)												/* LEAVE */
 		reg_esp&=cpu.stack.notmask;
 		reg_esp|=(reg_ebp&cpu.stack.mask);
 		reg_bp=Pop_16();
-		break;
+		DISPATCH;
 	CASE_W(0xca)												/* RETF Iw */
 		{
 			Bitu words=Fetchw();
 			FillFlags();
 			CPU_RET(false,words,GETIP);
-			continue;
+			DISPATCH_NEWIP;
 		}
 	CASE_W(0xcb)												/* RETF */			
 		FillFlags();
 		CPU_RET(false,0,GETIP);
-		continue;
+		DISPATCH_NEWIP;
 	CASE_B(0xcc)												/* INT3 */
 #if C_DEBUG	
 		FillFlags();
@@ -750,7 +750,7 @@
 #if CPU_TRAP_CHECK
 		cpu.trap_skip=true;
 #endif
-		continue;
+		DISPATCH_NEWIP;
 	CASE_B(0xcd)												/* INT Ib */	
 		{
 			Bit8u num=Fetchb();
@@ -764,7 +764,7 @@
 #if CPU_TRAP_CHECK
 			cpu.trap_skip=true;
 #endif
-			continue;
+			DISPATCH_NEWIP;
 		}
 	CASE_B(0xce)												/* INTO */
 		if (get_OF()) {
@@ -772,9 +772,9 @@
 #if CPU_TRAP_CHECK
 			cpu.trap_skip=true;
 #endif
-			continue;
+			DISPATCH_NEWIP;
 		}
-		break;
+		DISPATCH;
 	CASE_W(0xcf)												/* IRET */
 		{
 			CPU_IRET(false,GETIP);
@@ -787,47 +787,47 @@
 #if CPU_PIC_CHECK
 			if (GETFLAG(IF) && PIC_IRQCheck) return CBRET_NONE;
 #endif
-			continue;
+			DISPATCH_NEWIP;
 		}
 	CASE_B(0xd0)												/* GRP2 Eb,1 */
-		GRP2B(1);break;
+		GRP2B(1);DISPATCH;
 	CASE_W(0xd1)												/* GRP2 Ew,1 */
-		GRP2W(1);break;
+		GRP2W(1);DISPATCH;
 	CASE_B(0xd2)												/* GRP2 Eb,CL */
-		GRP2B(reg_cl);break;
+		GRP2B(reg_cl);DISPATCH;
 	CASE_W(0xd3)												/* GRP2 Ew,CL */
-		GRP2W(reg_cl);break;
+		GRP2W(reg_cl);DISPATCH;
 	CASE_B(0xd4)												/* AAM Ib */
-		AAM(Fetchb());break;
+		AAM(Fetchb());DISPATCH;
 	CASE_B(0xd5)												/* AAD Ib */
-		AAD(Fetchb());break;
+		AAD(Fetchb());DISPATCH;
 	CASE_B(0xd6)												/* SALC */
 		reg_al = get_CF() ? 0xFF : 0;
-		break;
+		DISPATCH;
 	CASE_B(0xd7)												/* XLAT */
 		if (TEST_PREFIX_ADDR) {
 			reg_al=LoadMb(BaseDS+(Bit32u)(reg_ebx+reg_al));
 		} else {
 			reg_al=LoadMb(BaseDS+(Bit16u)(reg_bx+reg_al));
 		}
-		break;
+		DISPATCH;
 #ifdef CPU_FPU
 	CASE_B(0xd8)												/* FPU ESC 0 */
-		 FPU_ESC(0);break;
+		 FPU_ESC(0);DISPATCH;
 	CASE_B(0xd9)												/* FPU ESC 1 */
-		 FPU_ESC(1);break;
+		 FPU_ESC(1);DISPATCH;
 	CASE_B(0xda)												/* FPU ESC 2 */
-		 FPU_ESC(2);break;
+		 FPU_ESC(2);DISPATCH;
 	CASE_B(0xdb)												/* FPU ESC 3 */
-		 FPU_ESC(3);break;
+		 FPU_ESC(3);DISPATCH;
 	CASE_B(0xdc)												/* FPU ESC 4 */
-		 FPU_ESC(4);break;
+		 FPU_ESC(4);DISPATCH;
 	CASE_B(0xdd)												/* FPU ESC 5 */
-		 FPU_ESC(5);break;
+		 FPU_ESC(5);DISPATCH;
 	CASE_B(0xde)												/* FPU ESC 6 */
-		 FPU_ESC(6);break;
+		 FPU_ESC(6);DISPATCH;
 	CASE_B(0xdf)												/* FPU ESC 7 */
-		 FPU_ESC(7);break;
+		 FPU_ESC(7);DISPATCH;
 #else 
 	CASE_B(0xd8)												/* FPU ESC 0 */
 	CASE_B(0xd9)												/* FPU ESC 1 */
@@ -842,7 +842,7 @@
 			Bit8u rm=Fetchb();
 			if (rm<0xc0) GetEAa;
 		}
-		break;
+		DISPATCH;
 #endif
 	CASE_W(0xe0)												/* LOOPNZ */
 		if (TEST_PREFIX_ADDR) {
@@ -850,51 +850,51 @@
 		} else {
 			JumpCond16_b(--reg_cx && !get_ZF());
 		}
-		break;
+		DISPATCH;
 	CASE_W(0xe1)												/* LOOPZ */
 		if (TEST_PREFIX_ADDR) {
 			JumpCond16_b(--reg_ecx && get_ZF());
 		} else {
 			JumpCond16_b(--reg_cx && get_ZF());
 		}
-		break;
+		DISPATCH;
 	CASE_W(0xe2)												/* LOOP */
 		if (TEST_PREFIX_ADDR) {	
 			JumpCond16_b(--reg_ecx);
 		} else {
 			JumpCond16_b(--reg_cx);
 		}
-		break;
+		DISPATCH;
 	CASE_W(0xe3)												/* JCXZ */
 		JumpCond16_b(!(reg_ecx & AddrMaskTable[core.prefixes& PREFIX_ADDR]));
-		break;
+		DISPATCH;
 	CASE_B(0xe4)												/* IN AL,Ib */
 		{	
 			Bitu port=Fetchb();
 			if (CPU_IO_Exception(port,1)) RUNEXCEPTION();
 			reg_al=IO_ReadB(port);
-			break;
+			DISPATCH;
 		}
 	CASE_W(0xe5)												/* IN AX,Ib */
 		{	
 			Bitu port=Fetchb();
 			if (CPU_IO_Exception(port,2)) RUNEXCEPTION();
 			reg_ax=IO_ReadW(port);
-			break;
+			DISPATCH;
 		}
 	CASE_B(0xe6)												/* OUT Ib,AL */
 		{
 			Bitu port=Fetchb();
 			if (CPU_IO_Exception(port,1)) RUNEXCEPTION();
 			IO_WriteB(port,reg_al);
-			break;
+			DISPATCH;
 		}		
 	CASE_W(0xe7)												/* OUT Ib,AX */
 		{
 			Bitu port=Fetchb();
 			if (CPU_IO_Exception(port,2)) RUNEXCEPTION();
 			IO_WriteW(port,reg_ax);
-			break;
+			DISPATCH;
 		}
 	CASE_W(0xe8)												/* CALL Jw */
 		{ 
@@ -902,14 +902,14 @@
 			SAVEIP;
 			Push_16(reg_eip);
 			reg_eip=(Bit16u)(reg_eip+addip);
-			continue;
+			DISPATCH_NEWIP;
 		}
 	CASE_W(0xe9)												/* JMP Jw */
 		{ 
 			Bit16u addip=Fetchws();
 			SAVEIP;
 			reg_eip=(Bit16u)(reg_eip+addip);
-			continue;
+			DISPATCH_NEWIP;
 		}
 	CASE_W(0xea)												/* JMP Ap */
 		{ 
@@ -923,46 +923,47 @@
 				return CBRET_NONE;
 			}
 #endif
-			continue;
+			DISPATCH_NEWIP;
 		}
 	CASE_W(0xeb)												/* JMP Jb */
 		{ 
 			Bit16s addip=Fetchbs();
 			SAVEIP;
 			reg_eip=(Bit16u)(reg_eip+addip);
-			continue;
+			if (addip<0) POLL_LOOP_CHECK(addip);
+			DISPATCH_NEWIP;
 		}
 	CASE_B(0xec)												/* IN AL,DX */
 		if (CPU_IO_Exception(reg_dx,1)) RUNEXCEPTION();
 		reg_al=IO_ReadB(reg_dx);
-		break;
+		DISPATCH;
 	CASE_W(0xed)												/* IN AX,DX */
 		if (CPU_IO_Exception(reg_dx,2)) RUNEXCEPTION();
 		reg_ax=IO_ReadW(reg_dx);
-		break;
+		DISPATCH;
 	CASE_B(0xee)												/* OUT DX,AL */
 		if (CPU_IO_Exception(reg_dx,1)) RUNEXCEPTION();
 		IO_WriteB(reg_dx,reg_al);
-		break;
+		DISPATCH;
 	CASE_W(0xef)												/* OUT DX,AX */
 		if (CPU_IO_Exception(reg_dx,2)) RUNEXCEPTION();
 		IO_WriteW(reg_dx,reg_ax);
-		break;
+		DISPATCH;
 	CASE_B(0xf0)												/* LOCK */
 		LOG(LOG_CPU,LOG_NORMAL)("CPU:LOCK"); /* FIXME: see case D_LOCK in core_full/load.h */
-		break;
+		DISPATCH;
 	CASE_B(0xf1)												/* ICEBP */
 		CPU_SW_Interrupt_NoIOPLCheck(1,GETIP);
 #if CPU_TRAP_CHECK
 		cpu.trap_skip=true;
 #endif
-		continue;
+		DISPATCH_NEWIP;
 	CASE_B(0xf2)												/* REPNZ */
 		DO_PREFIX_REP(false);	
-		break;		
+		DISPATCH;		
 	CASE_B(0xf3)												/* REPZ */
 		DO_PREFIX_REP(true);	
-		break;		
+		DISPATCH;		
 	CASE_B(0xf4)												/* HLT */
 		if (cpu.pmode && cpu.cpl) EXCEPTION(EXCEPTION_GP);
 		FillFlags();
@@ -971,7 +972,7 @@
 	CASE_B(0xf5)												/* CMC */
 		FillFlags();
 		SETFLAGBIT(CF,!(reg_flags & FLAG_CF));
-		break;
+		DISPATCH;
 	CASE_B(0xf6)												/* GRP3 Eb(,Ib) */
 		{	
 			GetRM;Bitu which=(rm>>3)&7;
@@ -1014,7 +1015,7 @@
 				RMEb(IDIVB);
 				break;
 			}
-			break;
+			DISPATCH;
 		}
 	CASE_W(0xf7)												/* GRP3 Ew(,Iw) */
 		{ 
@@ -1058,33 +1059,33 @@
 				RMEw(IDIVW)
 				break;
 			}
-			break;
+			DISPATCH;
 		}
 	CASE_B(0xf8)												/* CLC */
 		FillFlags();
 		SETFLAGBIT(CF,false);
-		break;
+		DISPATCH;
 	CASE_B(0xf9)												/* STC */
 		FillFlags();
 		SETFLAGBIT(CF,true);
-		break;
+		DISPATCH;
 	CASE_B(0xfa)												/* CLI */
 		if (CPU_CLI()) RUNEXCEPTION();
-		break;
+		DISPATCH;
 	CASE_B(0xfb)												/* STI */
 		if (CPU_STI()) RUNEXCEPTION();
 #if CPU_PIC_CHECK
 		if (GETFLAG(IF) && PIC_IRQCheck) goto decode_end;
 #endif
-		break;
+		DISPATCH;
 	CASE_B(0xfc)												/* CLD */
 		SETFLAGBIT(DF,false);
 		cpu.direction=1;
-		break;
+		DISPATCH;
 	CASE_B(0xfd)												/* STD */
 		SETFLAGBIT(DF,true);
 		cpu.direction=-1;
-		break;
+		DISPATCH;
 	CASE_B(0xfe)												/* GRP4 Eb */
 		{
 			GetRM;Bitu which=(rm>>3)&7;
@@ -1105,7 +1106,7 @@
 				E_Exit("Illegal GRP4 Call %d",(rm>>3) & 7);
 				break;
 			}
-			break;
+			DISPATCH;
 		}
 	CASE_W(0xff)												/* GRP5 Ew */
 		{
@@ -1121,7 +1122,7 @@
 				if (rm >= 0xc0 ) {GetEArw;reg_eip=*earw;}
 				else {GetEAa;reg_eip=LoadMw(eaa);}
 				Push_16(GETIP);
-				continue;
+				DISPATCH_NEWIP;
 			case 0x03:										/* CALL Ep */
 				{
 					if (rm >= 0xc0) goto illegal_opcode;
@@ -1136,13 +1137,13 @@
 						return CBRET_NONE;
 					}
 #endif
-					continue;
+					DISPATCH_NEWIP;
 				}
 				break;
 			case 0x04:										/* JMP Ev */	
 				if (rm >= 0xc0 ) {GetEArw;reg_eip=*earw;}
 				else {GetEAa;reg_eip=LoadMw(eaa);}
-				continue;
+				DISPATCH_NEWIP;
 			case 0x05:										/* JMP Ep */	
 				{
 					if (rm >= 0xc0) goto illegal_opcode;
@@ -1157,7 +1158,7 @@
 						return CBRET_NONE;
 					}
 #endif
-					continue;
+					DISPATCH_NEWIP;
 				}
 				break;
 			case 0x06:										/* PUSH Ev */
@@ -1168,7 +1169,7 @@
 				LOG(LOG_CPU,LOG_ERROR)("CPU:GRP5:Illegal Call %2X",which);
 				goto illegal_opcode;
 			}
-			break;
+			DISPATCH;
 		}
 			
 
@@ -43,42 +43,52 @@ static INLINE Bit32s Fetchds() {
 
 #define RUNEXCEPTION() {										\
 	CPU_Exception(cpu.exception.which,cpu.exception.error);		\
-	continue;													\
+	DISPATCH_NEWIP;												\
 }
 
 #define EXCEPTION(blah)										\
 	{														\
 		CPU_Exception(blah);								\
-		continue;											\
+		DISPATCH_NEWIP;										\
 	}
 
+/* A taken backward short jump may close a polling loop */
+#define POLL_LOOP_CHECK(_ADDIP)						\
+	if (CPU_PollSkip) CPU_PollLoop(SegBase(cs)+reg_eip,(Bitu)(-(_ADDIP)));
+
 //TODO Could probably make all byte operands fast?
 #define JumpCond16_b(COND) {						\
 	SAVEIP;											\
-	if (COND) reg_ip+=Fetchbs();					\
-	reg_ip+=1;										\
-	continue;										\
+	if (COND) {										\
+		Bits addip=Fetchbs();						\
+		reg_ip+=addip+1;							\
+		if (addip<0) POLL_LOOP_CHECK(addip);		\
+	} else reg_ip+=1;								\
+	DISPATCH_NEWIP;									\
 }
 
 #define JumpCond16_w(COND) {						\
 	SAVEIP;											\
 	if (COND) reg_ip+=Fetchws();					\
 	reg_ip+=2;										\
-	continue;										\
+	DISPATCH_NEWIP;									\
 }
 
 #define JumpCond32_b(COND) {						\
 	SAVEIP;											\
-	if (COND) reg_eip+=Fetchbs();					\
-	reg_eip+=1;										\
-	continue;										\
+	if (COND) {										\
+		Bits addip=Fetchbs();						\
+		reg_eip+=addip+1;							\
+		if (addip<0) POLL_LOOP_CHECK(addip);		\
+	} else reg_eip+=1;								\
+	DISPATCH_NEWIP;									\
 }
 
 #define JumpCond32_d(COND) {						\
 	SAVEIP;											\
 	if (COND) reg_eip+=Fetchds();					\
 	reg_eip+=4;										\
-	continue;										\
+	DISPATCH_NEWIP;									\
 }
 
 
@@ -0,0 +1,134 @@
+/*
+ *  Copyright (C) 2002-2019  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/*
+	Run loop of the normal and simple cores with threaded dispatch.
+	The opcode handlers are the same as in the switch, but every one
+	of them has a label (see CASE_LABEL) and ends in its own copy of
+	the dispatch (see DISPATCH): the cycle check, the per instruction
+	setup of the loop and a computed goto through table_threaded.h to
+	the next handler. So each handler has its own indirect branch,
+	which predicts a lot better than the single one of the switch.
+
+	The handlers stay in a switch that is never entered through its
+	controlling expression, a break from it still goes through the
+	shared dispatch at its end.
+	The including file defines CORE_THREADED_RUN to the function name.
+*/
+
+#if CPU_CORE_THREADED
+
+#undef CASE_LABEL
+#define CASE_LABEL(_NAME) _NAME:
+
+#if C_DEBUG
+#if C_HEAVY_DEBUG
+#define THREADED_DEBUG								\
+	if (DEBUG_HeavyIsBreakpoint()) {				\
+		FillFlags();								\
+		return debugCallback;						\
+	}												\
+	cycle_count++;
+#else
+#define THREADED_DEBUG cycle_count++;
+#endif
+#else
+#define THREADED_DEBUG
+#endif
+
+#if defined(DECODE_CACHE_CHECK)
+#define THREADED_DECODE_CACHE DECODE_CACHE_CHECK(goto threaded_next)
+#else
+#define THREADED_DECODE_CACHE
+#endif
+
+/* What the loop of the switch core does between two instructions */
+#define THREADED_NEXT								\
+	if (GCC_UNLIKELY(CPU_Cycles--<=0)) goto threaded_end;	\
+	LOADIP;											\
+	core.opcode_index=cpu.code.big*0x200;			\
+	core.prefixes=cpu.code.big;						\
+	core.ea_table=&EATable[cpu.code.big*256];		\
+	BaseDS=SegBase(ds);								\
+	BaseSS=SegBase(ss);								\
+	core.base_val_ds=ds;							\
+	THREADED_DEBUG									\
+	THREADED_DECODE_CACHE							\
+	goto *opcode_table[core.opcode_index+Fetchb()];
+
+#undef DISPATCH
+#undef DISPATCH_NEWIP
+#undef DISPATCH_PREFIX
+#define DISPATCH			{ SAVEIP; THREADED_NEXT }
+#define DISPATCH_NEWIP		{ THREADED_NEXT }
+#define DISPATCH_PREFIX		goto *opcode_table[core.opcode_index+Fetchb()]
+
+Bits CORE_THREADED_RUN(void) {
+	static void * const opcode_table[0x400]={
+#include "table_threaded.h"
+	};
+#if defined(DECODE_CACHE_CHECK)
+threaded_next:
+#endif
+	THREADED_NEXT
+	switch (0) {
+	#include "prefix_none.h"
+	#include "prefix_0f.h"
+	#include "prefix_66.h"
+	#include "prefix_66_0f.h"
+	default:
+	illegal_opcode:
+#if C_DEBUG
+		{
+			Bitu len=(GETIP-reg_eip);
+			LOADIP;
+			if (len>16) len=16;
+			char tempcode[16*2+1];char * writecode=tempcode;
+			for (;len>0;len--) {
+				sprintf(writecode,"%02X",mem_readb(core.cseip++));
+				writecode+=2;
+			}
+			LOG(LOG_CPU,LOG_NORMAL)("Illegal/Unhandled opcode %s",tempcode);
+		}
+#endif
+		CPU_Exception(6,0);
+		DISPATCH_NEWIP;
+	}
+	DISPATCH;
+threaded_end:
+	FillFlags();
+	return CBRET_NONE;
+decode_end:
+	SAVEIP;
+	FillFlags();
+	return CBRET_NONE;
+}
+
+#undef THREADED_NEXT
+#undef THREADED_DECODE_CACHE
+#undef THREADED_DEBUG
+#undef DISPATCH
+#undef DISPATCH_NEWIP
+#undef DISPATCH_PREFIX
+#define DISPATCH			break
+#define DISPATCH_NEWIP		continue
+#define DISPATCH_PREFIX		goto restart_opcode
+#undef CASE_LABEL
+#define CASE_LABEL(_NAME)
+
+#endif
@@ -64,18 +64,18 @@ extern Bitu cycle_count;
 	BaseDS=SegBase(_SEG);					\
 	BaseSS=SegBase(_SEG);					\
 	core.base_val_ds=_SEG;					\
-	goto restart_opcode;
+	DISPATCH_PREFIX;
 
 #define DO_PREFIX_ADDR()								\
 	core.prefixes=(core.prefixes & ~PREFIX_ADDR) |		\
 	(cpu.code.big ^ PREFIX_ADDR);						\
 	core.ea_table=&EATable[(core.prefixes&1) * 256];	\
-	goto restart_opcode;
+	DISPATCH_PREFIX;
 
 #define DO_PREFIX_REP(_ZERO)				\
 	core.prefixes|=PREFIX_REP;				\
 	core.rep_zero=_ZERO;					\
-	goto restart_opcode;
+	DISPATCH_PREFIX;
 
 typedef PhysPt (*GetEAHandler)(void);
 
@@ -132,7 +132,13 @@ static INLINE Bit32u Fetchd() {
 
 #define EALookupTable (core.ea_table)
 
+#define CORE_THREADED_RUN CPU_Core_Simple_Threaded_Run
+#include "core_normal/threaded.h"
+
 Bits CPU_Core_Simple_Run(void) {
+#if CPU_CORE_THREADED
+	if (CPU_CoreThreaded) return CPU_Core_Simple_Threaded_Run();
+#endif
 	while (CPU_Cycles-->0) {
 		LOADIP;
 		core.opcode_index=cpu.code.big*0x200;
@@ -28,6 +28,7 @@
 #include "setup.h"
 #include "programs.h"
 #include "paging.h"
+#include "pic.h"
 #include "lazyflags.h"
 #include "support.h"
 
@@ -53,12 +54,16 @@ Bit32s CPU_CycleLeft = 3000;
 Bit32s CPU_CycleMax = 3000;
 Bit32s CPU_OldCycleMax = 3000;
 Bit32s CPU_CyclePercUsed = 100;
+Bit32s CPU_CycleLoad = 0;
 Bit32s CPU_CycleLimit = -1;
 Bit32s CPU_CycleUp = 0;
 Bit32s CPU_CycleDown = 0;
 Bit64s CPU_IODelayRemoved = 0;
 CPU_Decoder * cpudecoder;
 bool CPU_CycleAutoAdjust = false;
+bool CPU_CoreThreaded = false;
+bool CPU_DecodeCache = true;
+Bitu CPU_IdleSleep = 10;
 bool CPU_SkipCycleAutoAdjust = false;
 Bitu CPU_AutoDetermineMode = 0;
 
@@ -78,6 +83,7 @@ void CPU_Core_Dyn_X86_Cache_Close(void);
 void CPU_Core_Dyn_X86_SetFPUMode(bool dh_fpu);
 #elif (C_DYNREC)
 void CPU_Core_Dynrec_Init(void);
+void CPU_Core_Dynrec_Cache_Setup(Bitu cache_size,Bitu cache_max,bool persistent);
 void CPU_Core_Dynrec_Cache_Init(bool enable_cache);
 void CPU_Core_Dynrec_Cache_Close(void);
 #endif
@@ -2069,6 +2075,10 @@ void CPU_HLT(Bitu oldeip) {
 	cpudecoder=&HLT_Decode;
 }
 
+bool CPU_IsHalted(void) {
+	return cpudecoder==&HLT_Decode;
+}
+
 void CPU_ENTER(bool use32,Bitu bytes,Bitu level) {
 	level&=0x1f;
 	Bitu sp_index=reg_esp&cpu.stack.mask;
@@ -2164,13 +2174,8 @@ void CPU_Disable_SkipAutoAdjust(void) {
 }
 
 
-extern Bit32s ticksDone;
-extern Bit32u ticksScheduled;
-
 void CPU_Reset_AutoAdjust(void) {
-	CPU_IODelayRemoved = 0;
-	ticksDone = 0;
-	ticksScheduled = 0;
+	DOSBOX_ResetAutoCycles();
 }
 
 class CPU: public Module_base {
@@ -2321,12 +2326,25 @@ public:
 
 		CPU_CycleUp=section->Get_int("cycleup");
 		CPU_CycleDown=section->Get_int("cycledown");
+		CPU_DecodeCache=section->Get_bool("decode_cache");
+		CPU_IdleSleep=section->Get_int("idlesleep");
+		CPU_PollSkip=section->Get_bool("pollskip");
+		PIC_Slices=1000/section->Get_int("timeslice");
 		std::string core(section->Get_string("core"));
 		cpudecoder=&CPU_Core_Normal_Run;
+		CPU_CoreThreaded=false;
 		if (core == "normal") {
 			cpudecoder=&CPU_Core_Normal_Run;
 		} else if (core =="simple") {
 			cpudecoder=&CPU_Core_Simple_Run;
+#if CPU_CORE_THREADED
+		} else if (core == "normal_threaded") {
+			cpudecoder=&CPU_Core_Normal_Run;
+			CPU_CoreThreaded=true;
+		} else if (core == "simple_threaded") {
+			cpudecoder=&CPU_Core_Simple_Run;
+			CPU_CoreThreaded=true;
+#endif
 		} else if (core == "full") {
 			cpudecoder=&CPU_Core_Full_Run;
 		} else if (core == "auto") {
@@ -2353,6 +2371,8 @@ public:
 #if (C_DYNAMIC_X86)
 		CPU_Core_Dyn_X86_Cache_Init((core == "dynamic") || (core == "dynamic_nodhfpu"));
 #elif (C_DYNREC)
+		CPU_Core_Dynrec_Cache_Setup(section->Get_int("dynamic_cache"),section->Get_int("dynamic_cache_max"),
+			section->Get_bool("dynamic_cache_persist"));
 		CPU_Core_Dynrec_Cache_Init( core == "dynamic" );
 #endif
 
@@ -2412,6 +2432,7 @@ public:
 static CPU * test;
 
 void CPU_ShutDown(Section* sec) {
+	CPU_PollLoopStats();
 #if (C_DYNAMIC_X86)
 	CPU_Core_Dyn_X86_Cache_Close();
 #elif (C_DYNREC)
@@ -733,46 +733,59 @@ void PAGING_LinkPage_ReadOnly(Bitu lin_page,Bitu phys_page) {
 
 #else
 
-static INLINE void InitTLBInt(tlb_entry *bank) {
- 	for (Bitu i=0;i<TLB_SIZE;i++) {
+static tlb_entry tlb_empty_bank[TLB_BANK_SIZE];
+
+static void InitTLBInt(tlb_entry *bank) {
+	for (Bitu i=0;i<TLB_BANK_SIZE;i++) {
 		bank[i].read=0;
 		bank[i].write=0;
 		bank[i].readhandler=&init_page_handler;
 		bank[i].writehandler=&init_page_handler;
- 	}
+		bank[i].phys_page=0;
+	}
 }
 
-void PAGING_InitTLBBank(tlb_entry **bank) {
-	*bank = (tlb_entry *)malloc(sizeof(tlb_entry)*TLB_SIZE);
-	if(!*bank) E_Exit("Out of Memory");
-	InitTLBInt(*bank);
+/* Entry of a page that gets mapped, the bank is allocated on first use */
+static tlb_entry *GetTLBEntryForLink(Bitu lin_page) {
+	tlb_entry * & bank=paging.tlbh_banks[lin_page >> TLB_BANK_SHIFT];
+	if (bank==tlb_empty_bank) {
+		bank=(tlb_entry *)malloc(sizeof(tlb_entry)*TLB_BANK_SIZE);
+		if (!bank) E_Exit("Out of Memory");
+		InitTLBInt(bank);
+	}
+	return &bank[lin_page & (TLB_BANK_SIZE-1)];
+}
+
+static INLINE void ClearTLBEntry(Bitu lin_page) {
+	tlb_entry *entry=get_tlb_entry(lin_page<<12);
+	/* The shared empty bank is never written */
+	if (paging.tlbh_banks[lin_page >> TLB_BANK_SHIFT]==tlb_empty_bank) return;
+	entry->read=0;
+	entry->write=0;
+	entry->readhandler=&init_page_handler;
+	entry->writehandler=&init_page_handler;
 }
 
 void PAGING_InitTLB(void) {
-	InitTLBInt(paging.tlbh);
- 	paging.links.used=0;
+	InitTLBInt(tlb_empty_bank);
+	for (Bitu i=0;i<TLB_BANKS;i++) {
+		if (paging.tlbh_banks[i] && paging.tlbh_banks[i]!=tlb_empty_bank) free(paging.tlbh_banks[i]);
+		paging.tlbh_banks[i]=tlb_empty_bank;
+	}
+	paging.links.used=0;
 }
 
 void PAGING_ClearTLB(void) {
 	Bit32u * entries=&paging.links.entries[0];
 	for (;paging.links.used>0;paging.links.used--) {
-		Bitu page=*entries++;
-		tlb_entry *entry = get_tlb_entry(page<<12);
-		entry->read=0;
-		entry->write=0;
-		entry->readhandler=&init_page_handler;
-		entry->writehandler=&init_page_handler;
+		ClearTLBEntry(*entries++);
 	}
 	paging.links.used=0;
 }
 
 void PAGING_UnlinkPages(Bitu lin_page,Bitu pages) {
 	for (;pages>0;pages--) {
-		tlb_entry *entry = get_tlb_entry(lin_page<<12);
-		entry->read=0;
-		entry->write=0;
-		entry->readhandler=&init_page_handler;
-		entry->writehandler=&init_page_handler;
+		ClearTLBEntry(lin_page);
 		lin_page++;
 	}
 }
@@ -780,10 +793,7 @@ void PAGING_UnlinkPages(Bitu lin_page,Bitu pages) {
 void PAGING_MapPage(Bitu lin_page,Bitu phys_page) {
 	if (lin_page<LINK_START) {
 		paging.firstmb[lin_page]=phys_page;
-		paging.tlbh[lin_page].read=0;
-		paging.tlbh[lin_page].write=0;
-		paging.tlbh[lin_page].readhandler=&init_page_handler;
-		paging.tlbh[lin_page].writehandler=&init_page_handler;
+		ClearTLBEntry(lin_page);
 	} else {
 		PAGING_LinkPage(lin_page,phys_page);
 	}
@@ -792,7 +802,7 @@ void PAGING_MapPage(Bitu lin_page,Bitu phys_page) {
 void PAGING_LinkPage(Bitu lin_page,Bitu phys_page) {
 	PageHandler * handler=MEM_GetPageHandler(phys_page);
 	Bitu lin_base=lin_page << 12;
-	if (lin_page>=(TLB_SIZE*(TLB_BANKS+1)) || phys_page>=(TLB_SIZE*(TLB_BANKS+1))) 
+	if (lin_page>=TLB_SIZE || phys_page>=TLB_SIZE) 
 		E_Exit("Illegal page");
 
 	if (paging.links.used>=PAGING_LINKS) {
@@ -800,14 +810,14 @@ void PAGING_LinkPage(Bitu lin_page,Bitu phys_page) {
 		PAGING_ClearTLB();
 	}
 
-	tlb_entry *entry = get_tlb_entry(lin_base);
+	tlb_entry *entry=GetTLBEntryForLink(lin_page);
 	entry->phys_page=phys_page;
 	if (handler->flags & PFLAG_READABLE) entry->read=handler->GetHostReadPt(phys_page)-lin_base;
 	else entry->read=0;
 	if (handler->flags & PFLAG_WRITEABLE) entry->write=handler->GetHostWritePt(phys_page)-lin_base;
 	else entry->write=0;
 
- 	paging.links.entries[paging.links.used++]=lin_page;
+	paging.links.entries[paging.links.used++]=lin_page;
 	entry->readhandler=handler;
 	entry->writehandler=handler;
 }
@@ -815,7 +825,7 @@ void PAGING_LinkPage(Bitu lin_page,Bitu phys_page) {
 void PAGING_LinkPage_ReadOnly(Bitu lin_page,Bitu phys_page) {
 	PageHandler * handler=MEM_GetPageHandler(phys_page);
 	Bitu lin_base=lin_page << 12;
-	if (lin_page>=(TLB_SIZE*(TLB_BANKS+1)) || phys_page>=(TLB_SIZE*(TLB_BANKS+1))) 
+	if (lin_page>=TLB_SIZE || phys_page>=TLB_SIZE) 
 		E_Exit("Illegal page");
 
 	if (paging.links.used>=PAGING_LINKS) {
@@ -823,13 +833,13 @@ void PAGING_LinkPage_ReadOnly(Bitu lin_page,Bitu phys_page) {
 		PAGING_ClearTLB();
 	}
 
-	tlb_entry *entry = get_tlb_entry(lin_base);
+	tlb_entry *entry=GetTLBEntryForLink(lin_page);
 	entry->phys_page=phys_page;
 	if (handler->flags & PFLAG_READABLE) entry->read=handler->GetHostReadPt(phys_page)-lin_base;
 	else entry->read=0;
 	entry->write=0;
 
- 	paging.links.entries[paging.links.used++]=lin_page;
+	paging.links.entries[paging.links.used++]=lin_page;
 	entry->readhandler=handler;
 	entry->writehandler=&init_page_handler_userro;
 }
@@ -0,0 +1,251 @@
+/*
+ *  Copyright (C) 2002-2019  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/*
+	Polling loop detection for the normal, simple and prefetch cores.
+
+	The cores report every taken backward short jump. When the same jump
+	is taken again with the same registers and flags, after the same
+	number of instructions, and the loop body only holds instructions
+	that read memory or ports and change nothing but registers, then the
+	next iteration will do exactly the same. That holds until an event
+	changes memory or a port, so the rest of the slice up to the next PIC
+	event can be skipped. The only ports allowed are those that change in
+	events, and the video status port, for which the skip stops at the next
+	retrace or blanking edge.
+*/
+
+#include "dosbox.h"
+#include "mem.h"
+#include "cpu.h"
+#include "lazyflags.h"
+#include "inout.h"
+#include "pic.h"
+#include "vga.h"
+
+/* Identical iterations needed before the loop gets skipped */
+#define POLL_LOOP_REPEATS	8
+/* Longest loop body that is looked at */
+#define POLL_LOOP_MAXLEN	64
+
+enum PollLoopState {
+	POLL_LOOP_IMPURE,
+	POLL_LOOP_PURE
+};
+
+static struct {
+	PhysPt head;			//Linear address of the loop start
+	Bitu len;				//Bytes up to the end of the backward jump
+	PollLoopState state;
+	Bitu body;				//Instructions in the loop body
+	Bitu count;				//Identical iterations so far
+	Bitu ticks;
+	Bits done;				//Cycles done in the tick at the last iteration
+	Bit64s removed;
+	Bits delta;				//Instructions of the last iteration
+	Bit32u regs[8];
+	Bitu flags;
+	bool skipping;
+} poll;
+
+static struct {
+	Bitu loops;
+	Bitu skips;
+	Bit64u cycles;
+} poll_stats;
+
+bool CPU_PollSkip = true;
+
+/* Length of the modrm operand in bytes, -1 if it can't be read */
+static Bits PollLoop_ModrmLen(PhysPt addr,PhysPt end,bool big_addr) {
+	if (addr>=end) return -1;
+	Bitu rm=mem_readb(addr);
+	Bitu mod=rm>>6;
+	if (mod==3) return 1;
+	if (!big_addr) {
+		if (mod==1) return 2;
+		if (mod==2 || (rm&7)==6) return 3;
+		return 1;
+	}
+	Bits len=1;
+	Bitu base=rm&7;
+	if (base==4) {
+		if (addr+1>=end) return -1;
+		base=mem_readb(addr+1)&7;
+		len++;
+	}
+	if (mod==1) return len+1;
+	if (mod==2 || base==5) return len+4;
+	return len;
+}
+
+/* Check that the code from head up to end only changes registers and flags
+   and count its instructions */
+static bool PollLoop_Analyse(PhysPt head,PhysPt end,Bitu & body) {
+	body=0;
+	PhysPt addr=head;
+	while (addr<end) {
+		bool opsize=cpu.code.big;
+		bool addrsize=cpu.code.big;
+		Bitu op;
+		for (;;) {
+			op=mem_readb(addr++);
+			if (op==0x66) opsize=!opsize;
+			else if (op==0x67) addrsize=!addrsize;
+			else if (op!=0x26 && op!=0x2e && op!=0x36 && op!=0x3e && op!=0x64 && op!=0x65) break;
+			if (addr>=end) return false;
+		}
+		Bitu imm=opsize ? 4 : 2;
+		Bits modrm=0;
+		Bitu rm=(addr<end) ? mem_readb(addr) : 0;
+		switch (op) {
+		/* ALU with the register as destination, and compares */
+		case 0x02:case 0x03:case 0x0a:case 0x0b:case 0x22:case 0x23:
+		case 0x2a:case 0x2b:case 0x32:case 0x33:case 0x38:case 0x39:
+		case 0x3a:case 0x3b:case 0x84:case 0x85:case 0x8a:case 0x8b:
+			modrm=PollLoop_ModrmLen(addr,end,addrsize);
+			break;
+		/* ALU with the modrm as destination, only to a register */
+		case 0x00:case 0x01:case 0x08:case 0x09:case 0x20:case 0x21:
+		case 0x28:case 0x29:case 0x30:case 0x31:case 0x88:case 0x89:
+			if (rm<0xc0) return false;
+			modrm=1;
+			break;
+		case 0x04:case 0x0c:case 0x24:case 0x2c:case 0x34:case 0x3c:case 0xa8:
+		case 0xe4:case 0xe5:
+			addr+=1;
+			break;
+		case 0x05:case 0x0d:case 0x25:case 0x2d:case 0x35:case 0x3d:case 0xa9:
+			addr+=imm;
+			break;
+		case 0x80:case 0x82:case 0x83:
+			if (rm<0xc0 && ((rm>>3)&7)!=7) return false;
+			if (((rm>>3)&7)==2 || ((rm>>3)&7)==3) return false;	//adc and sbb read the carry
+			modrm=PollLoop_ModrmLen(addr,end,addrsize);
+			addr+=1;
+			break;
+		case 0x81:
+			if (rm<0xc0 && ((rm>>3)&7)!=7) return false;
+			if (((rm>>3)&7)==2 || ((rm>>3)&7)==3) return false;
+			modrm=PollLoop_ModrmLen(addr,end,addrsize);
+			addr+=imm;
+			break;
+		case 0xf6:
+			if (((rm>>3)&7)!=0) return false;
+			modrm=PollLoop_ModrmLen(addr,end,addrsize);
+			addr+=1;
+			break;
+		case 0xf7:
+			if (((rm>>3)&7)!=0) return false;
+			modrm=PollLoop_ModrmLen(addr,end,addrsize);
+			addr+=imm;
+			break;
+		case 0xa0:case 0xa1:
+			addr+=addrsize ? 4 : 2;
+			break;
+		case 0xb0:case 0xb1:case 0xb2:case 0xb3:case 0xb4:case 0xb5:case 0xb6:case 0xb7:
+		case 0x70:case 0x71:case 0x72:case 0x73:case 0x74:case 0x75:case 0x76:case 0x77:
+		case 0x78:case 0x79:case 0x7a:case 0x7b:case 0x7c:case 0x7d:case 0x7e:case 0x7f:
+		case 0xeb:
+			addr+=1;
+			break;
+		case 0xb8:case 0xb9:case 0xba:case 0xbb:case 0xbc:case 0xbd:case 0xbe:case 0xbf:
+			addr+=imm;
+			break;
+		case 0x40:case 0x41:case 0x42:case 0x43:case 0x44:case 0x45:case 0x46:case 0x47:
+		case 0x48:case 0x49:case 0x4a:case 0x4b:case 0x4c:case 0x4d:case 0x4e:case 0x4f:
+		case 0x90:case 0xec:case 0xed:case 0xfa:case 0xfb:
+			break;
+		default:
+			return false;
+		}
+		if (modrm<0) return false;
+		addr+=modrm;
+		body++;
+	}
+	return addr==end;
+}
+
+void CPU_PollLoop(PhysPt head,Bitu len) {
+	Bitu reads=IO_PollReads;
+	IO_PollReads=0;
+	if (head!=poll.head || len!=poll.len) {
+		poll.head=head;
+		poll.len=len;
+		/* Classify the body right away, so loops that can't be polling
+		   return early from now on instead of being compared every pass */
+		poll.state=(len<=POLL_LOOP_MAXLEN && PollLoop_Analyse(head,head+len,poll.body)) ?
+			POLL_LOOP_PURE : POLL_LOOP_IMPURE;
+		poll.count=0;
+		poll.ticks=PIC_Ticks;
+		poll.done=CPU_CycleMax-CPU_CycleLeft-CPU_Cycles;
+		poll.removed=CPU_IODelayRemoved;
+		poll.delta=-1;
+		poll.skipping=false;
+		return;
+	}
+	if (poll.state==POLL_LOOP_IMPURE) return;
+
+	Bits done=CPU_CycleMax-CPU_CycleLeft-CPU_Cycles;
+	Bits delta=(Bits)((done-poll.done)-(CPU_IODelayRemoved-poll.removed));
+	FillFlags();
+	bool same=(poll.ticks==PIC_Ticks) && (delta==poll.delta) && !(reads&IO_POLL_OTHER) &&
+		(reg_flags==poll.flags);
+	for (Bitu i=0;i<8;i++) {
+		if (poll.regs[i]!=cpu_regs.regs[i].dword[0]) same=false;
+		poll.regs[i]=cpu_regs.regs[i].dword[0];
+	}
+	poll.ticks=PIC_Ticks;
+	poll.done=done;
+	poll.removed=CPU_IODelayRemoved;
+	poll.delta=delta;
+	poll.flags=reg_flags;
+	if (!same) {
+		poll.count=0;
+		return;
+	}
+	/* More instructions than the body has means code outside of it ran */
+	if ((Bitu)delta>poll.body) {
+		poll.count=0;
+		return;
+	}
+	if (++poll.count<POLL_LOOP_REPEATS) return;
+
+	/* Skip to the next event, which is where the slice ends */
+	Bits skip=CPU_Cycles;
+	if (reads&IO_POLL_VIDEO) {
+		Bits stable=(Bits)(VGA_StatusStable()*CPU_CycleMax);
+		if (stable<skip) skip=stable;
+	}
+	if (skip<=0) return;
+	/* Counted as removed, so auto cycles does not see it as work done */
+	CPU_Cycles-=skip;
+	CPU_IODelayRemoved+=skip;
+	poll_stats.skips++;
+	poll_stats.cycles+=skip;
+	if (!poll.skipping) {
+		poll.skipping=true;
+		poll_stats.loops++;
+	}
+}
+
+void CPU_PollLoopStats(void) {
+	if (!poll_stats.loops) return;
+	LOG_MSG("CPU: Skipped %u polling loops %u times, %.0f million cycles",
+		(unsigned int)poll_stats.loops,(unsigned int)poll_stats.skips,poll_stats.cycles/1000000.0);
+}
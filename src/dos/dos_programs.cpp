@@ -38,6 +38,9 @@
 #include "control.h"
 #include "inout.h"
 #include "dma.h"
+#include "cpu.h"
+#include "timer.h"
+#include "pic.h"
 
 
 #if defined(OS2)
@@ -1012,6 +1015,119 @@ static void LOADFIX_ProgramStart(Program * * make) {
 	*make=new LOADFIX;
 }
 
+// CPUBENCH
+
+#define CPUBENCH_CHUNK	100000
+#define CPUBENCH_TIME	500		// ms for each core
+
+class CPUBENCH : public Program {
+public:
+	void Run(void);
+private:
+	Bitu Measure(CPU_Decoder * decoder,bool threaded,Bit16u segment);
+};
+
+// Instructions per ms of decoder on the loop at segment:0
+Bitu CPUBENCH::Measure(CPU_Decoder * decoder,bool threaded,Bit16u segment) {
+	for (Bitu i=0;i<8;i++) cpu_regs.regs[i].dword[0]=0;
+	reg_eip=0;
+	reg_flags=FLAG_IF|0x2;
+	SegSet16(cs,segment);
+	SegSet16(ds,segment);
+	CPU_CoreThreaded=threaded;
+	Bit64u instructions=0;
+	Bit32u start=GetTicks();
+	Bit32u elapsed;
+	do {
+		CPU_Cycles=CPUBENCH_CHUNK;
+		(*decoder)();
+		instructions+=CPUBENCH_CHUNK-(CPU_Cycles>0 ? CPU_Cycles : 0);
+		elapsed=GetTicks()-start;
+	} while (elapsed<CPUBENCH_TIME);
+	return (Bitu)(instructions/elapsed);
+}
+
+void CPUBENCH::Run(void) {
+	if (cpu.pmode) {
+		WriteOut(MSG_Get("PROGRAM_CPUBENCH_PMODE"));
+		return;
+	}
+	/* The usual mix of the interpreter hot loop: memory operand, alu
+	   ops, flags producer and consumer and a taken branch.
+	   add ax,[si]; xor dx,ax; inc si; inc si; and si,0x3ff;
+	   shl bx,1; adc bx,0; add bx,ax; jmp 0 */
+	static const Bit8u loop[]={
+		0x03,0x04,0x31,0xc2,0x46,0x46,0x81,0xe6,0xff,0x03,
+		0xd1,0xe3,0x83,0xd3,0x00,0x01,0xc3,0xeb,0xed
+	};
+	Bit16u segment;
+	Bit16u blocks=0x400/16;
+	if (!DOS_AllocateMemory(&segment,&blocks)) {
+		WriteOut(MSG_Get("PROGRAM_CPUBENCH_ERROR"));
+		return;
+	}
+	MEM_BlockWrite(PhysMake(segment,0),loop,sizeof(loop));
+
+	CPU_Regs old_regs=cpu_regs;
+	Bit16u old_cs=SegValue(cs);
+	Bit16u old_ds=SegValue(ds);
+	Bit32s old_cycles=CPU_Cycles;
+	CPU_Decoder * old_decoder=cpudecoder;
+	bool old_threaded=CPU_CoreThreaded;
+
+	struct {
+		const char * name;
+		CPU_Decoder * decoder;
+		bool threaded;
+	} cores[]={
+		{"normal",&CPU_Core_Normal_Run,false},
+		{"simple",&CPU_Core_Simple_Run,false},
+#if CPU_CORE_THREADED
+		{"normal_threaded",&CPU_Core_Normal_Run,true},
+		{"simple_threaded",&CPU_Core_Simple_Run,true},
+#endif
+	};
+	for (Bitu i=0;i<sizeof(cores)/sizeof(cores[0]);i++) {
+		Bitu ipms=Measure(cores[i].decoder,cores[i].threaded,segment);
+		WriteOut(MSG_Get("PROGRAM_CPUBENCH_RESULT"),cores[i].name,
+			(unsigned int)(ipms/1000),(unsigned int)((ipms%1000)/100));
+	}
+
+	cpu_regs=old_regs;
+	SegSet16(cs,old_cs);
+	SegSet16(ds,old_ds);
+	CPU_Cycles=old_cycles;
+	cpudecoder=old_decoder;
+	CPU_CoreThreaded=old_threaded;
+	DOS_FreeMemory(segment);
+}
+
+static void CPUBENCH_ProgramStart(Program * * make) {
+	*make=new CPUBENCH;
+}
+
+// PICBENCH
+
+#define PICBENCH_TIME	300		// ms for each run
+
+class PICBENCH : public Program {
+public:
+	void Run(void) {
+		static const Bitu pending[]={8,32,128,480};
+		WriteOut(MSG_Get("PROGRAM_PICBENCH_HEADER"));
+		for (Bitu i=0;i<sizeof(pending)/sizeof(pending[0]);i++) {
+			Bitu queue=PIC_BenchmarkQueue(false,pending[i],PICBENCH_TIME);
+			Bitu list=PIC_BenchmarkQueue(true,pending[i],PICBENCH_TIME);
+			WriteOut(MSG_Get("PROGRAM_PICBENCH_RESULT"),(unsigned int)pending[i],
+				(unsigned int)queue,(unsigned int)list);
+		}
+	}
+};
+
+static void PICBENCH_ProgramStart(Program * * make) {
+	*make=new PICBENCH;
+}
+
 // RESCAN
 
 class RESCAN : public Program {
@@ -1543,6 +1659,13 @@ void DOS_SetupPrograms(void) {
 	MSG_Add("PROGRAM_LOADFIX_DEALLOCALL","Used memory freed.\n");
 	MSG_Add("PROGRAM_LOADFIX_ERROR","Memory allocation error.\n");
 
+	MSG_Add("PROGRAM_CPUBENCH_PMODE","CPUBENCH only runs in real mode.\n");
+	MSG_Add("PROGRAM_CPUBENCH_ERROR","Memory allocation error.\n");
+	MSG_Add("PROGRAM_CPUBENCH_RESULT","%-16s %5u.%u MIPS\n");
+
+	MSG_Add("PROGRAM_PICBENCH_HEADER","Pending  Queue events/ms   List events/ms\n");
+	MSG_Add("PROGRAM_PICBENCH_RESULT","%7u   %14u   %14u\n");
+
 	MSG_Add("MSCDEX_SUCCESS","MSCDEX installed.\n");
 	MSG_Add("MSCDEX_ERROR_MULTIPLE_CDROMS","MSCDEX: Failure: Drive-letters of multiple CD-ROM drives have to be continuous.\n");
 	MSG_Add("MSCDEX_ERROR_NOT_SUPPORTED","MSCDEX: Failure: Not yet supported.\n");
@@ -1720,6 +1843,8 @@ void DOS_SetupPrograms(void) {
 	PROGRAMS_MakeFile("MOUNT.COM",MOUNT_ProgramStart);
 	PROGRAMS_MakeFile("MEM.COM",MEM_ProgramStart);
 	PROGRAMS_MakeFile("LOADFIX.COM",LOADFIX_ProgramStart);
+	PROGRAMS_MakeFile("CPUBENCH.COM",CPUBENCH_ProgramStart);
+	PROGRAMS_MakeFile("PICBENCH.COM",PICBENCH_ProgramStart);
 	PROGRAMS_MakeFile("RESCAN.COM",RESCAN_ProgramStart);
 	PROGRAMS_MakeFile("INTRO.COM",INTRO_ProgramStart);
 	PROGRAMS_MakeFile("BOOT.COM",BOOT_ProgramStart);
@@ -40,6 +40,9 @@
 #include "support.h"
 #include "mapper.h"
 #include "ints/int10.h"
+#if C_STREAM
+#include "libs/ffmpeg/stream_settings.h"
+#endif
 #include "render.h"
 #include "pci_bus.h"
 
@@ -124,11 +127,11 @@ bool SDLNetInited;
 
 static Bit32u ticksRemain;
 static Bit32u ticksLast;
-static Bit32u ticksAdded;
-Bit32s ticksDone;
-Bit32u ticksScheduled;
 bool ticksLocked;
 void increaseticks();
+static void endslice();
+/* Host time at which the running tick started, 0 when it isn't paced */
+static Bit64u sliceStart;
 
 static Bitu Normal_Loop(void) {
 	Bits ret;
@@ -146,9 +149,15 @@ static Bitu Normal_Loop(void) {
 #endif
 		} else {
 			GFX_Events();
-			if (ticksRemain>0) {
+			if (CPU_CycleLeft>0) {
+				/* A slice of the tick is done */
+				endslice();
+			} else if (ticksRemain>0) {
 				TIMER_AddTick();
 				ticksRemain--;
+				/* Only the last tick that got handed out runs in real time */
+				if (PIC_Slices>1 && !ticksRemain && !ticksLocked) sliceStart=Cross::GetTicksUs();
+				else sliceStart=0;
 			} else {increaseticks();return 0;}
 		}
 	}
@@ -157,153 +166,137 @@ static Bitu Normal_Loop(void) {
 //For trying other delays
 #define wrap_delay(a) SDL_Delay(a)
 
+/* Auto cycles is a feedback loop on the host time each emulated cycle costs.
+   Every window the cost is measured on the microsecond clock, smoothed, and
+   the cycles are set so that an emulated ms takes the target share of a ms */
+#define AUTOCYCLES_WINDOW		20000	// us of host time between adjustments
+#define AUTOCYCLES_STALL		250000	// a batch of ticks taking longer may be a suspended host
+#define AUTOCYCLES_OVERLOAD		95		// load in percent at which the host can't keep up
+#define AUTOCYCLES_TITLE		1000000	// us between title updates
+
+static struct {
+	Bit64u mark;			// host time of the last call to increaseticks
+	Bit64u busy;			// host time spent emulating in this window
+	Bit64u slept;			// host time spent sleeping in this window
+	Bit64u cycles;			// cycles handed out in this window
+	Bit64u batch;			// cycles handed out by the last call to increaseticks
+	bool stalled;			// the window holds a suspend or a stop of the host
+	Bitu stalls;			// batches in a row that took far too long
+	double cost;			// smoothed host us per emulated cycle
+	Bit64u title;			// host time of the last title update
+} autocycles;
+
+extern void GFX_SetTitle(Bit32s cycles,Bits frameskip,bool paused);
+
+void DOSBOX_ResetAutoCycles(void) {
+	CPU_IODelayRemoved = 0;
+	autocycles.busy = 0;
+	autocycles.slept = 0;
+	autocycles.cycles = 0;
+	autocycles.stalled = false;
+}
+
+static void AutoCycles_Adjust(void) {
+	Bit64u window = autocycles.busy + autocycles.slept;
+	if (window < AUTOCYCLES_WINDOW) return;
+	Bit64s done = (Bit64s)autocycles.cycles - CPU_IODelayRemoved;
+	/* A mostly idle or stalled window says little about the host speed */
+	if (!autocycles.stalled && autocycles.busy && done > (Bit64s)(autocycles.cycles / 10)) {
+		double cost = (double)autocycles.busy / (double)done;
+		/* An overloaded host takes the new cost at once, so it recovers in one window */
+		bool overload = autocycles.busy * 100 >= window * AUTOCYCLES_OVERLOAD;
+		if (autocycles.cost > 0 && !overload) autocycles.cost += (cost - autocycles.cost) * 0.5;
+		else autocycles.cost = cost;
+
+		/* Host us that an emulated ms may take, 90% of the configured share */
+		double target = CPU_CyclePercUsed * 9.0;
+		Bit64s new_cmax = (Bit64s)(target / autocycles.cost);
+		/* Move at most a factor of 2 per window, and ignore jitter */
+		if (new_cmax > (Bit64s)CPU_CycleMax * 2) new_cmax = (Bit64s)CPU_CycleMax * 2;
+		if (new_cmax < CPU_CycleMax / 2 && !overload) new_cmax = CPU_CycleMax / 2;
+		Bit64s diff = new_cmax - CPU_CycleMax;
+		if (diff < 0) diff = -diff;
+		if (diff > CPU_CycleMax / 50) {
+			if (CPU_CycleLimit > 0) {
+				if (new_cmax > CPU_CycleLimit) new_cmax = CPU_CycleLimit;
+			} else if (new_cmax > 2000000) new_cmax = 2000000; //Hardcoded limit, if no limit was specified.
+			if (new_cmax < CPU_CYCLES_LOWER_LIMIT) new_cmax = CPU_CYCLES_LOWER_LIMIT;
+			CPU_CycleMax = (Bit32s)new_cmax;
+		}
+		LOG(LOG_CPU,LOG_NORMAL)("Auto cycles: target %.0f%%, load %d%%, %.4f us/cycle, %d cycles/ms",
+			target / 10.0, (int)(autocycles.busy * 100 / window), autocycles.cost, CPU_CycleMax);
+	}
+	CPU_CycleLoad = (Bit32s)(autocycles.busy * 100 / window);
+	if (autocycles.mark - autocycles.title >= AUTOCYCLES_TITLE) {
+		autocycles.title = autocycles.mark;
+		GFX_SetTitle(-1,-1,false);
+	}
+	DOSBOX_ResetAutoCycles();
+}
+
+static void endslice() {
+	MIXER_MixSlice();
+	if (!sliceStart) return;
+	/* Spread the slices of the tick over the ms of host time it stands for */
+	Bit64u due = sliceStart + (Bit64u)(PIC_TickIndex() * 1000);
+	Bit64u now = Cross::GetTicksUs();
+	if (now >= due) return;
+	autocycles.busy += now - autocycles.mark;
+	Cross::DelayUs((Bit32u)(due - now));
+	autocycles.mark = Cross::GetTicksUs();
+	autocycles.slept += autocycles.mark - now;
+}
+
 void increaseticks() { //Make it return ticksRemain and set it in the function above to remove the global variable.
+	Bit64u now = Cross::GetTicksUs();
+	Bit64u gap = now - autocycles.mark;
+	autocycles.busy += gap;
+	autocycles.mark = now;
+	/* A single batch taking many times its expected cost is a suspended or stopped host.
+	   When the next batch is as slow, the host really got that much slower. */
+	if (gap >= AUTOCYCLES_STALL && (autocycles.cost <= 0 || gap > autocycles.batch * autocycles.cost * 10)) {
+		if (!autocycles.stalls++) autocycles.stalled = true;
+	} else autocycles.stalls = 0;
+
 	if (GCC_UNLIKELY(ticksLocked)) { // For Fast Forward Mode
 		ticksRemain=5;
 		/* Reset any auto cycle guessing for this frame */
 		ticksLast = GetTicks();
-		ticksAdded = 0;
-		ticksDone = 0;
-		ticksScheduled = 0;
+		DOSBOX_ResetAutoCycles();
 		return;
 	}
-	
-	static Bit32s lastsleepDone = -1;
-	static Bitu sleep1count = 0;
 
 	Bit32u ticksNew;
 	ticksNew = GetTicks();
-	ticksScheduled += ticksAdded;
 	if (ticksNew <= ticksLast) { //lower should not be possible, only equal.
-		ticksAdded = 0;
-
-		if (!CPU_CycleAutoAdjust || CPU_SkipCycleAutoAdjust || sleep1count < 3) {
-			wrap_delay(1);
-		} else {
-			/* Certain configurations always give an exact sleepingtime of 1, this causes problems due to the fact that
-			   dosbox keeps track of full blocks.
-			   This code introduces some randomness to the time slept, which improves stability on those configurations
-			 */
-			static const Bit32u sleeppattern[] = { 2, 2, 3, 2, 2, 4, 2};
-			static Bit32u sleepindex = 0;
-			if (ticksDone != lastsleepDone) sleepindex = 0;
-			wrap_delay(sleeppattern[sleepindex++]);
-			sleepindex %= sizeof(sleeppattern) / sizeof(sleeppattern[0]);
-		}
-		Bit32s timeslept = GetTicks() - ticksNew;
-		// Count how many times in the current block (of 250 ms) the time slept was 1 ms
-		if (CPU_CycleAutoAdjust && !CPU_SkipCycleAutoAdjust && timeslept == 1) sleep1count++;
-		lastsleepDone = ticksDone;
-
-		// Update ticksDone with the time spent sleeping
-		ticksDone -= timeslept;
-		if (ticksDone < 0)
-			ticksDone = 0;
-		return; //0
-
-		// If we do work this tick and sleep till the next tick, then ticksDone is decreased, 
-		// despite the fact that work was done as well in this tick. Maybe make it depend on an extra parameter.
-		// What do we know: ticksRemain = 0 (condition to enter this function)
-		// ticksNew = time before sleeping
-		
-		// maybe keep track of sleeped time in this frame, and use sleeped and done as indicators. (and take care of the fact there
-		// are frames that have both.
+		/* A halted guest has nothing to do until the next event, so sleep up to it,
+		   this ms and at most CPU_IdleSleep-1 more, waking up early on input.
+		   The skipped ticks are caught up after waking, like after any late tick. */
+		if (CPU_IdleSleep && CPU_IsHalted()) GFX_IdleWait(PIC_IdleTicks(CPU_IdleSleep-1)+1);
+		else wrap_delay(1);
+		now = Cross::GetTicksUs();
+		autocycles.slept += now - autocycles.mark;
+		autocycles.mark = now;
+		return;
 	}
 
 	//TicksNew > ticksLast
 	ticksRemain = ticksNew-ticksLast;
 	ticksLast = ticksNew;
-	ticksDone += ticksRemain;
 	if ( ticksRemain > 20 ) {
 //		LOG(LOG_MISC,LOG_ERROR)("large remain %d",ticksRemain);
 		ticksRemain = 20;
 	}
-	ticksAdded = ticksRemain;
 
 	// Is the system in auto cycle mode guessing ? If not just exit. (It can be temporary disabled)
-	if (!CPU_CycleAutoAdjust || CPU_SkipCycleAutoAdjust) return;
-	
-	if (ticksScheduled >= 250 || ticksDone >= 250 || (ticksAdded > 15 && ticksScheduled >= 5) ) {
-		if(ticksDone < 1) ticksDone = 1; // Protect against div by zero
-		/* ratio we are aiming for is around 90% usage*/
-		Bit32s ratio = (ticksScheduled * (CPU_CyclePercUsed*90*1024/100/100)) / ticksDone;
-		Bit32s new_cmax = CPU_CycleMax;
-		Bit64s cproc = (Bit64s)CPU_CycleMax * (Bit64s)ticksScheduled;
-		double ratioremoved = 0.0; //increase scope for logging
-		if (cproc > 0) {
-			/* ignore the cycles added due to the IO delay code in order
-			   to have smoother auto cycle adjustments */
-			ratioremoved = (double) CPU_IODelayRemoved / (double) cproc;
-			if (ratioremoved < 1.0) {
-				double ratio_not_removed = 1 - ratioremoved;
-				ratio = (Bit32s)((double)ratio * ratio_not_removed);
-
-				/* Don't allow very high ratio which can cause us to lock as we don't scale down
-				 * for very low ratios. High ratio might result because of timing resolution */
-				if (ticksScheduled >= 250 && ticksDone < 10 && ratio > 16384)
-					ratio = 16384;
-
-				// Limit the ratio even more when the cycles are already way above the realmode default.
-				if (ticksScheduled >= 250 && ticksDone < 10 && ratio > 5120 && CPU_CycleMax > 50000)
-					ratio = 5120;
-
-				// When downscaling multiple times in a row, ensure a minimum amount of downscaling
-				if (ticksAdded > 15 && ticksScheduled >= 5 && ticksScheduled <= 20 && ratio > 800)
-					ratio = 800;
-
-				if (ratio <= 1024) {
-					// ratio_not_removed = 1.0; //enabling this restores the old formula
-					double r = (1.0 + ratio_not_removed) /(ratio_not_removed + 1024.0/(static_cast<double>(ratio)));
-					new_cmax = 1 + static_cast<Bit32s>(CPU_CycleMax * r);
-				} else {
-					Bit64s ratio_with_removed = (Bit64s) ((((double)ratio - 1024.0) * ratio_not_removed) + 1024.0);
-					Bit64s cmax_scaled = (Bit64s)CPU_CycleMax * ratio_with_removed;
-					new_cmax = (Bit32s)(1 + (CPU_CycleMax >> 1) + cmax_scaled / (Bit64s)2048);
-				}
-			}
-		}
-
-		if (new_cmax < CPU_CYCLES_LOWER_LIMIT)
-			new_cmax = CPU_CYCLES_LOWER_LIMIT;
-		/*
-		LOG(LOG_MISC,LOG_ERROR)("cyclelog: current %06d   cmax %06d   ratio  %05d  done %03d   sched %03d Add %d rr %4.2f",
-			CPU_CycleMax,
-			new_cmax,
-			ratio,
-			ticksDone,
-			ticksScheduled,
-			ticksAdded,
-			ratioremoved);
-		*/
-
-		/* ratios below 1% are considered to be dropouts due to
-		   temporary load imbalance, the cycles adjusting is skipped */
-		if (ratio > 10) {
-			/* ratios below 12% along with a large time since the last update
-			   has taken place are most likely caused by heavy load through a
-			   different application, the cycles adjusting is skipped as well */
-			if ((ratio > 120) || (ticksDone < 700)) {
-				CPU_CycleMax = new_cmax;
-				if (CPU_CycleLimit > 0) {
-					if (CPU_CycleMax > CPU_CycleLimit) CPU_CycleMax = CPU_CycleLimit;
-				} else if (CPU_CycleMax > 2000000) CPU_CycleMax = 2000000; //Hardcoded limit, if no limit was specified.
-			}
-		}
-
-		//Reset cycleguessing parameters.
-		CPU_IODelayRemoved = 0;
-		ticksDone = 0;
-		ticksScheduled = 0;
-		lastsleepDone = -1;
-		sleep1count = 0;
-	} else if (ticksAdded > 15) {
-		/* ticksAdded > 15 but ticksScheduled < 5, lower the cycles
-		   but do not reset the scheduled/done ticks to take them into
-		   account during the next auto cycle adjustment */
-		CPU_CycleMax /= 3;
-		if (CPU_CycleMax < CPU_CYCLES_LOWER_LIMIT)
-			CPU_CycleMax = CPU_CYCLES_LOWER_LIMIT;
-	} //if (ticksScheduled >= 250 || ticksDone >= 250 || (ticksAdded > 15 && ticksScheduled >= 5) )
+	if (!CPU_CycleAutoAdjust || CPU_SkipCycleAutoAdjust) {
+		DOSBOX_ResetAutoCycles();
+		return;
+	}
+	/* The busy time so far belongs to the cycles handed out before these */
+	AutoCycles_Adjust();
+	autocycles.batch = (Bit64u)ticksRemain * CPU_CycleMax;
+	autocycles.cycles += autocycles.batch;
 }
 
 void DOSBOX_SetLoop(LoopHandler * handler) {
@@ -421,11 +414,31 @@ void DOSBOX_Init(void) {
 	Pstring = secprop->Add_path("captures",Property::Changeable::Always,"capture");
 	Pstring->Set_help("Directory where things like wave, midi, screenshot get captured.");
 
+#if C_SSHOT
+	Pint = secprop->Add_int("capture_threads",Property::Changeable::Always,0);
+	Pint->SetMinMax(0,16);
+	Pint->Set_help("How many threads the video capture encoder may use. 0 uses one per processor.");
+#endif
+
 #if C_STREAM
 	Pstring = secprop->Add_string("youtube_url",Property::Changeable::WhenIdle,"");
 	Pstring->Set_help("YouTube Stream URL");
 	Pstring = secprop->Add_string("youtube_key",Property::Changeable::WhenIdle,"");
 	Pstring->Set_help("YouTube Stream name/key");
+	for (Bitu i=0;i<sizeof(stream_setting_defaults)/sizeof(stream_setting_defaults[0]);i++) {
+		const StreamSettingDefault & setting=stream_setting_defaults[i];
+		Property * prop;
+		if (setting.type==STREAM_SETTING_STRING) {
+			Pstring = secprop->Add_string(setting.name,Property::Changeable::WhenIdle,setting.text);
+			if (setting.values) Pstring->Set_values(setting.values);
+			prop = Pstring;
+		} else if (setting.type==STREAM_SETTING_INT) {
+			Pint = secprop->Add_int(setting.name,Property::Changeable::WhenIdle,setting.value);
+			Pint->SetMinMax(setting.min,setting.max);
+			prop = Pint;
+		} else prop = secprop->Add_bool(setting.name,Property::Changeable::WhenIdle,setting.value!=0);
+		prop->Set_help(setting.help);
+	}
 #endif
 
 #if C_DEBUG
@@ -437,12 +450,13 @@ void DOSBOX_Init(void) {
 	secprop->AddInitFunction(&MEM_Init);//done
 	secprop->AddInitFunction(&HARDWARE_Init);//done
 	Pint = secprop->Add_int("memsize", Property::Changeable::WhenIdle,16);
-	Pint->SetMinMax(1,63);
+	Pint->SetMinMax(1,1024);
 	Pint->Set_help(
 		"Amount of memory DOSBox has in megabytes.\n"
 		"This value is best left at its default to avoid problems with some games,\n"
 		"though few games might require a higher value.\n"
-		"There is generally no speed advantage when raising this value.");
+		"There is generally no speed advantage when raising this value.\n"
+		"Above 64 MB the memory is only visible through XMS 3.0 and int 15h e801h.");
 	secprop->AddInitFunction(&CALLBACK_Init);
 	secprop->AddInitFunction(&PIC_Init);//done
 	secprop->AddInitFunction(&PROGRAMS_Init);
@@ -485,17 +499,26 @@ void DOSBOX_Init(void) {
 #if (C_DYNAMIC_X86) || (C_DYNREC)
 		"dynamic",
 #endif
-		"normal", "simple",0 };
+		"normal", "simple",
+#if CPU_CORE_THREADED
+		"normal_threaded", "simple_threaded",
+#endif
+		0 };
 	Pstring = secprop->Add_string("core",Property::Changeable::WhenIdle,"auto");
 	Pstring->Set_values(cores);
 	Pstring->Set_help("CPU Core used in emulation. auto will switch to dynamic if available and\n"
-		"appropriate.");
+		"appropriate. The _threaded variants of normal and simple dispatch the opcodes\n"
+		"through a jump table, which is faster on most hosts.");
 
 	const char* cputype_values[] = { "auto", "386", "386_slow", "486_slow", "pentium_slow", "386_prefetch", 0};
 	Pstring = secprop->Add_string("cputype",Property::Changeable::Always,"auto");
 	Pstring->Set_values(cputype_values);
 	Pstring->Set_help("CPU Type used in emulation. auto is the fastest choice.");
 
+	Pbool = secprop->Add_bool("decode_cache",Property::Changeable::Always,true);
+	Pbool->Set_help("Let the normal core keep the common instructions in decoded form, so they\n"
+		"don't need to be decoded again every time they run.");
+
 
 	Pmulti_remain = secprop->Add_multiremain("cycles",Property::Changeable::Always," ");
 	Pmulti_remain->Set_help(
@@ -516,6 +539,22 @@ void DOSBOX_Init(void) {
 
 	Pstring = Pmulti_remain->GetSection()->Add_string("parameters",Property::Changeable::Always,"");
 
+	Pint = secprop->Add_int("idlesleep",Property::Changeable::Always,10);
+	Pint->SetMinMax(0,19);
+	Pint->Set_help("While the guest is halted or waits for a key, the host sleeps until the next\n"
+		"timer event or input, at most this many milliseconds. 0 disables it.");
+
+	Pbool = secprop->Add_bool("pollskip",Property::Changeable::Always,true);
+	Pbool->Set_help("Let the normal, simple and prefetch cores detect loops that only poll a status port,\n"
+		"a timer tick or a keyboard bit, and skip ahead to the next event in them.");
+
+	const char* timeslices[] = { "1000", "500", "250", "200", "125", "100", 0 };
+	Pint = secprop->Add_int("timeslice",Property::Changeable::Always,1000);
+	Pint->Set_values(timeslices);
+	Pint->Set_help("Length in microseconds of the slices the emulation runs in. Input is read, sound\n"
+		"is mixed and the host waits for real time after each slice, so shorter slices\n"
+		"lower the input and sound latency at some cost in speed.");
+
 	Pint = secprop->Add_int("cycleup",Property::Changeable::Always,10);
 	Pint->SetMinMax(1,1000000);
 	Pint->Set_help("Amount of cycles to decrease/increase with keycombos.(CTRL-F11/CTRL-F12)");
@@ -524,6 +563,21 @@ void DOSBOX_Init(void) {
 	Pint->SetMinMax(1,1000000);
 	Pint->Set_help("Setting it lower than 100 will be a percentage.");
 
+#if (C_DYNREC)
+	Pint = secprop->Add_int("dynamic_cache",Property::Changeable::OnlyAtStart,8);
+	Pint->SetMinMax(1,512);
+	Pint->Set_help("Size of the dynamic core code cache in MB.");
+
+	Pint = secprop->Add_int("dynamic_cache_max",Property::Changeable::WhenIdle,64);
+	Pint->SetMinMax(0,2048);
+	Pint->Set_help("The dynamic core code cache grows up to this many MB when it fills up.\n"
+		"Below dynamic_cache the cache keeps its size.");
+
+	Pbool = secprop->Add_bool("dynamic_cache_persist",Property::Changeable::OnlyAtStart,false);
+	Pbool->Set_help("Keep the code translated by the dynamic core in a file in the configuration\n"
+		"directory, so it doesn't need to be translated again in the next session.");
+#endif
+
 #if C_FPU
 	secprop->AddInitFunction(&FPU_Init);
 #endif
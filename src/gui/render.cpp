@@ -114,6 +114,7 @@ static void RENDER_StartLineHandler(const void * s) {
 			x--; src++; cache++;
 		}
 	}
+	*render.scale.srcChanged++ = 0;
 	render.scale.cacheRead += render.scale.cachePitch;
 	Scaler_ChangedLines[0] += Scaler_Aspect[ render.scale.inLine ];
 	render.scale.inLine++;
@@ -129,6 +130,7 @@ static void RENDER_FinishLineHandler(const void * s) {
 			x--; src++; cache++;
 		}
 	}
+	*render.scale.srcChanged++ = s ? 1 : 0;
 	render.scale.cacheRead += render.scale.cachePitch;
 }
 
@@ -160,6 +162,10 @@ bool RENDER_StartUpdate(void) {
 	render.scale.inLine = 0;
 	render.scale.outLine = 0;
 	render.scale.cacheRead = (Bit8u*)&scalerSourceCache;
+	render.scale.srcChanged = Scaler_SourceChanged;
+	/* Lines that never get drawn keep their old contents */
+	if (GCC_UNLIKELY(CaptureState & (CAPTURE_VIDEO|STREAM_VIDEO)))
+		memset(Scaler_SourceChanged, 0, render.src.height);
 	render.scale.outWrite = 0;
 	render.scale.outPitch = 0;
 	Scaler_ChangedLines[0] = 0;
@@ -216,7 +222,7 @@ void RENDER_EndUpdate( bool abort ) {
 		if (render.frameskip.max)
 			fps /= 1+render.frameskip.max;
 		CAPTURE_AddImage( render.src.width, render.src.height, render.src.bpp, pitch,
-			flags, fps, (Bit8u *)&scalerSourceCache, (Bit8u*)&render.pal.rgb );
+			flags, fps, (Bit8u *)&scalerSourceCache, (Bit8u*)&render.pal.rgb, Scaler_SourceChanged );
 	}
 	if ( render.scale.outWrite ) {
 		GFX_EndUpdate( abort? NULL : Scaler_ChangedLines );
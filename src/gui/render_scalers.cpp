@@ -28,6 +28,7 @@
 Bit8u Scaler_Aspect[SCALER_MAXHEIGHT];
 Bit16u Scaler_ChangedLines[SCALER_MAXHEIGHT];
 Bitu Scaler_ChangedLineIndex;
+Bit8u Scaler_SourceChanged[SCALER_MAXHEIGHT];
 
 static union {
 	Bit32u b32 [4][SCALER_MAXWIDTH*3];
@@ -30,6 +30,7 @@ static void conc4d(SCALERNAME,SBPP,DBPP,R)(const void *s) {
 #else
 		Bitu skipLines = Scaler_Aspect[ render.scale.outLine++ ];
 #endif
+		*render.scale.srcChanged++ = 0;
 		ScalerAddLines( 0, skipLines );
 		return;
 	}
@@ -111,6 +112,7 @@ static void conc4d(SCALERNAME,SBPP,DBPP,R)(const void *s) {
 			render.src.width * SCALERWIDTH * PSIZE);
 	}
 #endif
+	*render.scale.srcChanged++ = (Bit8u)hadChange;
 	ScalerAddLines( hadChange, scaleLines );
 }
 
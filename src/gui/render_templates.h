@@ -157,6 +157,7 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 #ifdef RENDER_NULL_INPUT
 	if (!s) {
 		render.scale.cacheRead += render.scale.cachePitch;
+		*render.scale.srcChanged++ = 0;
 		render.scale.inLine++;
 		render.scale.complexHandler();
 		return;
@@ -206,6 +207,7 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 		CC[render.scale.inLine+1][0] = 1;
 		CC[render.scale.inLine+2][0] = 1;
 	}
+	*render.scale.srcChanged++ = hadChange ? 1 : 0;
 	render.scale.inLine++;
 	render.scale.complexHandler();
 }
@@ -292,7 +292,7 @@ void GFX_SetTitle(Bit32s cycles,Bits frameskip,bool paused){
 	if(cycles != -1) internal_cycles = cycles;
 	if(frameskip != -1) internal_frameskip = frameskip;
 	if(CPU_CycleAutoAdjust) {
-		sprintf(title,"DOSBox %s, CPU speed: max %3d%% cycles, Frameskip %2d, Program: %8s",VERSION,internal_cycles,internal_frameskip,RunningProgram);
+		sprintf(title,"DOSBox %s, CPU speed: max %3d%% cycles (%d/ms, load %d%%), Frameskip %2d, Program: %8s",VERSION,internal_cycles,(int)CPU_CycleMax,(int)CPU_CycleLoad,internal_frameskip,RunningProgram);
 	} else {
 		sprintf(title,"DOSBox %s, CPU speed: %8d cycles, Frameskip %2d, Program: %8s",VERSION,internal_cycles,internal_frameskip,RunningProgram);
 	}
@@ -1683,6 +1683,18 @@ void GFX_Events() {
 	}
 }
 
+/* Sleep up to ms milliseconds, but wake up as soon as there is an event to handle */
+void GFX_IdleWait(Bitu ms) {
+	Bit32u start=GetTicks();
+	SDL_Event event;
+	for (;;) {
+		SDL_PumpEvents();
+		if (SDL_PeepEvents(&event,1,SDL_PEEKEVENT,SDL_ALLEVENTS)>0) return;
+		if ((GetTicks()-start)>=ms) return;
+		SDL_Delay(1);
+	}
+}
+
 #if defined (WIN32)
 static BOOL WINAPI ConsoleEventHandler(DWORD event) {
 	switch (event) {
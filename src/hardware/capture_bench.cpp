@@ -0,0 +1,496 @@
+/*
+ *  Copyright (C) 2002-2019  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Capture benchmark, feeds frame sequences through CAPTURE_AddImage and
+ * reports what each capture path costs. Not built by default, use
+ * "make capbench" in src/hardware after building dosbox.
+ *
+ * The capture code runs as it does in dosbox, configured through a
+ * capture section like the [dosbox] one. Only the mapper, the gui messages
+ * and the running program name are replaced by the stubs below. */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "dosbox.h"
+#include "hardware.h"
+#include "setup.h"
+#include "support.h"
+#include "mapper.h"
+#include "render.h"
+#include "timer.h"
+#include "cross.h"
+#if C_STREAM
+#include "../libs/ffmpeg/stream_settings.h"
+#endif
+
+/* Stubs for the parts of dosbox the capture code calls */
+const char * RunningProgram = "CAPBENCH";
+Bitu PIC_Ticks = 0;
+static bool verbose = false;
+
+void HARDWARE_Init(Section*);
+
+void GFX_ShowMsg(char const * format,...) {
+	if (!verbose)
+		return;
+	va_list msg;
+	va_start(msg,format);
+	vfprintf(stderr,format,msg);
+	va_end(msg);
+	fputc('\n',stderr);
+}
+
+void MSG_Add(const char * /*name*/,const char * /*value*/) {
+}
+
+const char * MSG_Get(char const * msg) {
+	return msg;
+}
+
+static std::map<std::string,MAPPER_Handler *> handlers;
+
+void MAPPER_AddHandler(MAPPER_Handler * handler,MapKeys /*key*/,Bitu /*mods*/,char const * const eventname,char const * const /*buttonname*/) {
+	handlers[eventname] = handler;
+}
+
+static void PressEvent(const char * name) {
+	std::map<std::string,MAPPER_Handler *>::iterator it = handlers.find(name);
+	if (it != handlers.end())
+		it->second(true);
+}
+
+/* Only the properties the capture code reads, with the dosbox defaults */
+static Section_prop * NewSection(std::vector<std::string> const & settings, Bitu run) {
+	Section_prop * secprop = new Section_prop("capbench");
+	secprop->Add_path("captures",Property::Changeable::Always,"capture");
+#if C_SSHOT
+	Prop_int * Pint = secprop->Add_int("capture_threads",Property::Changeable::Always,0);
+	Pint->SetMinMax(0,16);
+#endif
+#if C_STREAM
+	secprop->Add_string("youtube_url",Property::Changeable::WhenIdle,"");
+	secprop->Add_string("youtube_key",Property::Changeable::WhenIdle,"");
+	for (Bitu i=0;i<sizeof(stream_setting_defaults)/sizeof(stream_setting_defaults[0]);i++) {
+		const StreamSettingDefault & setting = stream_setting_defaults[i];
+		if (setting.type == STREAM_SETTING_STRING) {
+			Prop_string * Pstring = secprop->Add_string(setting.name,Property::Changeable::WhenIdle,setting.text);
+			if (setting.values) Pstring->Set_values(setting.values);
+		} else if (setting.type == STREAM_SETTING_INT) {
+			Prop_int * Pvalue = secprop->Add_int(setting.name,Property::Changeable::WhenIdle,setting.value);
+			Pvalue->SetMinMax(setting.min,setting.max);
+		} else secprop->Add_bool(setting.name,Property::Changeable::WhenIdle,setting.value!=0);
+	}
+#endif
+	for (Bitu i=0;i<settings.size();i++) {
+		if (!secprop->HandleInputline(settings[i]))
+			fprintf(stderr,"Ignoring setting %s\n",settings[i].c_str());
+	}
+#if C_STREAM
+	/* Every run streams to a file of its own in the capture directory */
+	if (!strlen(secprop->Get_string("stream_output"))) {
+		char name[64];
+		sprintf(name,"%ccapbench_stream%03d.mkv",CROSS_FILESPLIT,(int)run);
+		std::string output("stream_output=");
+		output += secprop->Get_path("captures")->realpath;
+		output += name;
+		secprop->HandleInputline(output);
+	}
+#endif
+	return secprop;
+}
+
+/* Files in the capture directory, to find what a run wrote */
+static void ListFiles(std::string const & dirname, std::set<std::string> & files) {
+	files.clear();
+	dir_information * dir = open_directory(dirname.c_str());
+	if (!dir)
+		return;
+	char name[CROSS_LEN];
+	bool is_directory;
+	for (bool found = read_directory_first(dir,name,is_directory); found; found = read_directory_next(dir,name,is_directory)) {
+		if (!is_directory)
+			files.insert(name);
+	}
+	close_directory(dir);
+}
+
+static Bit64u CollectFiles(std::string const & dirname, std::set<std::string> const & before, bool keep) {
+	std::set<std::string> after;
+	ListFiles(dirname,after);
+	Bit64u bytes = 0;
+	for (std::set<std::string>::const_iterator it = after.begin(); it != after.end(); it++) {
+		if (before.count(*it))
+			continue;
+		std::string path = dirname + CROSS_FILESPLIT + *it;
+		struct stat status;
+		if (stat(path.c_str(),&status) == 0)
+			bytes += status.st_size;
+		if (!keep)
+			remove(path.c_str());
+	}
+	return bytes;
+}
+
+/* A looping sequence of source frames with the lines that changed from
+ * the frame before, the way the renderer hands them to the capture code */
+struct Sequence {
+	Bitu width, height, bpp, pitch;
+	Bitu count;
+	std::vector<Bit8u> data;
+	std::vector<Bit8u> changed;
+	Bit8u * Frame(Bitu i) { return &data[(i % count) * pitch * height]; }
+	Bit8u * Changed(Bitu i) { return &changed[(i % count) * height]; }
+};
+
+static void PutPixel(Bit8u * line, Bitu x, Bitu bpp, Bitu r, Bitu g, Bitu b) {
+	switch (bpp) {
+	case 8:
+		line[x] = (Bit8u)((r & 0xe0) | ((g >> 3) & 0x1c) | (b >> 6));
+		break;
+	case 15:
+		((Bit16u *)line)[x] = (Bit16u)(((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3));
+		break;
+	case 16:
+		((Bit16u *)line)[x] = (Bit16u)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+		break;
+	case 32:
+		((Bit32u *)line)[x] = (Bit32u)((r << 16) | (g << 8) | b);
+		break;
+	}
+}
+
+/* Flat blocks of colour, closer to dos graphics than noise */
+static void DrawPattern(Bit8u * line, Bitu x, Bitu y, Bitu bpp, Bitu shade) {
+	Bitu bx = x >> 3, by = y >> 3;
+	PutPixel(line, x, bpp, (bx * 24 + shade) & 0xff, (by * 20) & 0xff, ((bx ^ by) * 16) & 0xff);
+}
+
+static void MarkChanges(Sequence & seq) {
+	for (Bitu f=0;f<seq.count;f++) {
+		Bit8u * cur = seq.Frame(f);
+		Bit8u * prev = seq.Frame(f + seq.count - 1);
+		for (Bitu y=0;y<seq.height;y++)
+			seq.Changed(f)[y] = memcmp(cur + y * seq.pitch, prev + y * seq.pitch, seq.pitch) ? 1 : 0;
+	}
+}
+
+static void MakeSynthetic(Sequence & seq, const char * scene) {
+	for (Bitu f=0;f<seq.count;f++) {
+		Bit8u * frame = seq.Frame(f);
+		Bitu sx = (f * 3) % (seq.width - 32);
+		Bitu sy = (f * 2) % (seq.height - 32);
+		for (Bitu y=0;y<seq.height;y++) {
+			Bit8u * line = frame + y * seq.pitch;
+			for (Bitu x=0;x<seq.width;x++) {
+				if (!strcmp(scene,"scroll"))
+					DrawPattern(line, x, y + f, seq.bpp, 0);
+				else if (!strcmp(scene,"sprite") && x - sx < 32 && y - sy < 32)
+					DrawPattern(line, x, y, seq.bpp, 0x80);
+				else
+					DrawPattern(line, x, y, seq.bpp, 0);
+			}
+		}
+	}
+	MarkChanges(seq);
+}
+
+static bool LoadRaw(Sequence & seq, const char * filename) {
+	FILE * file = fopen(filename,"rb");
+	if (!file) {
+		fprintf(stderr,"Can't open %s\n",filename);
+		return false;
+	}
+	Bitu frames = 0;
+	while (frames < seq.count && fread(seq.Frame(frames), seq.pitch * seq.height, 1, file) == 1)
+		frames++;
+	fclose(file);
+	if (!frames) {
+		fprintf(stderr,"%s holds no complete %dx%d %d bpp frame\n",filename,(int)seq.width,(int)seq.height,(int)seq.bpp);
+		return false;
+	}
+	seq.count = frames;
+	seq.data.resize(frames * seq.pitch * seq.height);
+	MarkChanges(seq);
+	return true;
+}
+
+struct Options {
+	Bitu width, height;
+	Bitu frames;
+	Bitu minTime;
+	bool keep;
+	const char * raw;
+	std::vector<std::string> settings;
+};
+
+static const char * FlagName(Bitu flags) {
+	switch (flags) {
+	case CAPTURE_FLAG_DBLW: return "dblw";
+	case CAPTURE_FLAG_DBLH: return "dblh";
+	case CAPTURE_FLAG_DBLW|CAPTURE_FLAG_DBLH: return "dblw+dblh";
+	}
+	return "-";
+}
+
+static void RunCase(Options const & opt, Sequence & seq, const char * path, const char * scene, bool cycle, Bitu flags, Bitu run) {
+	Section_prop * section = NewSection(opt.settings, run);
+	std::string dirname = section->Get_path("captures")->realpath;
+	Cross::CreateDir(dirname);
+	std::set<std::string> before;
+	ListFiles(dirname,before);
+
+	Bit8u pal[256*4], basePal[256*4];
+	for (Bitu i=0;i<256;i++) {
+		basePal[i*4+0] = (Bit8u)(i & 0xe0);
+		basePal[i*4+1] = (Bit8u)((i << 3) & 0xe0);
+		basePal[i*4+2] = (Bit8u)((i << 6) & 0xc0);
+		basePal[i*4+3] = 0;
+	}
+	memcpy(pal, basePal, sizeof(pal));
+
+	HARDWARE_Init(section);
+	bool png = !strcmp(path,"png");
+	if (!strcmp(path,"zmbv"))
+		PressEvent("video");
+	else if (!strcmp(path,"stream"))
+		PressEvent("stream");
+
+	/* Png compression runs on the writer thread and only shows in the
+	 * total time, so png runs stick to the frame count */
+	Bitu frames = 0;
+	Bitu start = GetTicks();
+	Bitu addTime = 0;
+	while (frames < opt.frames || (!png && addTime < opt.minTime)) {
+		if (cycle) {
+			for (Bitu i=0;i<256;i++)
+				memcpy(&pal[i*4], &basePal[((i + frames) & 0xff) * 4], 4);
+		}
+		if (png)
+			PressEvent("scrshot");
+		CAPTURE_AddImage(seq.width, seq.height, seq.bpp, seq.pitch, flags, 70.0f,
+			seq.Frame(frames), pal, seq.Changed(frames));
+		frames++;
+		addTime = GetTicks() - start;
+	}
+	if (!strcmp(path,"zmbv"))
+		PressEvent("video");
+	else if (!strcmp(path,"stream"))
+		PressEvent("stream");
+	/* Closes the capture and waits for the writer to finish */
+	delete section;
+	Bitu totalTime = GetTicks() - start;
+
+	Bit64u bytes = CollectFiles(dirname, before, opt.keep);
+	double pixels = (double)frames * seq.width * seq.height;
+	if (flags & CAPTURE_FLAG_DBLW) pixels *= 2;
+	if (flags & CAPTURE_FLAG_DBLH) pixels *= 2;
+	char bppName[8];
+	sprintf(bppName,"%d%s",(int)seq.bpp,cycle ? "p" : "");
+	printf("%-6s %-4s %-9s %-6s %6d %9.1f %8.2f %9.1f %8.2f %11.0f %9.0f\n",
+		path, bppName, FlagName(flags), scene, (int)frames,
+		addTime ? frames * 1000.0 / addTime : 0.0, addTime * 1e6 / pixels,
+		totalTime ? frames * 1000.0 / totalTime : 0.0, totalTime * 1e6 / pixels,
+		(double)bytes, (double)bytes / frames);
+	fflush(stdout);
+	if (!bytes)
+		fprintf(stderr,"Nothing was captured, -v shows why\n");
+}
+
+/* Splits a comma separated option, empty keeps the defaults */
+static void SplitList(const char * list, std::vector<std::string> & items) {
+	if (!list)
+		return;
+	items.clear();
+	std::string rest(list);
+	while (!rest.empty()) {
+		std::string::size_type comma = rest.find(',');
+		items.push_back(rest.substr(0,comma));
+		if (comma == std::string::npos)
+			break;
+		rest.erase(0,comma + 1);
+	}
+}
+
+static void Usage(void) {
+	printf("Usage: capbench [options] [setting=value ...]\n"
+		"  -path list    capture paths: zmbv,png"
+#if C_STREAM
+		",stream"
+#endif
+		"\n"
+		"  -bpp list     source formats: 8,8p,15,16,32, 8p cycles the palette every frame\n"
+		"  -flags list   doubling: none,dblw,dblh,both\n"
+		"  -scene list   synthetic sequences: static,sprite,scroll\n"
+		"  -raw file     use raw frames from a file instead, needs a single -bpp\n"
+		"  -size WxH     source frame size, default 320x200\n"
+		"  -frames n     frames per run, default 100\n"
+		"  -time ms      keep going until this much time was spent adding frames, default 250\n"
+		"  -keep         keep the captured files\n"
+		"  -v            show the capture messages\n"
+		"Settings are capture settings from the [dosbox] section, such as\n"
+		"captures=dir, capture_threads=n or stream_output=file.\n"
+		"add is the time spent in CAPTURE_AddImage, total includes waiting for the\n"
+		"capture files to be written.\n");
+}
+
+static int BenchMain(int argc, char * argv[]) {
+	Options opt;
+	opt.width = 320;
+	opt.height = 200;
+	opt.frames = 100;
+	opt.minTime = 250;
+	opt.keep = false;
+	opt.raw = 0;
+	std::vector<std::string> paths, bpps, flagList, scenes;
+	SplitList("zmbv,png"
+#if C_STREAM
+		",stream"
+#endif
+		, paths);
+	SplitList("8,8p,15,16,32", bpps);
+	SplitList("none,dblw,dblh,both", flagList);
+	SplitList("static,sprite,scroll", scenes);
+
+	for (int i=1;i<argc;i++) {
+		const char * arg = argv[i];
+		const char * value = (i + 1 < argc) ? argv[i + 1] : 0;
+		if (!strcmp(arg,"-path") && value) { SplitList(value, paths); i++; }
+		else if (!strcmp(arg,"-bpp") && value) { SplitList(value, bpps); i++; }
+		else if (!strcmp(arg,"-flags") && value) { SplitList(value, flagList); i++; }
+		else if (!strcmp(arg,"-scene") && value) { SplitList(value, scenes); i++; }
+		else if (!strcmp(arg,"-raw") && value) { opt.raw = value; i++; }
+		else if (!strcmp(arg,"-frames") && value) { opt.frames = atoi(value); i++; }
+		else if (!strcmp(arg,"-time") && value) { opt.minTime = atoi(value); i++; }
+		else if (!strcmp(arg,"-size") && value) {
+			int w, h;
+			if (sscanf(value,"%dx%d",&w,&h) != 2 || w < 64 || h < 64) {
+				fprintf(stderr,"Bad size %s\n",value);
+				return 1;
+			}
+			opt.width = w;
+			opt.height = h;
+			i++;
+		}
+		else if (!strcmp(arg,"-keep")) opt.keep = true;
+		else if (!strcmp(arg,"-v")) verbose = true;
+		else if (arg[0] != '-' && strchr(arg,'=')) opt.settings.push_back(arg);
+		else {
+			Usage();
+			return 1;
+		}
+	}
+	if (opt.frames < 1)
+		opt.frames = 1;
+	if (opt.raw) {
+		if (bpps.size() != 1) {
+			fprintf(stderr,"-raw needs a single -bpp\n");
+			return 1;
+		}
+		scenes.clear();
+		scenes.push_back("raw");
+	}
+
+	printf("%-6s %-4s %-9s %-6s %6s %9s %8s %9s %8s %11s %9s\n",
+		"path", "bpp", "flags", "scene", "frames",
+		"add fps", "ns/px", "total fps", "ns/px", "bytes", "bytes/frm");
+	Bitu run = 0;
+	for (Bitu b=0;b<bpps.size();b++) {
+		Sequence seq;
+		seq.bpp = atoi(bpps[b].c_str());
+		bool cycle = bpps[b].find('p') != std::string::npos;
+		if ((seq.bpp != 8 && seq.bpp != 15 && seq.bpp != 16 && seq.bpp != 32) || (cycle && seq.bpp != 8)) {
+			fprintf(stderr,"Unsupported bpp %s\n",bpps[b].c_str());
+			continue;
+		}
+		seq.width = opt.width;
+		seq.height = opt.height;
+		if (seq.width > SCALER_MAXWIDTH / 2 || seq.height > SCALER_MAXHEIGHT / 2) {
+			fprintf(stderr,"Frames can be up to %dx%d to leave room for doubling\n",SCALER_MAXWIDTH / 2,SCALER_MAXHEIGHT / 2);
+			return 1;
+		}
+		seq.pitch = seq.width * ((seq.bpp + 7) / 8);
+		for (Bitu s=0;s<scenes.size();s++) {
+			/* Up to 64 frames, at most 64 MB, in a loop */
+			seq.count = (64 * 1024 * 1024) / (seq.pitch * seq.height);
+			if (seq.count > 64) seq.count = 64;
+			if (seq.count < 2) seq.count = 2;
+			seq.data.resize(seq.count * seq.pitch * seq.height);
+			seq.changed.resize(seq.count * seq.height);
+			if (opt.raw) {
+				if (!LoadRaw(seq, opt.raw))
+					return 1;
+			} else if (scenes[s] == "static" || scenes[s] == "sprite" || scenes[s] == "scroll") {
+				MakeSynthetic(seq, scenes[s].c_str());
+			} else {
+				fprintf(stderr,"Unknown scene %s\n",scenes[s].c_str());
+				continue;
+			}
+			for (Bitu f=0;f<flagList.size();f++) {
+				Bitu flags;
+				if (flagList[f] == "none") flags = 0;
+				else if (flagList[f] == "dblw") flags = CAPTURE_FLAG_DBLW;
+				else if (flagList[f] == "dblh") flags = CAPTURE_FLAG_DBLH;
+				else if (flagList[f] == "both") flags = CAPTURE_FLAG_DBLW|CAPTURE_FLAG_DBLH;
+				else {
+					fprintf(stderr,"Unknown flags %s\n",flagList[f].c_str());
+					continue;
+				}
+				for (Bitu p=0;p<paths.size();p++) {
+					if (paths[p] != "zmbv" && paths[p] != "png"
+#if C_STREAM
+						&& paths[p] != "stream"
+#endif
+						) {
+						fprintf(stderr,"Unknown path %s\n",paths[p].c_str());
+						continue;
+					}
+					RunCase(opt, seq, paths[p].c_str(), scenes[s].c_str(), cycle, flags, run++);
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char * argv[]) {
+#if !(C_SSHOT)
+	fprintf(stderr,"capbench needs dosbox built with screenshot support\n");
+	return 1;
+#endif
+	if (SDL_Init(SDL_INIT_TIMER|SDL_INIT_NOPARACHUTE) < 0) {
+		fprintf(stderr,"Can't init SDL %s\n",SDL_GetError());
+		return 1;
+	}
+	int ret;
+	try {
+		ret = BenchMain(argc, argv);
+	} catch (char * error) {
+		fprintf(stderr,"Exit to error: %s",error);
+		ret = 1;
+	}
+	SDL_Quit();
+	return ret;
+}
@@ -0,0 +1,303 @@
+/*
+ *  Copyright (C) 2002-2019  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Background writer for the capture files.
+ * The emulation thread only copies data into batches, the writer thread
+ * does the actual file i/o and runs deferred jobs like png compression.
+ * Everything queued runs in order, so writes to a file keep their order. */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "SDL.h"
+#include "dosbox.h"
+#include "hardware.h"
+
+#define WRITER_BATCH	(256*1024)
+/* Block the emulation thread rather than queue more than this */
+#define WRITER_LIMIT	(64*1024*1024)
+#define WRITER_FILES	8
+
+struct WriteOp {
+	enum { OP_WRITE, OP_CLOSE, OP_JOB } type;
+	FILE * handle;
+	long pos;				/* -1 appends */
+	Bit8u * data;			/* malloced, freed once written */
+	Bitu size;
+	void (*job)(void * data);
+	void * jobData;
+	WriteOp * next;
+};
+
+static struct {
+	SDL_Thread * thread;
+	SDL_mutex * lock;
+	SDL_cond * work;
+	SDL_cond * done;
+	WriteOp * head, * tail;
+	bool quit, failed;
+	Bitu backlog, peak;
+	/* Appended data waiting for a batch to fill up, one batch per file */
+	struct {
+		FILE * handle;
+		Bit8u * data;
+		Bitu used;
+	} batch[WRITER_FILES];
+	Bitu nextBatch;
+} writer;
+
+static Bitu RunOp(WriteOp * op) {
+	Bitu size = op->size;
+	switch (op->type) {
+	case WriteOp::OP_WRITE:
+		if (op->pos >= 0) {
+			fseek(op->handle, op->pos, SEEK_SET);
+			fwrite(op->data, 1, op->size, op->handle);
+			fseek(op->handle, 0, SEEK_END);
+		} else {
+			fwrite(op->data, 1, op->size, op->handle);
+		}
+		free(op->data);
+		break;
+	case WriteOp::OP_CLOSE:
+		fclose(op->handle);
+		break;
+	case WriteOp::OP_JOB:
+		op->job(op->jobData);
+		break;
+	}
+	delete op;
+	return size;
+}
+
+static int CAPTURE_WriterThread(void * /*data*/) {
+	SDL_mutexP(writer.lock);
+	for (;;) {
+		while (!writer.head && !writer.quit)
+			SDL_CondWait(writer.work, writer.lock);
+		WriteOp * op = writer.head;
+		if (!op)
+			break;
+		writer.head = op->next;
+		if (!writer.head)
+			writer.tail = 0;
+		SDL_mutexV(writer.lock);
+
+		Bitu size = RunOp(op);
+
+		SDL_mutexP(writer.lock);
+		writer.backlog -= size;
+		SDL_CondSignal(writer.done);
+	}
+	SDL_mutexV(writer.lock);
+	return 0;
+}
+
+static bool StartWriter(void) {
+	if (writer.thread)
+		return true;
+	if (writer.failed)
+		return false;
+	writer.lock = SDL_CreateMutex();
+	writer.work = SDL_CreateCond();
+	writer.done = SDL_CreateCond();
+	writer.quit = false;
+	if (writer.lock && writer.work && writer.done)
+		writer.thread = SDL_CreateThread(&CAPTURE_WriterThread, 0);
+	if (!writer.thread) {
+		LOG_MSG("Failed to start the capture writer thread, writing directly");
+		if (writer.done) SDL_DestroyCond(writer.done);
+		if (writer.work) SDL_DestroyCond(writer.work);
+		if (writer.lock) SDL_DestroyMutex(writer.lock);
+		writer.done = writer.work = 0;
+		writer.lock = 0;
+		writer.failed = true;
+		return false;
+	}
+	return true;
+}
+
+static void Enqueue(WriteOp * op) {
+	op->next = 0;
+	if (!StartWriter()) {
+		RunOp(op);
+		return;
+	}
+	SDL_mutexP(writer.lock);
+	if (writer.backlog > WRITER_LIMIT) {
+		LOG_MSG("Capture writer is %d KB behind, waiting for it", (int)(writer.backlog / 1024));
+		while (writer.backlog > WRITER_LIMIT / 2)
+			SDL_CondWait(writer.done, writer.lock);
+	}
+	if (writer.tail)
+		writer.tail->next = op;
+	else
+		writer.head = op;
+	writer.tail = op;
+	writer.backlog += op->size;
+	if (writer.backlog > writer.peak)
+		writer.peak = writer.backlog;
+	SDL_CondSignal(writer.work);
+	SDL_mutexV(writer.lock);
+}
+
+static void QueueData(FILE * handle, long pos, Bit8u * data, Bitu size) {
+	WriteOp * op = new WriteOp;
+	op->type = WriteOp::OP_WRITE;
+	op->handle = handle;
+	op->pos = pos;
+	op->data = data;
+	op->size = size;
+	op->job = 0;
+	op->jobData = 0;
+	Enqueue(op);
+}
+
+static void SealBatch(Bitu index) {
+	if (writer.batch[index].used) {
+		QueueData(writer.batch[index].handle, -1, writer.batch[index].data, writer.batch[index].used);
+		writer.batch[index].data = 0;
+		writer.batch[index].used = 0;
+	}
+}
+
+static void FinishBatch(FILE * handle) {
+	for (Bitu i=0;i<WRITER_FILES;i++) {
+		if (writer.batch[i].handle != handle)
+			continue;
+		SealBatch(i);
+		free(writer.batch[i].data);
+		writer.batch[i].data = 0;
+		writer.batch[i].handle = 0;
+	}
+}
+
+void CAPTURE_Write(FILE * handle, const void * data, Bitu size) {
+	if (!size)
+		return;
+	if (size >= WRITER_BATCH) {
+		FinishBatch(handle);
+		Bit8u * copy = (Bit8u *)malloc(size);
+		if (!copy)
+			E_Exit("Ran out of memory during capturing");
+		memcpy(copy, data, size);
+		QueueData(handle, -1, copy, size);
+		return;
+	}
+	Bitu i;
+	for (i=0;i<WRITER_FILES;i++)
+		if (writer.batch[i].handle == handle)
+			break;
+	if (i == WRITER_FILES) {
+		for (i=0;i<WRITER_FILES;i++)
+			if (!writer.batch[i].handle)
+				break;
+		if (i == WRITER_FILES) {
+			/* Out of batches, hand one of them to the writer */
+			i = writer.nextBatch;
+			writer.nextBatch = (writer.nextBatch + 1) % WRITER_FILES;
+			FinishBatch(writer.batch[i].handle);
+		}
+		writer.batch[i].handle = handle;
+		writer.batch[i].used = 0;
+	}
+	if (writer.batch[i].used + size > WRITER_BATCH)
+		SealBatch(i);
+	if (!writer.batch[i].data) {
+		writer.batch[i].data = (Bit8u *)malloc(WRITER_BATCH);
+		if (!writer.batch[i].data)
+			E_Exit("Ran out of memory during capturing");
+	}
+	memcpy(writer.batch[i].data + writer.batch[i].used, data, size);
+	writer.batch[i].used += size;
+}
+
+void CAPTURE_WriteAt(FILE * handle, long pos, const void * data, Bitu size) {
+	FinishBatch(handle);
+	Bit8u * copy = (Bit8u *)malloc(size);
+	if (!copy)
+		E_Exit("Ran out of memory during capturing");
+	memcpy(copy, data, size);
+	QueueData(handle, pos, copy, size);
+}
+
+void CAPTURE_WriteOwned(FILE * handle, void * data, Bitu size) {
+	FinishBatch(handle);
+	QueueData(handle, -1, (Bit8u *)data, size);
+}
+
+void CAPTURE_Close(FILE * handle) {
+	FinishBatch(handle);
+	WriteOp * op = new WriteOp;
+	op->type = WriteOp::OP_CLOSE;
+	op->handle = handle;
+	op->pos = -1;
+	op->data = 0;
+	op->size = 0;
+	op->job = 0;
+	op->jobData = 0;
+	Enqueue(op);
+}
+
+void CAPTURE_Defer(void (*job)(void * data), void * data, Bitu size) {
+	WriteOp * op = new WriteOp;
+	op->type = WriteOp::OP_JOB;
+	op->handle = 0;
+	op->pos = -1;
+	op->data = 0;
+	op->size = size;
+	op->job = job;
+	op->jobData = data;
+	Enqueue(op);
+}
+
+Bitu CAPTURE_WriterBacklog(Bitu * peak) {
+	if (!writer.thread) {
+		if (peak) *peak = 0;
+		return 0;
+	}
+	SDL_mutexP(writer.lock);
+	Bitu backlog = writer.backlog;
+	if (peak) {
+		*peak = writer.peak;
+		writer.peak = backlog;
+	}
+	SDL_mutexV(writer.lock);
+	return backlog;
+}
+
+void CAPTURE_WriterShutdown(void) {
+	for (Bitu i=0;i<WRITER_FILES;i++)
+		if (writer.batch[i].handle)
+			FinishBatch(writer.batch[i].handle);
+	if (!writer.thread)
+		return;
+	/* The writer empties the queue before it quits */
+	SDL_mutexP(writer.lock);
+	writer.quit = true;
+	SDL_CondSignal(writer.work);
+	SDL_mutexV(writer.lock);
+	SDL_WaitThread(writer.thread, 0);
+	writer.thread = 0;
+	SDL_DestroyCond(writer.done);
+	SDL_DestroyCond(writer.work);
+	SDL_DestroyMutex(writer.lock);
+	writer.done = writer.work = 0;
+	writer.lock = 0;
+	writer.backlog = writer.peak = 0;
+}
@@ -48,7 +48,7 @@ static void DMA_BlockRead(PhysPt spage,PhysPt offset,void * data,Bitu size,Bit8u
 	size <<= dma16;
 	offset <<= dma16;
 	Bit32u dma_wrap = ((0xffff<<dma16)+dma16) | dma_wrapping;
-	for ( ; size ; size--, offset++) {
+	while (size) {
 		if (offset>(dma_wrapping<<dma16)) {
 			LOG_MSG("DMA segbound wrapping (read): %x:%x size %x [%x] wrap %x",spage,offset,size,dma16,dma_wrapping);
 		}
@@ -58,7 +58,12 @@ static void DMA_BlockRead(PhysPt spage,PhysPt offset,void * data,Bitu size,Bit8u
 		if (page < EMM_PAGEFRAME4K) page = paging.firstmb[page];
 		else if (page < EMM_PAGEFRAME4K+0x10) page = ems_board_mapping[page];
 		else if (page < LINK_START) page = paging.firstmb[page];
-		*write++=phys_readb(page*4096 + (offset & 4095));
+		/* copy up to the end of the page or the wrap point at once */
+		Bitu chunk = 4096 - (offset & 4095);
+		if (chunk > size) chunk = size;
+		if (chunk-1 > dma_wrap-offset) chunk = dma_wrap-offset+1;
+		memcpy(write,MemBase+page*4096+(offset & 4095),chunk);
+		write+=chunk;offset+=chunk;size-=chunk;
 	}
 }
 
@@ -69,7 +74,7 @@ static void DMA_BlockWrite(PhysPt spage,PhysPt offset,void * data,Bitu size,Bit8
 	size <<= dma16;
 	offset <<= dma16;
 	Bit32u dma_wrap = ((0xffff<<dma16)+dma16) | dma_wrapping;
-	for ( ; size ; size--, offset++) {
+	while (size) {
 		if (offset>(dma_wrapping<<dma16)) {
 			LOG_MSG("DMA segbound wrapping (write): %x:%x size %x [%x] wrap %x",spage,offset,size,dma16,dma_wrapping);
 		}
@@ -79,7 +84,11 @@ static void DMA_BlockWrite(PhysPt spage,PhysPt offset,void * data,Bitu size,Bit8
 		if (page < EMM_PAGEFRAME4K) page = paging.firstmb[page];
 		else if (page < EMM_PAGEFRAME4K+0x10) page = ems_board_mapping[page];
 		else if (page < LINK_START) page = paging.firstmb[page];
-		phys_writeb(page*4096 + (offset & 4095), *read++);
+		Bitu chunk = 4096 - (offset & 4095);
+		if (chunk > size) chunk = size;
+		if (chunk-1 > dma_wrap-offset) chunk = dma_wrap-offset+1;
+		memcpy(MemBase+page*4096+(offset & 4095),read,chunk);
+		read+=chunk;offset+=chunk;size-=chunk;
 	}
 }
 
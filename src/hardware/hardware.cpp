@@ -36,11 +36,11 @@
 #endif
 
 #if(C_STREAM)
-#include "../libs/ffmpeg/muxing.h"
+#include "../libs/ffmpeg/encoder.h"
 #endif
 
 static std::string capturedir;
-static std::string youtubeStreamURL;
+static std::string streamTarget;
 extern const char* RunningProgram;
 Bitu CaptureState;
 
@@ -64,16 +64,18 @@ static struct {
 	} midi;
 	struct {
 		Bitu rowlen;
+		Bit8u pal[256*4];
 	} image;
 #if (C_SSHOT)
 	struct {
 		FILE		*handle;
-		Bitu		frames;
+		Bitu		frames, lastKey;
 		Bit16s		audiobuf[WAVE_BUF][2];
 		Bitu		audioused;
 		Bitu		audiorate;
 		Bitu		audiowritten;
 		VideoCodec	*codec;
+		int			threads;
 		Bitu		width, height, bpp;
 		Bitu		written;
 		float		fps;
@@ -84,7 +86,13 @@ static struct {
 	} video;
 #endif
 #if(C_STREAM)
-	StreamContext stream;
+	struct {
+		StreamEncoder	*encoder;
+		Bitu		queueSize;
+		StreamEncoder::DropPolicy	dropPolicy;
+		StreamSettings	settings;
+		int			level;
+	} stream;
 #endif
 } capture = {0};
 
@@ -144,9 +152,9 @@ static void CAPTURE_AddAviChunk(const char * tag, Bit32u size, void * data, Bit3
 	chunk[0] = tag[0];chunk[1] = tag[1];chunk[2] = tag[2];chunk[3] = tag[3];
 	host_writed(&chunk[4], size);   
 	/* Write the actual data */
-	fwrite(chunk,1,8,capture.video.handle);
+	CAPTURE_Write(capture.video.handle,chunk,8);
 	writesize = (size+1)&~1;
-	fwrite(data,1,writesize,capture.video.handle);
+	CAPTURE_Write(capture.video.handle,data,writesize);
 	pos = capture.video.written + 4;
 	capture.video.written += writesize + 8;
 	if (capture.video.indexused + 16 >= capture.video.indexsize ) {
@@ -292,14 +300,18 @@ static void CAPTURE_VideoEvent(bool pressed) {
 		/* First add the index table to the end */
 		memcpy(capture.video.index, "idx1", 4);
 		host_writed( capture.video.index+4, capture.video.indexused - 8 );
-		fwrite( capture.video.index, 1, capture.video.indexused, capture.video.handle);
-		fseek(capture.video.handle, 0, SEEK_SET);
-		fwrite(&avi_header, 1, AVI_HEADER_SIZE, capture.video.handle);
-		fclose( capture.video.handle );
-		free( capture.video.index );
+		/* The writer thread frees the index once it is written */
+		CAPTURE_WriteOwned( capture.video.handle, capture.video.index, capture.video.indexused);
+		capture.video.index = 0;
+		CAPTURE_WriteAt(capture.video.handle, 0, &avi_header, AVI_HEADER_SIZE);
+		CAPTURE_Close( capture.video.handle );
 		free( capture.video.buf );
 		delete capture.video.codec;
 		capture.video.handle = 0;
+		Bitu peak;
+		CAPTURE_WriterBacklog(&peak);
+		if (peak > 1024*1024)
+			LOG_MSG("Capture writer fell up to %d KB behind", (int)(peak / 1024));
 	} else {
 		CaptureState |= CAPTURE_VIDEO;
 	}
@@ -312,21 +324,185 @@ static void CAPTURE_StreamEvent(bool pressed) {
 	if (!pressed)
 		return;
 	if (CaptureState & STREAM_VIDEO) {
-		/* Close the video stream */
-		if (capture.stream.oc) {
-			streaming_cleanup(&capture.stream);
+		/* Close the video stream, the encoder flushes what is still queued */
+		if (capture.stream.encoder) {
+			capture.stream.encoder->Stop();
+			/* Keep the adaptive level for when the stream restarts */
+			capture.stream.level = capture.stream.encoder->Level();
+			delete capture.stream.encoder;
+			capture.stream.encoder = 0;
 			CaptureState &= ~STREAM_VIDEO;
 			LOG_MSG("Stopped streaming video.");
 		}
 	} else {
-		LOG_MSG("Streaming to %s", youtubeStreamURL.c_str());
+		LOG_MSG("Streaming to %s", streamTarget.c_str());
 		CaptureState |= STREAM_VIDEO;
 	}
 }
 #endif
 
 
-void CAPTURE_AddImage(Bitu width, Bitu height, Bitu bpp, Bitu pitch, Bitu flags, float fps, Bit8u * data, Bit8u * pal) {
+#if (C_SSHOT)
+struct ScreenShot {
+	FILE * fp;
+	Bitu width, height, bpp, pitch, flags, countWidth;
+	Bit8u pal[256*4];
+	Bit8u * data;
+};
+
+/* Compresses a screenshot on the capture writer thread */
+static void CAPTURE_WriteScreenShot(void * param) {
+	ScreenShot * shot = (ScreenShot *)param;
+	Bitu i;
+	Bit8u doubleRow[SCALER_MAXWIDTH*4];
+	Bitu width = shot->width, height = shot->height, bpp = shot->bpp;
+	Bitu pitch = shot->pitch, flags = shot->flags, countWidth = shot->countWidth;
+	Bit8u * data = shot->data;
+	Bit8u * pal = shot->pal;
+	FILE * fp = shot->fp;
+	png_structp png_ptr;
+	png_infop info_ptr;
+	png_color palette[256];
+
+	/* First try to allocate the png structures */
+	png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL,NULL, NULL);
+	info_ptr = png_ptr ? png_create_info_struct(png_ptr) : 0;
+	if (!info_ptr) {
+		if (png_ptr) png_destroy_write_struct(&png_ptr,(png_infopp)NULL);
+		fclose(fp);
+		delete [] data;
+		delete shot;
+		return;
+	}
+	
+	/* Finalize the initing of png library */
+	png_init_io(png_ptr, fp);
+	png_set_compression_level(png_ptr,Z_BEST_COMPRESSION);
+	
+	/* set other zlib parameters */
+	png_set_compression_mem_level(png_ptr, 8);
+	png_set_compression_strategy(png_ptr,Z_DEFAULT_STRATEGY);
+	png_set_compression_window_bits(png_ptr, 15);
+	png_set_compression_method(png_ptr, 8);
+	png_set_compression_buffer_size(png_ptr, 8192);
+	
+	if (bpp==8) {
+		png_set_IHDR(png_ptr, info_ptr, width, height,
+			8, PNG_COLOR_TYPE_PALETTE, PNG_INTERLACE_NONE,
+			PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+		for (i=0;i<256;i++) {
+			palette[i].red=pal[i*4+0];
+			palette[i].green=pal[i*4+1];
+			palette[i].blue=pal[i*4+2];
+		}
+		png_set_PLTE(png_ptr, info_ptr, palette,256);
+	} else {
+		png_set_bgr( png_ptr );
+		png_set_IHDR(png_ptr, info_ptr, width, height,
+			8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
+			PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	}
+#ifdef PNG_TEXT_SUPPORTED
+	int fields = 1;
+	png_text text[1] = {};
+	const char* text_s = "DOSBox " VERSION;
+	size_t strl = strlen(text_s);
+	char* ptext_s = new char[strl + 1];
+	strcpy(ptext_s, text_s);
+	char software[9] = { 'S','o','f','t','w','a','r','e',0};
+	text[0].compression = PNG_TEXT_COMPRESSION_NONE;
+	text[0].key  = software;
+	text[0].text = ptext_s;
+	png_set_text(png_ptr, info_ptr, text, fields);
+#endif
+	png_write_info(png_ptr, info_ptr);
+#ifdef PNG_TEXT_SUPPORTED
+	delete [] ptext_s;
+#endif
+	for (i=0;i<height;i++) {
+		void *rowPointer;
+		void *srcLine;
+		if (flags & CAPTURE_FLAG_DBLH)
+			srcLine=(data+(i >> 1)*pitch);
+		else
+			srcLine=(data+(i >> 0)*pitch);
+		rowPointer=srcLine;
+		switch (bpp) {
+		case 8:
+			if (flags & CAPTURE_FLAG_DBLW) {
+   					for (Bitu x=0;x<countWidth;x++)
+					doubleRow[x*2+0] =
+					doubleRow[x*2+1] = ((Bit8u *)srcLine)[x];
+				rowPointer = doubleRow;
+			}
+			break;
+		case 15:
+			if (flags & CAPTURE_FLAG_DBLW) {
+				for (Bitu x=0;x<countWidth;x++) {
+					Bitu pixel = ((Bit16u *)srcLine)[x];
+					doubleRow[x*6+0] = doubleRow[x*6+3] = ((pixel& 0x001f) * 0x21) >>  2;
+					doubleRow[x*6+1] = doubleRow[x*6+4] = ((pixel& 0x03e0) * 0x21) >>  7;
+					doubleRow[x*6+2] = doubleRow[x*6+5] = ((pixel& 0x7c00) * 0x21) >>  12;
+				}
+			} else {
+				for (Bitu x=0;x<countWidth;x++) {
+					Bitu pixel = ((Bit16u *)srcLine)[x];
+					doubleRow[x*3+0] = ((pixel& 0x001f) * 0x21) >>  2;
+					doubleRow[x*3+1] = ((pixel& 0x03e0) * 0x21) >>  7;
+					doubleRow[x*3+2] = ((pixel& 0x7c00) * 0x21) >>  12;
+				}
+			}
+			rowPointer = doubleRow;
+			break;
+		case 16:
+			if (flags & CAPTURE_FLAG_DBLW) {
+				for (Bitu x=0;x<countWidth;x++) {
+					Bitu pixel = ((Bit16u *)srcLine)[x];
+					doubleRow[x*6+0] = doubleRow[x*6+3] = ((pixel& 0x001f) * 0x21) >> 2;
+					doubleRow[x*6+1] = doubleRow[x*6+4] = ((pixel& 0x07e0) * 0x41) >> 9;
+					doubleRow[x*6+2] = doubleRow[x*6+5] = ((pixel& 0xf800) * 0x21) >> 13;
+				}
+			} else {
+				for (Bitu x=0;x<countWidth;x++) {
+					Bitu pixel = ((Bit16u *)srcLine)[x];
+					doubleRow[x*3+0] = ((pixel& 0x001f) * 0x21) >>  2;
+					doubleRow[x*3+1] = ((pixel& 0x07e0) * 0x41) >>  9;
+					doubleRow[x*3+2] = ((pixel& 0xf800) * 0x21) >>  13;
+				}
+			}
+			rowPointer = doubleRow;
+			break;
+		case 32:
+			if (flags & CAPTURE_FLAG_DBLW) {
+				for (Bitu x=0;x<countWidth;x++) {
+					doubleRow[x*6+0] = doubleRow[x*6+3] = ((Bit8u *)srcLine)[x*4+0];
+					doubleRow[x*6+1] = doubleRow[x*6+4] = ((Bit8u *)srcLine)[x*4+1];
+					doubleRow[x*6+2] = doubleRow[x*6+5] = ((Bit8u *)srcLine)[x*4+2];
+				}
+			} else {
+				for (Bitu x=0;x<countWidth;x++) {
+					doubleRow[x*3+0] = ((Bit8u *)srcLine)[x*4+0];
+					doubleRow[x*3+1] = ((Bit8u *)srcLine)[x*4+1];
+					doubleRow[x*3+2] = ((Bit8u *)srcLine)[x*4+2];
+				}
+			}
+			rowPointer = doubleRow;
+			break;
+		}
+		png_write_row(png_ptr, (png_bytep)rowPointer);
+	}
+	/* Finish writing */
+	png_write_end(png_ptr, 0);
+	/*Destroy PNG structs*/
+	png_destroy_write_struct(&png_ptr, &info_ptr);
+	/*close file*/
+	fclose(fp);
+	delete [] data;
+	delete shot;
+}
+#endif
+
+void CAPTURE_AddImage(Bitu width, Bitu height, Bitu bpp, Bitu pitch, Bitu flags, float fps, Bit8u * data, Bit8u * pal, Bit8u * changed) {
 #if (C_SSHOT)
 	Bitu i;
 	Bit8u doubleRow[SCALER_MAXWIDTH*4];
@@ -341,147 +517,41 @@ void CAPTURE_AddImage(Bitu width, Bitu height, Bitu bpp, Bitu pitch, Bitu flags,
 		return;
 	if (width > SCALER_MAXWIDTH)
 		return;
+
+	/* Without changed lines or palette entries this frame repeats the last one */
+	Bitu srcRows = (flags & CAPTURE_FLAG_DBLH) ? (height >> 1) : height;
+	bool repeat = (changed != 0);
+	for (i=0;repeat && i<srcRows;i++)
+		if (changed[i]) repeat = false;
+	if (bpp == 8 && pal && memcmp(capture.image.pal, pal, sizeof(capture.image.pal))) {
+		memcpy(capture.image.pal, pal, sizeof(capture.image.pal));
+		repeat = false;
+	}
 	
 	if (CaptureState & CAPTURE_IMAGE) {
-		png_structp png_ptr;
-		png_infop info_ptr;
-		png_color palette[256];
-
 		CaptureState &= ~CAPTURE_IMAGE;
 		/* Open the actual file */
 		FILE * fp=OpenCaptureFile("Screenshot",".png");
 		if (!fp) goto skip_shot;
-		/* First try to allocate the png structures */
-		png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL,NULL, NULL);
-		if (!png_ptr) goto skip_shot;
-		info_ptr = png_create_info_struct(png_ptr);
-		if (!info_ptr) {
-			png_destroy_write_struct(&png_ptr,(png_infopp)NULL);
-			goto skip_shot;
-		}
-	
-		/* Finalize the initing of png library */
-		png_init_io(png_ptr, fp);
-		png_set_compression_level(png_ptr,Z_BEST_COMPRESSION);
-		
-		/* set other zlib parameters */
-		png_set_compression_mem_level(png_ptr, 8);
-		png_set_compression_strategy(png_ptr,Z_DEFAULT_STRATEGY);
-		png_set_compression_window_bits(png_ptr, 15);
-		png_set_compression_method(png_ptr, 8);
-		png_set_compression_buffer_size(png_ptr, 8192);
-	
-		if (bpp==8) {
-			png_set_IHDR(png_ptr, info_ptr, width, height,
-				8, PNG_COLOR_TYPE_PALETTE, PNG_INTERLACE_NONE,
-				PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
-			for (i=0;i<256;i++) {
-				palette[i].red=pal[i*4+0];
-				palette[i].green=pal[i*4+1];
-				palette[i].blue=pal[i*4+2];
-			}
-			png_set_PLTE(png_ptr, info_ptr, palette,256);
-		} else {
-			png_set_bgr( png_ptr );
-			png_set_IHDR(png_ptr, info_ptr, width, height,
-				8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
-				PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
-		}
-#ifdef PNG_TEXT_SUPPORTED
-		int fields = 1;
-		png_text text[1] = {};
-		const char* text_s = "DOSBox " VERSION;
-		size_t strl = strlen(text_s);
-		char* ptext_s = new char[strl + 1];
-		strcpy(ptext_s, text_s);
-		char software[9] = { 'S','o','f','t','w','a','r','e',0};
-		text[0].compression = PNG_TEXT_COMPRESSION_NONE;
-		text[0].key  = software;
-		text[0].text = ptext_s;
-		png_set_text(png_ptr, info_ptr, text, fields);
-#endif
-		png_write_info(png_ptr, info_ptr);
-#ifdef PNG_TEXT_SUPPORTED
-		delete [] ptext_s;
-#endif
-		for (i=0;i<height;i++) {
-			void *rowPointer;
-			void *srcLine;
-			if (flags & CAPTURE_FLAG_DBLH)
-				srcLine=(data+(i >> 1)*pitch);
-			else
-				srcLine=(data+(i >> 0)*pitch);
-			rowPointer=srcLine;
-			switch (bpp) {
-			case 8:
-				if (flags & CAPTURE_FLAG_DBLW) {
-   					for (Bitu x=0;x<countWidth;x++)
-						doubleRow[x*2+0] =
-						doubleRow[x*2+1] = ((Bit8u *)srcLine)[x];
-					rowPointer = doubleRow;
-				}
-				break;
-			case 15:
-				if (flags & CAPTURE_FLAG_DBLW) {
-					for (Bitu x=0;x<countWidth;x++) {
-						Bitu pixel = ((Bit16u *)srcLine)[x];
-						doubleRow[x*6+0] = doubleRow[x*6+3] = ((pixel& 0x001f) * 0x21) >>  2;
-						doubleRow[x*6+1] = doubleRow[x*6+4] = ((pixel& 0x03e0) * 0x21) >>  7;
-						doubleRow[x*6+2] = doubleRow[x*6+5] = ((pixel& 0x7c00) * 0x21) >>  12;
-					}
-				} else {
-					for (Bitu x=0;x<countWidth;x++) {
-						Bitu pixel = ((Bit16u *)srcLine)[x];
-						doubleRow[x*3+0] = ((pixel& 0x001f) * 0x21) >>  2;
-						doubleRow[x*3+1] = ((pixel& 0x03e0) * 0x21) >>  7;
-						doubleRow[x*3+2] = ((pixel& 0x7c00) * 0x21) >>  12;
-					}
-				}
-				rowPointer = doubleRow;
-				break;
-			case 16:
-				if (flags & CAPTURE_FLAG_DBLW) {
-					for (Bitu x=0;x<countWidth;x++) {
-						Bitu pixel = ((Bit16u *)srcLine)[x];
-						doubleRow[x*6+0] = doubleRow[x*6+3] = ((pixel& 0x001f) * 0x21) >> 2;
-						doubleRow[x*6+1] = doubleRow[x*6+4] = ((pixel& 0x07e0) * 0x41) >> 9;
-						doubleRow[x*6+2] = doubleRow[x*6+5] = ((pixel& 0xf800) * 0x21) >> 13;
-					}
-				} else {
-					for (Bitu x=0;x<countWidth;x++) {
-						Bitu pixel = ((Bit16u *)srcLine)[x];
-						doubleRow[x*3+0] = ((pixel& 0x001f) * 0x21) >>  2;
-						doubleRow[x*3+1] = ((pixel& 0x07e0) * 0x41) >>  9;
-						doubleRow[x*3+2] = ((pixel& 0xf800) * 0x21) >>  13;
-					}
-				}
-				rowPointer = doubleRow;
-				break;
-			case 32:
-				if (flags & CAPTURE_FLAG_DBLW) {
-					for (Bitu x=0;x<countWidth;x++) {
-						doubleRow[x*6+0] = doubleRow[x*6+3] = ((Bit8u *)srcLine)[x*4+0];
-						doubleRow[x*6+1] = doubleRow[x*6+4] = ((Bit8u *)srcLine)[x*4+1];
-						doubleRow[x*6+2] = doubleRow[x*6+5] = ((Bit8u *)srcLine)[x*4+2];
-					}
-				} else {
-					for (Bitu x=0;x<countWidth;x++) {
-						doubleRow[x*3+0] = ((Bit8u *)srcLine)[x*4+0];
-						doubleRow[x*3+1] = ((Bit8u *)srcLine)[x*4+1];
-						doubleRow[x*3+2] = ((Bit8u *)srcLine)[x*4+2];
-					}
-				}
-				rowPointer = doubleRow;
-				break;
-			}
-			png_write_row(png_ptr, (png_bytep)rowPointer);
-		}
-		/* Finish writing */
-		png_write_end(png_ptr, 0);
-		/*Destroy PNG structs*/
-		png_destroy_write_struct(&png_ptr, &info_ptr);
-		/*close file*/
-		fclose(fp);
+		/* Hand a copy of the frame to the writer thread for compression */
+		Bitu rows = (flags & CAPTURE_FLAG_DBLH) ? height / 2 : height;
+		Bitu rowBytes = countWidth * ((bpp + 7) / 8);
+		ScreenShot * shot = new ScreenShot;
+		shot->fp = fp;
+		shot->width = width;
+		shot->height = height;
+		shot->bpp = bpp;
+		shot->pitch = rowBytes;
+		shot->flags = flags;
+		shot->countWidth = countWidth;
+		if (pal)
+			memcpy(shot->pal, pal, sizeof(shot->pal));
+		else
+			memset(shot->pal, 0, sizeof(shot->pal));
+		shot->data = new Bit8u[rows * rowBytes];
+		for (i=0;i<rows;i++)
+			memcpy(shot->data + i * rowBytes, data + i * pitch, rowBytes);
+		CAPTURE_Defer(&CAPTURE_WriteScreenShot, shot, rows * rowBytes);
 	}
 skip_shot:
 	if (CaptureState & CAPTURE_VIDEO) {
@@ -511,6 +581,13 @@ skip_shot:
 			capture.video.codec = new VideoCodec();
 			if (!capture.video.codec)
 				goto skip_video;
+			capture.video.codec->SetThreads(capture.video.threads);
+#if C_DEBUG
+			if (!VideoCodec::CheckKernels()) {
+				LOG_MSG("ZMBV %s kernels don't match the C version, using C", capture.video.codec->SetKernels(0));
+				capture.video.codec->SetKernels("C");
+			}
+#endif
 			if (!capture.video.codec->SetupCompress( width, height)) 
 				goto skip_video;
 			capture.video.bufSize = capture.video.codec->NeededSize(width, height, format);
@@ -530,58 +607,70 @@ skip_shot:
 			for (i=0;i<AVI_HEADER_SIZE;i++)
 				fputc(0,capture.video.handle);
 			capture.video.frames = 0;
+			capture.video.lastKey = 0;
 			capture.video.written = 0;
 			capture.video.audioused = 0;
 			capture.video.audiowritten = 0;
 		}
-		int codecFlags;
-		if (capture.video.frames % 300 == 0)
-			codecFlags = 1;
-		else codecFlags = 0;
-		if (!capture.video.codec->PrepareCompressFrame( codecFlags, format, (char *)pal, capture.video.buf, capture.video.bufSize))
-			goto skip_video;
+		if (repeat && capture.video.frames) {
+			/* An empty chunk is a drop frame, the player shows the last one again */
+			CAPTURE_AddAviChunk( "00dc", 0, 0, 0);
+		} else {
+			int codecFlags;
+			if (capture.video.frames == 0 || capture.video.frames - capture.video.lastKey >= 300) {
+				codecFlags = 1;
+				capture.video.lastKey = capture.video.frames;
+			} else codecFlags = 0;
+			if (!capture.video.codec->PrepareCompressFrame( codecFlags, format, (char *)pal, capture.video.buf, capture.video.bufSize))
+				goto skip_video;
 
-		for (i=0;i<height;i++) {
-			void * rowPointer;
-			if (flags & CAPTURE_FLAG_DBLW) {
-				void *srcLine;
-				Bitu x;
-				Bitu countWidth = width >> 1;
-				if (flags & CAPTURE_FLAG_DBLH)
-					srcLine=(data+(i >> 1)*pitch);
-				else
-					srcLine=(data+(i >> 0)*pitch);
-				switch ( bpp) {
-				case 8:
-					for (x=0;x<countWidth;x++)
-						((Bit8u *)doubleRow)[x*2+0] =
-						((Bit8u *)doubleRow)[x*2+1] = ((Bit8u *)srcLine)[x];
-					break;
-				case 15:
-				case 16:
-					for (x=0;x<countWidth;x++)
-						((Bit16u *)doubleRow)[x*2+0] =
-						((Bit16u *)doubleRow)[x*2+1] = ((Bit16u *)srcLine)[x];
-					break;
-				case 32:
-					for (x=0;x<countWidth;x++)
-						((Bit32u *)doubleRow)[x*2+0] =
-						((Bit32u *)doubleRow)[x*2+1] = ((Bit32u *)srcLine)[x];
-					break;
+			for (i=0;i<height;i++) {
+				void * rowPointer;
+				/* Lines the renderer saw unchanged get copied from the last frame */
+				if (changed && capture.video.frames && !changed[(flags & CAPTURE_FLAG_DBLH) ? (i >> 1) : i]) {
+					capture.video.codec->SkipLines( 1 );
+					continue;
 				}
-                rowPointer=doubleRow;
-			} else {
-				if (flags & CAPTURE_FLAG_DBLH)
-					rowPointer=(data+(i >> 1)*pitch);
-				else
-					rowPointer=(data+(i >> 0)*pitch);
+				if (flags & CAPTURE_FLAG_DBLW) {
+					void *srcLine;
+					Bitu x;
+					Bitu countWidth = width >> 1;
+					if (flags & CAPTURE_FLAG_DBLH)
+						srcLine=(data+(i >> 1)*pitch);
+					else
+						srcLine=(data+(i >> 0)*pitch);
+					switch ( bpp) {
+					case 8:
+						for (x=0;x<countWidth;x++)
+							((Bit8u *)doubleRow)[x*2+0] =
+							((Bit8u *)doubleRow)[x*2+1] = ((Bit8u *)srcLine)[x];
+						break;
+					case 15:
+					case 16:
+						for (x=0;x<countWidth;x++)
+							((Bit16u *)doubleRow)[x*2+0] =
+							((Bit16u *)doubleRow)[x*2+1] = ((Bit16u *)srcLine)[x];
+						break;
+					case 32:
+						for (x=0;x<countWidth;x++)
+							((Bit32u *)doubleRow)[x*2+0] =
+							((Bit32u *)doubleRow)[x*2+1] = ((Bit32u *)srcLine)[x];
+						break;
+					}
+	                rowPointer=doubleRow;
+				} else {
+					if (flags & CAPTURE_FLAG_DBLH)
+						rowPointer=(data+(i >> 1)*pitch);
+					else
+						rowPointer=(data+(i >> 0)*pitch);
+				}
+				capture.video.codec->CompressLines( 1, &rowPointer );
 			}
-			capture.video.codec->CompressLines( 1, &rowPointer );
+			int written = capture.video.codec->FinishCompressFrame();
+			if (written < 0)
+				goto skip_video;
+			CAPTURE_AddAviChunk( "00dc", written, capture.video.buf, codecFlags & 1 ? 0x10 : 0x0);
 		}
-		int written = capture.video.codec->FinishCompressFrame();
-		if (written < 0)
-			goto skip_video;
-		CAPTURE_AddAviChunk( "00dc", written, capture.video.buf, codecFlags & 1 ? 0x10 : 0x0);
 		capture.video.frames++;
 //		LOG_MSG("Frame %d video %d audio %d",capture.video.frames, written, capture.video.audioused *4 );
 		if ( capture.video.audioused ) {
@@ -597,108 +686,48 @@ skip_video:
 #if (C_STREAM)
 	if (CaptureState & STREAM_VIDEO) {
 		/* Disable capturing if any of the test fails */
-		if (capture.stream.oc && (
-			capture.stream.width != width ||
-			capture.stream.height != height ||
-			capture.stream.fps != (int)fps)) 
+		if (capture.stream.encoder && (
+			capture.stream.encoder->Width() != (int)width ||
+			capture.stream.encoder->Height() != (int)height ||
+			capture.stream.encoder->Bpp() != (int)bpp ||
+			capture.stream.encoder->Fps() != (int)fps)) 
 		{
 			CAPTURE_StreamEvent(true);
 		}
 		CaptureState &= ~STREAM_VIDEO;
 
-		if (!capture.stream.oc) {
-			capture.stream.width = width;
-			capture.stream.height = height;
-			capture.stream.fps = (int)fps;
-			streaming_init(youtubeStreamURL.c_str(), &capture.stream);
-			if (capture.stream.oc) {
-				CaptureState |= STREAM_VIDEO;
-			} else {
+		/* Frames are queued in their native format and size, the scaler
+		 * in the encoder thread does the conversion and doubling */
+		Bitu srcHeight = (flags & CAPTURE_FLAG_DBLH) ? (height >> 1) : height;
+		if (!capture.stream.encoder) {
+			switch (bpp) {
+			case 8:case 15:case 16:case 32:
+				break;
+			default:
+				goto skip_stream;
+			}
+			capture.stream.encoder = new StreamEncoder();
+			if (!capture.stream.encoder->Start(streamTarget.c_str(), width, height,
+				countWidth, srcHeight, bpp, (int)fps,
+				capture.stream.queueSize, capture.stream.dropPolicy,
+				capture.stream.settings, capture.stream.level)) {
 				LOG_MSG("Failed to initialize streaming");
+				delete capture.stream.encoder;
+				capture.stream.encoder = 0;
+				goto skip_stream;
 			}
 		}
 
-		if (!capture.stream.oc)
-			goto skip_stream;
-
-		for (i=0;i<height;i++) {
-			void *rowPointer;
-			void *srcLine;
-			if (flags & CAPTURE_FLAG_DBLH)
-				srcLine=(data+(i >> 1)*pitch);
-			else
-				srcLine=(data+(i >> 0)*pitch);
-			switch (bpp) {
-			case 8:
-				if (flags & CAPTURE_FLAG_DBLW) {
-					for (Bitu x=0;x<countWidth;x++) {
-						Bit8u pixel = ((Bit8u *)srcLine)[x];
-						doubleRow[x*6+0] = doubleRow[x*6+3] = pal[pixel*4+0];
-						doubleRow[x*6+1] = doubleRow[x*6+4] = pal[pixel*4+1];
-						doubleRow[x*6+2] = doubleRow[x*6+5] = pal[pixel*4+2];
-					}
-				} else {
-					for (Bitu x=0;x<countWidth;x++) {
-						Bit8u pixel = ((Bit8u *)srcLine)[x];
-						doubleRow[x*3+0] = pal[pixel*4+0];
-						doubleRow[x*3+1] = pal[pixel*4+1];
-						doubleRow[x*3+2] = pal[pixel*4+2];
-					}
-				}
-				break;
-			case 15:
-				if (flags & CAPTURE_FLAG_DBLW) {
-					for (Bitu x=0;x<countWidth;x++) {
-						Bitu pixel = ((Bit16u *)srcLine)[x];
-						doubleRow[x*6+0] = doubleRow[x*6+3] = ((pixel& 0x001f) * 0x21) >>  2;
-						doubleRow[x*6+1] = doubleRow[x*6+4] = ((pixel& 0x03e0) * 0x21) >>  7;
-						doubleRow[x*6+2] = doubleRow[x*6+5] = ((pixel& 0x7c00) * 0x21) >>  12;
-					}
-				} else {
-					for (Bitu x=0;x<countWidth;x++) {
-						Bitu pixel = ((Bit16u *)srcLine)[x];
-						doubleRow[x*3+0] = ((pixel& 0x001f) * 0x21) >>  2;
-						doubleRow[x*3+1] = ((pixel& 0x03e0) * 0x21) >>  7;
-						doubleRow[x*3+2] = ((pixel& 0x7c00) * 0x21) >>  12;
-					}
-				}
-				break;
-			case 16:
-				if (flags & CAPTURE_FLAG_DBLW) {
-					for (Bitu x=0;x<countWidth;x++) {
-						Bitu pixel = ((Bit16u *)srcLine)[x];
-						doubleRow[x*6+0] = doubleRow[x*6+3] = ((pixel& 0x001f) * 0x21) >> 2;
-						doubleRow[x*6+1] = doubleRow[x*6+4] = ((pixel& 0x07e0) * 0x41) >> 9;
-						doubleRow[x*6+2] = doubleRow[x*6+5] = ((pixel& 0xf800) * 0x21) >> 13;
-					}
-				} else {
-					for (Bitu x=0;x<countWidth;x++) {
-						Bitu pixel = ((Bit16u *)srcLine)[x];
-						doubleRow[x*3+0] = ((pixel& 0x001f) * 0x21) >>  2;
-						doubleRow[x*3+1] = ((pixel& 0x07e0) * 0x41) >>  9;
-						doubleRow[x*3+2] = ((pixel& 0xf800) * 0x21) >>  13;
-					}
-				}
-				break;
-			case 32:
-				if (flags & CAPTURE_FLAG_DBLW) {
-					for (Bitu x=0;x<countWidth;x++) {
-						doubleRow[x*6+0] = doubleRow[x*6+3] = ((Bit8u *)srcLine)[x*4+0];
-						doubleRow[x*6+1] = doubleRow[x*6+4] = ((Bit8u *)srcLine)[x*4+1];
-						doubleRow[x*6+2] = doubleRow[x*6+5] = ((Bit8u *)srcLine)[x*4+2];
-					}
-				} else {
-					for (Bitu x=0;x<countWidth;x++) {
-						doubleRow[x*3+0] = ((Bit8u *)srcLine)[x*4+0];
-						doubleRow[x*3+1] = ((Bit8u *)srcLine)[x*4+1];
-						doubleRow[x*3+2] = ((Bit8u *)srcLine)[x*4+2];
-					}
-				}
-				break;
-			}
-			streaming_video_line(&capture.stream, i, (Bit8u*)doubleRow);
+		/* Only copy the frame here, the encoder thread does the rest */
+		Bit8u * frame = 0;
+		if (!repeat || !capture.stream.encoder->RepeatFrame())
+			frame = capture.stream.encoder->GetFrame();
+		if (frame) {
+			Bitu framePitch = capture.stream.encoder->Pitch();
+			for (i=0;i<srcHeight;i++)
+				memcpy(frame + i*framePitch, data + i*pitch, framePitch);
+			capture.stream.encoder->SubmitFrame(pal);
 		}
-		streaming_video(&capture.stream);
 
 		/* Everything went okay, set flag again for next frame */
 		CaptureState |= STREAM_VIDEO;
@@ -741,8 +770,8 @@ void CAPTURE_AddWave(Bit32u freq, Bit32u len, Bit16s * data) {
 	}
 #endif
 #if (C_STREAM)
-	if (CaptureState & STREAM_VIDEO) {
-		streaming_audio(&capture.stream, len, data);
+	if ((CaptureState & STREAM_VIDEO) && capture.stream.encoder) {
+		capture.stream.encoder->AddAudio(len, data);
 	}
 #endif
 	if (CaptureState & CAPTURE_WAVE) {
@@ -755,13 +784,13 @@ void CAPTURE_AddWave(Bit32u freq, Bit32u len, Bit16s * data) {
 			capture.wave.length = 0;
 			capture.wave.used = 0;
 			capture.wave.freq = freq;
-			fwrite(wavheader,1,sizeof(wavheader),capture.wave.handle);
+			CAPTURE_Write(capture.wave.handle,wavheader,sizeof(wavheader));
 		}
 		Bit16s * read = data;
 		while (len > 0 ) {
 			Bitu left = WAVE_BUF - capture.wave.used;
 			if (!left) {
-				fwrite(capture.wave.buf,1,4*WAVE_BUF,capture.wave.handle);
+				CAPTURE_Write(capture.wave.handle,capture.wave.buf,4*WAVE_BUF);
 				capture.wave.length += 4*WAVE_BUF;
 				capture.wave.used = 0;
 				left = WAVE_BUF;
@@ -782,7 +811,7 @@ static void CAPTURE_WaveEvent(bool pressed) {
 	if (capture.wave.handle) {
 		LOG_MSG("Stopped capturing wave output.");
 		/* Write last piece of audio in buffer */
-		fwrite(capture.wave.buf,1,capture.wave.used*4,capture.wave.handle);
+		CAPTURE_Write(capture.wave.handle,capture.wave.buf,capture.wave.used*4);
 		capture.wave.length+=capture.wave.used*4;
 		/* Fill in the header with useful information */
 		host_writed(&wavheader[0x04],capture.wave.length+sizeof(wavheader)-8);
@@ -790,9 +819,8 @@ static void CAPTURE_WaveEvent(bool pressed) {
 		host_writed(&wavheader[0x1C],capture.wave.freq*4);
 		host_writed(&wavheader[0x28],capture.wave.length);
 		
-		fseek(capture.wave.handle,0,0);
-		fwrite(wavheader,1,sizeof(wavheader),capture.wave.handle);
-		fclose(capture.wave.handle);
+		CAPTURE_WriteAt(capture.wave.handle,0,wavheader,sizeof(wavheader));
+		CAPTURE_Close(capture.wave.handle);
 		capture.wave.handle=0;
 		CaptureState |= CAPTURE_WAVE;
 	} 
@@ -817,7 +845,7 @@ static void RawMidiAdd(Bit8u data) {
 	capture.midi.buffer[capture.midi.used++]=data;
 	if (capture.midi.used >= MIDI_BUF ) {
 		capture.midi.done += capture.midi.used;
-		fwrite(capture.midi.buffer,1,MIDI_BUF,capture.midi.handle);
+		CAPTURE_Write(capture.midi.handle,capture.midi.buffer,MIDI_BUF);
 		capture.midi.used = 0;
 	}
 }
@@ -835,7 +863,7 @@ void CAPTURE_AddMidi(bool sysex, Bitu len, Bit8u * data) {
 		if (!capture.midi.handle) {
 			return;
 		}
-		fwrite(midi_header,1,sizeof(midi_header),capture.midi.handle);
+		CAPTURE_Write(capture.midi.handle,midi_header,sizeof(midi_header));
 		capture.midi.last=PIC_Ticks;
 	}
 	Bit32u delta=PIC_Ticks-capture.midi.last;
@@ -862,16 +890,15 @@ static void CAPTURE_MidiEvent(bool pressed) {
 		RawMidiAdd(0x2F);
 		RawMidiAdd(0x00);
 		/* clear out the final data in the buffer if any */
-		fwrite(capture.midi.buffer,1,capture.midi.used,capture.midi.handle);
+		CAPTURE_Write(capture.midi.handle,capture.midi.buffer,capture.midi.used);
 		capture.midi.done+=capture.midi.used;
-		fseek(capture.midi.handle,18, SEEK_SET);
 		Bit8u size[4];
 		size[0]=(Bit8u)(capture.midi.done >> 24);
 		size[1]=(Bit8u)(capture.midi.done >> 16);
 		size[2]=(Bit8u)(capture.midi.done >> 8);
 		size[3]=(Bit8u)(capture.midi.done >> 0);
-		fwrite(&size,1,4,capture.midi.handle);
-		fclose(capture.midi.handle);
+		CAPTURE_WriteAt(capture.midi.handle,18,&size,4);
+		CAPTURE_Close(capture.midi.handle);
 		capture.midi.handle=0;
 		CaptureState &= ~CAPTURE_MIDI;
 		return;
@@ -894,9 +921,41 @@ public:
 		Prop_path* proppath= section->Get_path("captures");
 		capturedir = proppath->realpath;
 		CaptureState = 0;
-		youtubeStreamURL = section->Get_string("youtube_url")
+#if (C_SSHOT)
+		capture.video.threads = section->Get_int("capture_threads");
+		if (capture.video.threads <= 0)
+			capture.video.threads = Cross::GetCPUCount();
+#endif
+		streamTarget = section->Get_string("youtube_url")
 						+ std::string("/")
 						+ section->Get_string("youtube_key");
+#if (C_STREAM)
+		std::string streamOutput(section->Get_string("stream_output"));
+		if (!streamOutput.empty())
+			streamTarget = streamOutput;
+		capture.stream.queueSize = section->Get_int("stream_queue");
+		std::string streamDrop(section->Get_string("stream_drop"));
+		capture.stream.dropPolicy = (streamDrop == "newest") ?
+			StreamEncoder::DROP_NEWEST : StreamEncoder::DROP_OLDEST;
+		StreamSettings & settings = capture.stream.settings;
+		safe_strncpy(settings.preset, section->Get_string("stream_preset"), sizeof(settings.preset));
+		std::string streamTune(section->Get_string("stream_tune"));
+		if (streamTune == "none") streamTune.clear();
+		safe_strncpy(settings.tune, streamTune.c_str(), sizeof(settings.tune));
+		settings.crf = section->Get_int("stream_crf");
+		settings.video_bitrate = section->Get_int("stream_vbitrate") * 1000;
+		settings.audio_bitrate = section->Get_int("stream_abitrate") * 1000;
+		settings.gop = section->Get_int("stream_gop");
+		settings.threads = section->Get_int("stream_threads");
+		settings.scale = section->Get_int("stream_scale");
+		settings.adaptive = section->Get_bool("stream_adaptive");
+		std::string streamFormat(section->Get_string("stream_format"));
+		if (streamFormat == "auto") streamFormat.clear();
+		safe_strncpy(settings.format, streamFormat.c_str(), sizeof(settings.format));
+		settings.segment_time = section->Get_int("stream_segment_time");
+		settings.segment_size = section->Get_int("stream_segment_size");
+		capture.stream.level = 0;
+#endif
 		MAPPER_AddHandler(CAPTURE_WaveEvent,MK_f6,MMOD1,"recwave","Rec Wave");
 		MAPPER_AddHandler(CAPTURE_MidiEvent,MK_f8,MMOD1|MMOD2,"caprawmidi","Cap MIDI");
 #if (C_SSHOT)
@@ -913,10 +972,12 @@ public:
 		if (capture.video.handle) CAPTURE_VideoEvent(true);
 #endif
 #if (C_STREAM)
-		if (capture.stream.oc) CAPTURE_StreamEvent(true);
+		if (capture.stream.encoder) CAPTURE_StreamEvent(true);
 #endif
 		if (capture.wave.handle) CAPTURE_WaveEvent(true);
 		if (capture.midi.handle) CAPTURE_MidiEvent(true);
+		/* Wait for the capture files to be written out */
+		CAPTURE_WriterShutdown();
 	}
 };
 
@@ -220,6 +220,22 @@ inline void IO_USEC_write_delay() {
 	CPU_IODelayRemoved += delaycyc;
 }
 
+Bitu IO_PollReads = 0;
+
+static INLINE void IO_NotePollRead(Bitu port) {
+	switch (port) {
+	case 0x20: case 0x21: case 0xa0: case 0xa1:	// PIC
+	case 0x60: case 0x64:	// keyboard controller
+		break;
+	case 0x3ba: case 0x3da:	// CRTC status
+		IO_PollReads|=IO_POLL_VIDEO;
+		break;
+	default:
+		IO_PollReads|=IO_POLL_OTHER;
+		break;
+	}
+}
+
 #ifdef ENABLE_PORTLOG
 static Bit8u crtc_index = 0;
 const char* const len_type[] = {" 8","16","32"};
@@ -424,6 +440,7 @@ Bitu IO_ReadB(Bitu port) {
 	}
 	else {
 		IO_USEC_read_delay();
+		IO_NotePollRead(port);
 		retval = io_readhandlers[0][port](port,1);
 	}
 	log_io(0, false, port, retval);
@@ -462,6 +479,7 @@ Bitu IO_ReadW(Bitu port) {
 	}
 	else {
 		IO_USEC_read_delay();
+		IO_NotePollRead(port);
 		retval = io_readhandlers[1][port](port,2);
 	}
 	log_io(1, false, port, retval);
@@ -498,6 +516,7 @@ Bitu IO_ReadD(Bitu port) {
 		memcpy(&lflags,&old_lflags,sizeof(LazyFlags));
 		cpudecoder=old_cpudecoder;
 	} else {
+		IO_NotePollRead(port);
 		retval = io_readhandlers[2][port](port,4);
 	}
 	log_io(2, false, port, retval);
@@ -26,23 +26,24 @@
 
 #include <string.h>
 
+#if defined (WIN32)
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0501		// AddVectoredExceptionHandler
+#endif
+#include <windows.h>
+#elif (C_HAVE_MMAP)
+#include <sys/mman.h>
+#endif
+
 #define PAGES_IN_BLOCK	((1024*1024)/MEM_PAGE_SIZE)
 #define SAFE_MEMORY	32
-#define MAX_MEMORY	64
-#define MAX_PAGE_ENTRIES (MAX_MEMORY*1024*1024/4096)
+#define MAX_MEMORY	1024
 #define LFB_PAGES	512
-#define MAX_LINKS	((MAX_MEMORY*1024/4)+4096)		//Hopefully enough
-
-struct LinkBlock {
-	Bitu used;
-	Bit32u pages[MAX_LINKS];
-};
 
 static struct MemoryBlock {
 	Bitu pages;
 	PageHandler * * phandlers;
 	MemHandle * mhandles;
-	LinkBlock links;
 	struct	{
 		Bitu		start_page;
 		Bitu		end_page;
@@ -173,21 +174,60 @@ void mem_strcpy(PhysPt dest,PhysPt src) {
 	mem_writeb_inline(dest,0);
 }
 
+/* The block functions copy a page at a time through the host pointers of the
+ * TLB. Pages without one (handlers, pages with dynamic code, pages that are not
+ * linked yet) take a byte through the handler, which also links the page. */
 void mem_memcpy(PhysPt dest,PhysPt src,Bitu size) {
-	while (size--) mem_writeb_inline(dest++,mem_readb_inline(src++));
+	while (size) {
+		Bitu chunk=MEM_PAGESIZE-(src & (MEM_PAGESIZE-1));
+		Bitu dest_left=MEM_PAGESIZE-(dest & (MEM_PAGESIZE-1));
+		if (chunk>dest_left) chunk=dest_left;
+		if (chunk>size) chunk=size;
+		HostPt tlb_read=get_tlb_read(src);
+		HostPt tlb_write=get_tlb_write(dest);
+		if (GCC_UNLIKELY(!tlb_read || !tlb_write)) {
+			mem_writeb_inline(dest++,mem_readb_inline(src++));
+			size--;
+			continue;
+		}
+		HostPt read=tlb_read+src;
+		HostPt write=tlb_write+dest;
+		/* Keep the byte by byte result when the destination overlaps from above */
+		if (write<=read || write>=read+chunk) memmove(write,read,chunk);
+		else for (Bitu i=0;i<chunk;i++) write[i]=read[i];
+		dest+=chunk;src+=chunk;size-=chunk;
+	}
 }
 
 void MEM_BlockRead(PhysPt pt,void * data,Bitu size) {
 	Bit8u * write=reinterpret_cast<Bit8u *>(data);
-	while (size--) {
-		*write++=mem_readb_inline(pt++);
+	while (size) {
+		Bitu chunk=MEM_PAGESIZE-(pt & (MEM_PAGESIZE-1));
+		if (chunk>size) chunk=size;
+		HostPt tlb_addr=get_tlb_read(pt);
+		if (GCC_UNLIKELY(!tlb_addr)) {
+			*write++=mem_readb_inline(pt++);
+			size--;
+			continue;
+		}
+		memcpy(write,tlb_addr+pt,chunk);
+		write+=chunk;pt+=chunk;size-=chunk;
 	}
 }
 
 void MEM_BlockWrite(PhysPt pt,void const * const data,Bitu size) {
 	Bit8u const * read = reinterpret_cast<Bit8u const * const>(data);
-	while (size--) {
-		mem_writeb_inline(pt++,*read++);
+	while (size) {
+		Bitu chunk=MEM_PAGESIZE-(pt & (MEM_PAGESIZE-1));
+		if (chunk>size) chunk=size;
+		HostPt tlb_addr=get_tlb_write(pt);
+		if (GCC_UNLIKELY(!tlb_addr)) {
+			mem_writeb_inline(pt++,*read++);
+			size--;
+			continue;
+		}
+		memcpy(tlb_addr+pt,read,chunk);
+		read+=chunk;pt+=chunk;size-=chunk;
 	}
 }
 
@@ -537,6 +577,78 @@ void PreparePCJRCartRom(void) {
 
 HostPt GetMemBase(void) { return MemBase; }
 
+#if defined (WIN32)
+/* Windows commits the reserved guest memory in chunks on the first access.
+ * The first chunks, conventional memory and the HMA, are committed up front. */
+#define MEM_COMMIT_CHUNK	(64*1024)
+#define MEM_COMMIT_START	(2*1024*1024)
+
+static struct {
+	HostPt base;
+	Bitu size;
+	PVOID handler;
+} reserved;
+
+static LONG CALLBACK MEM_CommitOnAccess(PEXCEPTION_POINTERS info) {
+	PEXCEPTION_RECORD record=info->ExceptionRecord;
+	if (record->ExceptionCode!=EXCEPTION_ACCESS_VIOLATION || record->NumberParameters<2)
+		return EXCEPTION_CONTINUE_SEARCH;
+	HostPt addr=(HostPt)record->ExceptionInformation[1];
+	if (addr<reserved.base || addr>=reserved.base+reserved.size) return EXCEPTION_CONTINUE_SEARCH;
+	Bitu start=(Bitu)(addr-reserved.base) & ~(Bitu)(MEM_COMMIT_CHUNK-1);
+	Bitu size=reserved.size-start;
+	if (size>MEM_COMMIT_CHUNK) size=MEM_COMMIT_CHUNK;
+	/* Freshly committed pages read as zero */
+	if (!VirtualAlloc(reserved.base+start,size,MEM_COMMIT,PAGE_READWRITE)) return EXCEPTION_CONTINUE_SEARCH;
+	return EXCEPTION_CONTINUE_EXECUTION;
+}
+#endif
+
+/* Reserve the address space for the guest memory. The host hands out zeroed
+ * pages when they are first touched, so memory the guest never uses costs
+ * nothing. Without mmap all of it is allocated and cleared up front. */
+static HostPt AllocateMemBase(Bitu size) {
+#if defined (WIN32)
+	HostPt base=(HostPt)VirtualAlloc(0,size,MEM_RESERVE,PAGE_NOACCESS);
+	if (!base) return 0;
+	Bitu start=size<MEM_COMMIT_START ? size : MEM_COMMIT_START;
+	if (!VirtualAlloc(base,start,MEM_COMMIT,PAGE_READWRITE)) {
+		VirtualFree(base,0,MEM_RELEASE);
+		return 0;
+	}
+	reserved.base=base;
+	reserved.size=size;
+	if (size>start) reserved.handler=AddVectoredExceptionHandler(1,MEM_CommitOnAccess);
+	return base;
+#elif (C_HAVE_MMAP)
+	int flags=MAP_PRIVATE|MAP_ANON;
+#if defined (MAP_NORESERVE)
+	flags|=MAP_NORESERVE;
+#endif
+	void * base=mmap(0,size,PROT_READ|PROT_WRITE,flags,-1,0);
+	return (base==MAP_FAILED) ? 0 : (HostPt)base;
+#else
+	HostPt base=new Bit8u[size];
+	/* Clear the memory, as new doesn't always give zeroed memory
+	 * (Visual C debug mode). We want zeroed memory though. */
+	memset((void*)base,0,size);
+	return base;
+#endif
+}
+
+static void FreeMemBase(HostPt base,Bitu size) {
+#if defined (WIN32)
+	if (reserved.handler) RemoveVectoredExceptionHandler(reserved.handler);
+	reserved.handler=0;
+	reserved.base=0;
+	VirtualFree(base,0,MEM_RELEASE);
+#elif (C_HAVE_MMAP)
+	munmap(base,size);
+#else
+	delete [] base;
+#endif
+}
+
 class MEMORY:public Module_base{
 private:
 	IO_ReadHandleObject ReadHandler;
@@ -550,20 +662,16 @@ public:
 		Bitu memsize=section->Get_int("memsize");
 	
 		if (memsize < 1) memsize = 1;
-		/* max 63 to solve problems with certain xms handlers */
-		if (memsize > MAX_MEMORY-1) {
-			LOG_MSG("Maximum memory size is %d MB",MAX_MEMORY - 1);
-			memsize = MAX_MEMORY-1;
+		if (memsize > MAX_MEMORY) {
+			LOG_MSG("Maximum memory size is %d MB",MAX_MEMORY);
+			memsize = MAX_MEMORY;
 		}
 		if (memsize > SAFE_MEMORY-1) {
 			LOG_MSG("Memory sizes above %d MB are NOT recommended.",SAFE_MEMORY - 1);
 			LOG_MSG("Stick with the default values unless you are absolutely certain.");
 		}
-		MemBase = new Bit8u[memsize*1024*1024];
+		MemBase = AllocateMemBase(memsize*1024*1024);
 		if (!MemBase) E_Exit("Can't allocate main memory of %d MB",memsize);
-		/* Clear the memory, as new doesn't always give zeroed memory
-		 * (Visual C debug mode). We want zeroed memory though. */
-		memset((void*)MemBase,0,memsize*1024*1024);
 		memory.pages = (memsize*1024*1024)/4096;
 		/* Allocate the data for the different page information blocks */
 		memory.phandlers=new  PageHandler * [memory.pages];
@@ -586,15 +694,13 @@ public:
 				memory.phandlers[i] = &rom_page_handler;
 			}
 		}
-		/* Reset some links */
-		memory.links.used = 0;
 		// A20 Line - PS/2 system control port A
 		WriteHandler.Install(0x92,write_p92,IO_MB);
 		ReadHandler.Install(0x92,read_p92,IO_MB);
 		MEM_A20_Enable(false);
 	}
 	~MEMORY(){
-		delete [] MemBase;
+		FreeMemBase(MemBase,memory.pages*4096);
 		delete [] memory.phandlers;
 		delete [] memory.mhandles;
 	}
@@ -81,11 +81,16 @@ static struct {
 	//For every millisecond tick how many samples need to be generated
 	Bit32u tick_add;
 	Bit32u tick_counter;
+	//Samples the current tick adds
+	Bitu tick_samples;
 	float mastervol[2];
 	MixerChannel * channels;
 	bool nosound;
 	Bit32u freq;
 	Bit32u blocksize;
+	//Samples tapped for capturing, handed off after the audio lock is released
+	Bit16s capture[1024][2];
+	Bitu captured;
 } mixer;
 
 Bit8u MixTemp[MIXER_BUFSIZE];
@@ -417,20 +422,22 @@ static void MIXER_MixData(Bitu needed) {
 		chan->Mix(needed);
 		chan=chan->next;
 	}
+	/* Only copy the new samples here, the capture code can be slow and
+	 * must not run while the audio callback is locked out */
+	mixer.captured=0;
 	if (CaptureState & (CAPTURE_WAVE|CAPTURE_VIDEO|STREAM_VIDEO)) {
-		Bit16s convert[1024][2];
 		Bitu added=needed-mixer.done;
 		if (added>1024)
 			added=1024;
 		Bitu readpos=(mixer.pos+mixer.done)&MIXER_BUFMASK;
 		for (Bitu i=0;i<added;i++) {
 			Bits sample=mixer.work[readpos][0] >> MIXER_VOLSHIFT;
-			convert[i][0]=MIXER_CLIP(sample);
+			mixer.capture[i][0]=MIXER_CLIP(sample);
 			sample=mixer.work[readpos][1] >> MIXER_VOLSHIFT;
-			convert[i][1]=MIXER_CLIP(sample);
+			mixer.capture[i][1]=MIXER_CLIP(sample);
 			readpos=(readpos+1)&MIXER_BUFMASK;
 		}
-		CAPTURE_AddWave( mixer.freq, added, (Bit16s*)convert );
+		mixer.captured=added;
 	}
 	//Reset the the tick_add for constant speed
 	if( Mixer_irq_important() )
@@ -438,17 +445,39 @@ static void MIXER_MixData(Bitu needed) {
 	mixer.done = needed;
 }
 
+static void MIXER_CaptureData(void) {
+	if (mixer.captured) {
+		CAPTURE_AddWave( mixer.freq, mixer.captured, (Bit16s*)mixer.capture );
+		mixer.captured=0;
+	}
+}
+
 static void MIXER_Mix(void) {
 	SDL_LockAudio();
 	MIXER_MixData(mixer.needed);
 	mixer.tick_counter += mixer.tick_add;
-	mixer.needed+=(mixer.tick_counter >> TICK_SHIFT);
+	mixer.tick_samples = (mixer.tick_counter >> TICK_SHIFT);
+	mixer.needed+=mixer.tick_samples;
 	mixer.tick_counter &= TICK_MASK;
 	SDL_UnlockAudio();
+	MIXER_CaptureData();
+}
+
+/* Mix the part of the tick that has run so far, so the callback can play
+ * it without waiting for the end of the tick */
+void MIXER_MixSlice(void) {
+	if (mixer.nosound) return;
+	SDL_LockAudio();
+	Bitu left=(Bitu)((1.0f-PIC_TickIndex())*mixer.tick_samples);
+	if (left<mixer.needed && mixer.needed-left>mixer.done)
+		MIXER_MixData(mixer.needed-left);
+	SDL_UnlockAudio();
+	MIXER_CaptureData();
 }
 
 static void MIXER_Mix_NoSound(void) {
 	MIXER_MixData(mixer.needed);
+	MIXER_CaptureData();
 	/* Clear piece we've just generated */
 	for (Bitu i=0;i<mixer.needed;i++) {
 		mixer.work[mixer.pos][0]=0;
@@ -16,6 +16,8 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <string.h>
+
 #include "dosbox.h"
 #include "inout.h"
 #include "cpu.h"
@@ -114,6 +116,8 @@ static PIC_Controller& master = pics[0];
 static PIC_Controller& slave  = pics[1];
 Bitu PIC_Ticks = 0;
 Bitu PIC_IRQCheck = 0; //Maybe make it a bool and/or ensure 32bit size (x86 dynamic core seems to assume 32 bit variable size)
+Bitu PIC_Slices = 1;
+static Bitu slice_next = 1;	//Slice of the tick that ends next
 
 
 void PIC_Controller::set_imr(Bit8u val) {
@@ -168,14 +172,26 @@ struct PICEntry {
 	float index;
 	Bitu value;
 	PIC_EventHandler pic_event;
+	Bitu serial;			//Events with the same index run in the order they were added
 	PICEntry * next;
 };
 
-static struct {
+/* The pending events are kept in a binary min heap on the index. A short
+   queue is cheaper as an array sorted from the last event to the first,
+   new events are mostly due soon and get found near the end. */
+#define QUEUE_SORTED	256		// most events kept as a sorted array
+#define QUEUE_RESORT	128		// a heap shrunk to this gets sorted again
+
+struct PICQueue {
 	PICEntry entries[PIC_QUEUESIZE];
 	PICEntry * free_entry;
-	PICEntry * next_entry;
-} pic_queue;
+	PICEntry * heap[PIC_QUEUESIZE];
+	Bitu used;
+	Bitu serial;
+	bool sorted;
+};
+
+static PICQueue pic_queue;
 
 static void write_command(Bitu port,Bitu val,Bitu iolen) {
 	PIC_Controller * pic=&pics[port==0x20 ? 0 : 1];
@@ -369,102 +385,191 @@ void PIC_SetIRQMask(Bitu irq, bool masked) {
 	pic->set_imr(newmask);
 }
 
-static void AddEntry(PICEntry * entry) {
-	PICEntry * find_entry=pic_queue.next_entry;
-	if (GCC_UNLIKELY(find_entry ==0)) {
-		entry->next=0;
-		pic_queue.next_entry=entry;
-	} else if (find_entry->index>entry->index) {
-		pic_queue.next_entry=entry;
-		entry->next=find_entry;
-	} else while (find_entry) {
-		if (find_entry->next) {
-			/* See if the next index comes later than this one */
-			if (find_entry->next->index > entry->index) {
-				entry->next=find_entry->next;
-				find_entry->next=entry;
-				break;
-			} else {
-				find_entry=find_entry->next;
-			}
-		} else {
-			entry->next=find_entry->next;
-			find_entry->next=entry;
-			break;
+static INLINE bool QueueBefore(const PICEntry * a,const PICEntry * b) {
+	if (a->index!=b->index) return a->index<b->index;
+	return (Bits)(a->serial-b->serial)<0;
+}
+
+static void QueueSiftUp(PICQueue & queue,Bitu pos) {
+	PICEntry * entry=queue.heap[pos];
+	while (pos) {
+		Bitu parent=(pos-1)/2;
+		if (!QueueBefore(entry,queue.heap[parent])) break;
+		queue.heap[pos]=queue.heap[parent];
+		pos=parent;
+	}
+	queue.heap[pos]=entry;
+}
+
+static void QueueSiftDown(PICQueue & queue,Bitu pos) {
+	PICEntry * entry=queue.heap[pos];
+	for (;;) {
+		Bitu child=pos*2+1;
+		if (child>=queue.used) break;
+		if (child+1<queue.used && QueueBefore(queue.heap[child+1],queue.heap[child])) child++;
+		if (!QueueBefore(queue.heap[child],entry)) break;
+		queue.heap[pos]=queue.heap[child];
+		pos=child;
+	}
+	queue.heap[pos]=entry;
+}
+
+static INLINE PICEntry * QueueFirst(const PICQueue & queue) {
+	return queue.sorted ? queue.heap[queue.used-1] : queue.heap[0];
+}
+
+static void QueueReverse(PICQueue & queue) {
+	for (Bitu lo=0,hi=queue.used;lo+1<hi;lo++,hi--) {
+		PICEntry * entry=queue.heap[lo];
+		queue.heap[lo]=queue.heap[hi-1];
+		queue.heap[hi-1]=entry;
+	}
+}
+
+/* Insertion sort into the last to first order, the entries are mostly in it already */
+static void QueueSort(PICQueue & queue) {
+	for (Bitu i=1;i<queue.used;i++) {
+		PICEntry * entry=queue.heap[i];
+		Bitu pos=i;
+		while (pos && QueueBefore(queue.heap[pos-1],entry)) {
+			queue.heap[pos]=queue.heap[pos-1];
+			pos--;
 		}
+		queue.heap[pos]=entry;
 	}
-	Bits cycles=PIC_MakeCycles(pic_queue.next_entry->index-PIC_TickIndex());
-	if (cycles<CPU_Cycles) {
-		CPU_CycleLeft+=CPU_Cycles;
-		CPU_Cycles=0;
+	queue.sorted=true;
+}
+
+static void QueueHeapify(PICQueue & queue) {
+	for (Bitu pos=queue.used/2;pos>0;pos--) QueueSiftDown(queue,pos-1);
+}
+
+static void QueueShrunk(PICQueue & queue) {
+	if (!queue.sorted && queue.used<=QUEUE_RESORT) {
+		QueueReverse(queue);
+		QueueSort(queue);
+	}
+}
+
+static void QueueInit(PICQueue & queue) {
+	for (Bitu i=0;i<PIC_QUEUESIZE-1;i++) {
+		queue.entries[i].next=&queue.entries[i+1];
+	}
+	queue.entries[PIC_QUEUESIZE-1].next=0;
+	queue.free_entry=&queue.entries[0];
+	queue.used=0;
+	queue.serial=0;
+	queue.sorted=true;
+}
+
+static INLINE bool QueueAdd(PICQueue & queue,PIC_EventHandler handler,float index,Bitu val) {
+	PICEntry * entry=queue.free_entry;
+	if (GCC_UNLIKELY(!entry)) return false;
+	queue.free_entry=entry->next;
+	entry->index=index;
+	entry->pic_event=handler;
+	entry->value=val;
+	entry->serial=queue.serial++;
+	if (queue.sorted) {
+		/* The new entry has the newest serial, so equal ones stay before it */
+		Bitu pos=queue.used++;
+		while (pos && queue.heap[pos-1]->index<=index) {
+			queue.heap[pos]=queue.heap[pos-1];
+			pos--;
+		}
+		queue.heap[pos]=entry;
+		/* Ascending order is a valid heap */
+		if (queue.used>QUEUE_SORTED) {
+			QueueReverse(queue);
+			queue.sorted=false;
+		}
+		return true;
+	}
+	queue.heap[queue.used]=entry;
+	QueueSiftUp(queue,queue.used++);
+	return true;
+}
+
+/* Take the first event out of the heap, it stays allocated until QueueFree */
+static PICEntry * QueueTakeFirst(PICQueue & queue) {
+	if (queue.sorted) return queue.heap[--queue.used];
+	PICEntry * entry=queue.heap[0];
+	if (--queue.used) {
+		queue.heap[0]=queue.heap[queue.used];
+		QueueSiftDown(queue,0);
+		QueueShrunk(queue);
+	}
+	return entry;
+}
+
+static INLINE void QueueFree(PICQueue & queue,PICEntry * entry) {
+	entry->next=queue.free_entry;
+	queue.free_entry=entry;
+}
+
+static INLINE bool QueueMatch(const PICEntry * entry,PIC_EventHandler handler,bool any_value,Bitu val) {
+	return entry->pic_event==handler && (any_value || entry->value==val);
+}
+
+static void QueueRemove(PICQueue & queue,PIC_EventHandler handler,bool any_value,Bitu val) {
+	if (queue.sorted) {
+		/* Closing the gaps keeps the order */
+		Bitu pos=0;
+		while (pos<queue.used && GCC_LIKELY(!QueueMatch(queue.heap[pos],handler,any_value,val))) pos++;
+		Bitu kept=pos;
+		for (;pos<queue.used;pos++) {
+			PICEntry * entry=queue.heap[pos];
+			if (QueueMatch(entry,handler,any_value,val)) QueueFree(queue,entry);
+			else queue.heap[kept++]=entry;
+		}
+		queue.used=kept;
+		return;
+	}
+	Bitu pos=0;
+	while (pos<queue.used) {
+		PICEntry * entry=queue.heap[pos];
+		if (GCC_LIKELY(!QueueMatch(entry,handler,any_value,val))) {
+			pos++;
+			continue;
+		}
+		QueueFree(queue,entry);
+		/* Drop matching entries from the end, they need no fixing up */
+		while (--queue.used>pos && QueueMatch(queue.heap[queue.used],handler,any_value,val))
+			QueueFree(queue,queue.heap[queue.used]);
+		if (pos>=queue.used) break;
+		/* Move the last entry into the hole and restore the heap there.
+		   Whatever ends up at pos has not been checked yet, so stay. */
+		queue.heap[pos]=queue.heap[queue.used];
+		if (pos && QueueBefore(queue.heap[pos],queue.heap[(pos-1)/2])) QueueSiftUp(queue,pos);
+		else QueueSiftDown(queue,pos);
 	}
+	QueueShrunk(queue);
 }
+
 static bool InEventService = false;
 static float srv_lag = 0;
 
 void PIC_AddEvent(PIC_EventHandler handler,float delay,Bitu val) {
-	if (GCC_UNLIKELY(!pic_queue.free_entry)) {
+	float index;
+	if(InEventService) index = delay + srv_lag;
+	else index = delay + PIC_TickIndex();
+	if (GCC_UNLIKELY(!QueueAdd(pic_queue,handler,index,val))) {
 		LOG(LOG_PIC,LOG_ERROR)("Event queue full");
 		return;
 	}
-	PICEntry * entry=pic_queue.free_entry;
-	if(InEventService) entry->index = delay + srv_lag;
-	else entry->index = delay + PIC_TickIndex();
-
-	entry->pic_event=handler;
-	entry->value=val;
-	pic_queue.free_entry=pic_queue.free_entry->next;
-	AddEntry(entry);
+	Bits cycles=PIC_MakeCycles(QueueFirst(pic_queue)->index-PIC_TickIndex());
+	if (cycles<CPU_Cycles) {
+		CPU_CycleLeft+=CPU_Cycles;
+		CPU_Cycles=0;
+	}
 }
 
 void PIC_RemoveSpecificEvents(PIC_EventHandler handler, Bitu val) {
-	PICEntry * entry=pic_queue.next_entry;
-	PICEntry * prev_entry;
-	prev_entry = 0;
-	while (entry) {
-		if (GCC_UNLIKELY((entry->pic_event == handler)) && (entry->value == val)) {
-			if (prev_entry) {
-				prev_entry->next=entry->next;
-				entry->next=pic_queue.free_entry;
-				pic_queue.free_entry=entry;
-				entry=prev_entry->next;
-				continue;
-			} else {
-				pic_queue.next_entry=entry->next;
-				entry->next=pic_queue.free_entry;
-				pic_queue.free_entry=entry;
-				entry=pic_queue.next_entry;
-				continue;
-			}
-		}
-		prev_entry=entry;
-		entry=entry->next;
-	}	
+	QueueRemove(pic_queue,handler,false,val);
 }
 
 void PIC_RemoveEvents(PIC_EventHandler handler) {
-	PICEntry * entry=pic_queue.next_entry;
-	PICEntry * prev_entry;
-	prev_entry=0;
-	while (entry) {
-		if (GCC_UNLIKELY(entry->pic_event==handler)) {
-			if (prev_entry) {
-				prev_entry->next=entry->next;
-				entry->next=pic_queue.free_entry;
-				pic_queue.free_entry=entry;
-				entry=prev_entry->next;
-				continue;
-			} else {
-				pic_queue.next_entry=entry->next;
-				entry->next=pic_queue.free_entry;
-				pic_queue.free_entry=entry;
-				entry=pic_queue.next_entry;
-				continue;
-			}
-		}
-		prev_entry=entry;
-		entry=entry->next;
-	}	
+	QueueRemove(pic_queue,handler,true,0);
 }
 
 
@@ -475,25 +580,32 @@ bool PIC_RunQueue(void) {
 	if (CPU_CycleLeft<=0) {
 		return false;
 	}
-	/* Check the queue for an entry */
+	/* Hand control back at the end of every slice of the tick */
 	Bits index_nd=PIC_TickIndexND();
+	Bits slice_end=CPU_CycleMax;
+	if (slice_next<PIC_Slices) {
+		slice_end=(Bits)(((Bit64s)CPU_CycleMax*slice_next)/PIC_Slices);
+		if (index_nd>=slice_end) {
+			slice_next++;
+			return false;
+		}
+	}
+	/* Check the queue for an entry */
 	InEventService = true;
-	while (pic_queue.next_entry && (pic_queue.next_entry->index*CPU_CycleMax<=index_nd)) {
-		PICEntry * entry=pic_queue.next_entry;
-		pic_queue.next_entry=entry->next;
+	while (pic_queue.used && (QueueFirst(pic_queue)->index*CPU_CycleMax<=index_nd)) {
+		PICEntry * entry=QueueTakeFirst(pic_queue);
 
 		srv_lag = entry->index;
 		(entry->pic_event)(entry->value); // call the event handler
 
 		/* Put the entry in the free list */
-		entry->next=pic_queue.free_entry;
-		pic_queue.free_entry=entry;
+		QueueFree(pic_queue,entry);
 	}
 	InEventService = false;
 
 	/* Check when to set the new cycle end */
-	if (pic_queue.next_entry) {
-		Bits cycles=(Bits)(pic_queue.next_entry->index*CPU_CycleMax-index_nd);
+	if (pic_queue.used) {
+		Bits cycles=(Bits)(QueueFirst(pic_queue)->index*CPU_CycleMax-index_nd);
 		if (GCC_UNLIKELY(!cycles)) cycles=1;
 		if (cycles<CPU_CycleLeft) {
 			CPU_Cycles=cycles;
@@ -501,11 +613,116 @@ bool PIC_RunQueue(void) {
 			CPU_Cycles=CPU_CycleLeft;
 		}
 	} else CPU_Cycles=CPU_CycleLeft;
+	if (slice_next<PIC_Slices && CPU_Cycles>slice_end-index_nd) CPU_Cycles=slice_end-index_nd;
 	CPU_CycleLeft-=CPU_Cycles;
 	if 	(PIC_IRQCheck)	PIC_runIRQs();
 	return true;
 }
 
+/* Whole ticks after the current one that have no event due, at most limit */
+Bitu PIC_IdleTicks(Bitu limit) {
+	if (PIC_IRQCheck) return 0;
+	if (!pic_queue.used) return limit;
+	float index=QueueFirst(pic_queue)->index;
+	if (index<2.0f) return 0;
+	Bitu ticks=(Bitu)index-1;
+	return ticks<limit ? ticks : limit;
+}
+
+/* Event queue benchmark for PICBENCH. It runs the same add, run and remove
+   pattern on the queue and on the sorted list the heap replaced. */
+static void PIC_BenchEvent(Bitu val) {
+}
+
+static void ListAdd(PICEntry * & first,PICEntry * entry) {
+	PICEntry * find_entry=first;
+	if (!find_entry || find_entry->index>entry->index) {
+		entry->next=find_entry;
+		first=entry;
+		return;
+	}
+	while (find_entry->next && find_entry->next->index<=entry->index) find_entry=find_entry->next;
+	entry->next=find_entry->next;
+	find_entry->next=entry;
+}
+
+static Bitu ListRemove(PICQueue & queue,PICEntry * & first,PIC_EventHandler handler,Bitu val) {
+	Bitu removed=0;
+	PICEntry * * where=&first;
+	while (*where) {
+		PICEntry * entry=*where;
+		if (entry->pic_event==handler && entry->value==val) {
+			*where=entry->next;
+			QueueFree(queue,entry);
+			removed++;
+		} else where=&entry->next;
+	}
+	return removed;
+}
+
+Bitu PIC_BenchmarkQueue(bool list,Bitu pending,Bitu ms) {
+	if (pending>PIC_QUEUESIZE-1) pending=PIC_QUEUESIZE-1;
+	PICQueue * queue=new PICQueue;
+	QueueInit(*queue);
+	PICEntry * first=0;
+	Bitu count=0;
+	Bit32u seed=1;
+#define BENCH_RANDOM() (seed=seed*1664525+1013904223,(seed >> 8)/16777216.0f)
+	Bitu ops=0;
+	Bitu start=GetTicks();
+	Bitu elapsed=0;
+	while (elapsed<ms) {
+		for (Bitu i=0;i<4096;i++,ops++) {
+			/* Keep the queue filled like the devices do */
+			while (count<pending) {
+				float index=BENCH_RANDOM();
+				Bitu val=(Bitu)(BENCH_RANDOM()*pending*4);
+				if (list) {
+					PICEntry * entry=queue->free_entry;
+					queue->free_entry=entry->next;
+					entry->index=index;
+					entry->pic_event=&PIC_BenchEvent;
+					entry->value=val;
+					ListAdd(first,entry);
+				} else QueueAdd(*queue,&PIC_BenchEvent,index,val);
+				count++;
+			}
+			/* Run the first event, which schedules itself again */
+			PICEntry * entry;
+			if (list) {
+				entry=first;
+				first=entry->next;
+			} else entry=QueueTakeFirst(*queue);
+			float index=entry->index+BENCH_RANDOM();
+			Bitu val=entry->value;
+			QueueFree(*queue,entry);
+			count--;
+			if (list) {
+				entry=queue->free_entry;
+				queue->free_entry=entry->next;
+				entry->index=index;
+				entry->pic_event=&PIC_BenchEvent;
+				entry->value=val;
+				ListAdd(first,entry);
+			} else QueueAdd(*queue,&PIC_BenchEvent,index,val);
+			count++;
+			/* And every few events one gets cancelled */
+			if ((i & 7)==0) {
+				val=(Bitu)(BENCH_RANDOM()*pending*4);
+				if (list) count-=ListRemove(*queue,first,&PIC_BenchEvent,val);
+				else {
+					QueueRemove(*queue,&PIC_BenchEvent,false,val);
+					count=queue->used;
+				}
+			}
+		}
+		elapsed=GetTicks()-start;
+	}
+#undef BENCH_RANDOM
+	delete queue;
+	return elapsed ? ops/elapsed : 0;
+}
+
 /* The TIMER Part */
 struct TickerBlock {
 	TIMER_TickHandler handler;
@@ -541,11 +758,20 @@ void TIMER_AddTick(void) {
 	CPU_CycleLeft=CPU_CycleMax;
 	CPU_Cycles=0;
 	PIC_Ticks++;
-	/* Go through the list of scheduled events and lower their index with 1000 */
-	PICEntry * entry=pic_queue.next_entry;
-	while (entry) {
-		entry->index -= 1.0;
-		entry=entry->next;
+	slice_next=1;
+	/* Go through the list of scheduled events and lower their index with 1000.
+	   That keeps the order, except that overdue events close to 0 can round
+	   to the same index, and then the serial may put them the other way. */
+	bool reorder=false;
+	for (Bitu i=0;i<pic_queue.used;i++) {
+		pic_queue.heap[i]->index -= 1.0;
+		if (!i) continue;
+		if (pic_queue.sorted) reorder|=QueueBefore(pic_queue.heap[i-1],pic_queue.heap[i]);
+		else reorder|=QueueBefore(pic_queue.heap[i],pic_queue.heap[(i-1)/2]);
+	}
+	if (GCC_UNLIKELY(reorder)) {
+		if (pic_queue.sorted) QueueSort(pic_queue);
+		else QueueHeapify(pic_queue);
 	}
 	/* Call our list of ticker handlers */
 	TickerBlock * ticker=firstticker;
@@ -600,12 +826,7 @@ public:
 		WriteHandler[2].Install(0xa0,write_command,IO_MB);
 		WriteHandler[3].Install(0xa1,write_data,IO_MB);
 		/* Initialize the pic queue */
-		for (i=0;i<PIC_QUEUESIZE-1;i++) {
-			pic_queue.entries[i].next=&pic_queue.entries[i+1];
-		}
-		pic_queue.entries[PIC_QUEUESIZE-1].next=0;
-		pic_queue.free_entry=&pic_queue.entries[0];
-		pic_queue.next_entry=0;
+		QueueInit(pic_queue);
 	}
 
 	~PIC_8259A(){
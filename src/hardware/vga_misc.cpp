@@ -55,6 +55,29 @@ Bitu vga_read_p3da(Bitu port,Bitu iolen) {
 	return retval;
 }
 
+/* Time in ms before any of the status register bits can change, this takes
+   every retrace and blanking edge, so it also holds for the other adapters */
+double VGA_StatusStable(void) {
+	double timeInFrame = PIC_FullIndex()-vga.draw.delay.framestart;
+	if (vga.draw.delay.htotal<=0 || timeInFrame<0) return 0;
+	double lineStart = timeInFrame-fmod(timeInFrame,vga.draw.delay.htotal);
+	double next = lineStart+vga.draw.delay.htotal;
+	const double frameEdges[] = {
+		vga.draw.delay.vrstart, vga.draw.delay.vrend,
+		vga.draw.delay.vdend, vga.draw.delay.vtotal
+	};
+	const double lineEdges[] = {
+		vga.draw.delay.hrstart, vga.draw.delay.hrend,
+		vga.draw.delay.hblkstart, vga.draw.delay.hblkend
+	};
+	for (Bitu i=0;i<4;i++) {
+		if (frameEdges[i]>timeInFrame && frameEdges[i]<next) next=frameEdges[i];
+		double edge=lineStart+lineEdges[i];
+		if (edge>timeInFrame && edge<next) next=edge;
+	}
+	return next-timeInFrame;
+}
+
 static void write_p3c2(Bitu port,Bitu val,Bitu iolen) {
 	vga.misc_output=val;
 
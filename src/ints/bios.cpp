@@ -947,6 +947,15 @@ static Bitu INT15_Handler(void) {
 		LOG(LOG_BIOS,LOG_NORMAL)("INT15:Function %X called, bios mouse not supported",reg_ah);
 		CALLBACK_SCF(true);
 		break;
+	case 0xe8:
+		if (reg_al==0x01) {	/* GET MEMORY SIZE FOR >64M CONFIGURATIONS */
+			Bitu kb=other_memsystems ? 0 : MEM_TotalPages()*4-1024;
+			reg_ax=reg_cx=(Bit16u)(kb>0x3c00 ? 0x3c00 : kb);
+			reg_bx=reg_dx=(Bit16u)(kb>0x3c00 ? (kb-0x3c00)/64 : 0);
+			CALLBACK_SCF(false);
+			break;
+		}
+		// fall through
 	default:
 		LOG(LOG_BIOS,LOG_ERROR)("INT15:Unknown call %4X",reg_ax);
 		reg_ah=0x86;
@@ -23,6 +23,7 @@
 #include "bios.h"
 #include "keyboard.h"
 #include "regs.h"
+#include "cpu.h"
 #include "inout.h"
 #include "dos_inc.h"
 #include "SDL.h"
@@ -506,6 +507,8 @@ static Bitu INT16_Handler(void) {
 		} else {
 			/* enter small idle loop to allow for irqs to happen */
 			reg_ip+=1;
+			/* and halt in it, no need to run it before the next irq */
+			if (CPU_IdleSleep) CPU_HLT(reg_eip);
 		}
 		break;
 	case 0x10: /* GET KEYSTROKE (enhanced keyboards only) */
@@ -518,6 +521,8 @@ static Bitu INT16_Handler(void) {
 		} else {
 			/* enter small idle loop to allow for irqs to happen */
 			reg_ip+=1;
+			/* and halt in it, no need to run it before the next irq */
+			if (CPU_IdleSleep) CPU_HLT(reg_eip);
 		}
 		break;
 	case 0x01: /* CHECK FOR KEYSTROKE */
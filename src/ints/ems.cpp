@@ -196,7 +196,7 @@ bool device_EMM::ReadFromControlChannel(PhysPt bufptr,Bit16u size,Bit16u * retco
 			if (!is_emm386) return false;
 			if (EMM_MINOR_VERSION < 0x2d) return false;
 			if (size!=4) return false;
-			mem_writew(bufptr+0x00,(Bit16u)(MEM_TotalPages()*4));	// max size (kb)
+			mem_writew(bufptr+0x00,(Bit16u)(MEM_TotalPages()>=0x4000 ? 0xffff : MEM_TotalPages()*4));	// max size (kb)
 			mem_writew(bufptr+0x02,0x80);							// min size (kb)
 			*retcode=2;
 			return true;
@@ -704,7 +704,7 @@ static Bitu INT67_Handler(void) {
 		reg_ah=EMM_NO_ERROR;
 		break;
 	case 0x42:		/* Get number of pages */
-		reg_dx=(Bit16u)(MEM_TotalPages()/4);		//Not entirely correct but okay
+		reg_dx=(Bit16u)(MEM_TotalPages()/4>0x7fff ? 0x7fff : MEM_TotalPages()/4);		//Not entirely correct but okay
 		reg_bx=EMM_GetFreePages();
 		reg_ah=EMM_NO_ERROR;
 		break;
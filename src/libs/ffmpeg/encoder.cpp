@@ -0,0 +1,362 @@
+/*
+ *  Copyright (C) 2002-2019  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include <string.h>
+#include "dosbox.h"
+
+#if (C_STREAM)
+
+#include "encoder.h"
+#include "muxing.h"
+
+#define NO_SLOT ((Bitu)~0)
+/* About 1.5 seconds at 44100 Hz */
+#define AUDIO_RING (64*1024)
+
+StreamEncoder::StreamEncoder() {
+	ctx = 0;
+	thread = 0;
+	lock = 0;
+	cond = 0;
+	slots = 0;
+	slotCount = 0;
+	freeList = 0;
+	freeUsed = 0;
+	queue = 0;
+	queueSize = queueHead = queueUsed = 0;
+	writing = NO_SLOT;
+	quit = false;
+	audioThread = 0;
+	audioCond = 0;
+	audioRing = 0;
+	audioRead = audioWrite = audioUsed = 0;
+	audioDropped = 0;
+	adaptive = false;
+	level = 0;
+	busyFrames = idleFrames = 0;
+	policy = DROP_OLDEST;
+	width = height = fps = 0;
+	srcWidth = srcHeight = bpp = 0;
+	pitch = 0;
+	frames = 0;
+	lastFrame = 0;
+	needFrame = true;
+	dropped = 0;
+}
+
+StreamEncoder::~StreamEncoder() {
+	Stop();
+}
+
+void StreamEncoder::FreeBuffers(void) {
+	if (slots) {
+		for (Bitu i=0;i<slotCount;i++)
+			delete [] slots[i].data;
+		delete [] slots;
+		slots = 0;
+	}
+	delete [] freeList;
+	freeList = 0;
+	delete [] queue;
+	queue = 0;
+	delete [] audioRing;
+	audioRing = 0;
+	if (cond) SDL_DestroyCond(cond);
+	cond = 0;
+	if (audioCond) SDL_DestroyCond(audioCond);
+	audioCond = 0;
+	if (lock) SDL_DestroyMutex(lock);
+	lock = 0;
+	delete ctx;
+	ctx = 0;
+}
+
+bool StreamEncoder::Start(const char * url, int _width, int _height, int _srcWidth, int _srcHeight, int _bpp,
+	int _fps, Bitu _queueSize, DropPolicy _policy, const StreamSettings & settings, int _level) {
+	Stop();
+	if (_queueSize < 1)
+		_queueSize = 1;
+	width = _width;
+	height = _height;
+	srcWidth = _srcWidth;
+	srcHeight = _srcHeight;
+	bpp = _bpp;
+	pitch = srcWidth * ((bpp + 7) / 8);
+	fps = _fps;
+	policy = _policy;
+	frames = 0;
+	lastFrame = 0;
+	needFrame = true;
+	dropped = 0;
+	quit = false;
+	adaptive = settings.adaptive != 0;
+	level = _level;
+	if (level < 0) level = 0;
+	if (level > STREAM_MAX_LEVEL) level = STREAM_MAX_LEVEL;
+	busyFrames = idleFrames = 0;
+
+	ctx = new StreamContext;
+	memset(ctx, 0, sizeof(StreamContext));
+	ctx->width = width;
+	ctx->height = height;
+	ctx->fps = fps;
+	ctx->src_width = srcWidth;
+	ctx->src_height = srcHeight;
+	ctx->src_bpp = bpp;
+	ctx->settings = settings;
+	ctx->level = level;
+	if (streaming_init(url, ctx) || !ctx->oc) {
+		FreeBuffers();
+		return false;
+	}
+
+	/* One slot per queue entry, one for the emulation thread to fill
+	 * and one for the encoder thread to work on */
+	queueSize = _queueSize;
+	queueHead = queueUsed = 0;
+	slotCount = queueSize + 2;
+	slots = new Slot[slotCount];
+	freeList = new Bitu[slotCount];
+	queue = new Bitu[queueSize];
+	for (Bitu i=0;i<slotCount;i++) {
+		slots[i].data = new Bit8u[pitch * srcHeight];
+		slots[i].pts = 0;
+		freeList[i] = i;
+	}
+	freeUsed = slotCount;
+	writing = NO_SLOT;
+
+	audioRing = new Bit16s[AUDIO_RING][2];
+	audioRead = audioWrite = audioUsed = 0;
+	audioDropped = 0;
+
+	lock = SDL_CreateMutex();
+	cond = SDL_CreateCond();
+	audioCond = SDL_CreateCond();
+	if (lock && cond && audioCond) {
+		thread = SDL_CreateThread(&StreamEncoder::ThreadProc, this);
+		if (thread)
+			audioThread = SDL_CreateThread(&StreamEncoder::AudioThreadProc, this);
+	}
+	if (!audioThread) {
+		LOG_MSG("Failed to start the stream encoder threads");
+		if (thread) {
+			Stop();
+		} else {
+			streaming_cleanup(ctx);
+			FreeBuffers();
+		}
+		return false;
+	}
+	return true;
+}
+
+void StreamEncoder::Stop(void) {
+	if (!thread)
+		return;
+	SDL_mutexP(lock);
+	quit = true;
+	SDL_CondSignal(cond);
+	SDL_CondSignal(audioCond);
+	SDL_mutexV(lock);
+	/* The encoder threads drain their queues before they exit */
+	SDL_WaitThread(thread, 0);
+	thread = 0;
+	if (audioThread) {
+		SDL_WaitThread(audioThread, 0);
+		audioThread = 0;
+	}
+	streaming_cleanup(ctx);
+	if (dropped)
+		LOG_MSG("Stream encoder dropped %d of %d frames", (int)dropped, (int)frames);
+	if (audioDropped)
+		LOG_MSG("Stream encoder dropped %d audio samples", (int)audioDropped);
+	FreeBuffers();
+}
+
+Bit8u * StreamEncoder::GetFrame(void) {
+	if (!thread)
+		return 0;
+	Bitu slot;
+	SDL_mutexP(lock);
+	/* Count every offered frame so dropped frames leave a gap in time */
+	Bit64s pts = frames++;
+	lastFrame = pts;
+	if (queueUsed == queueSize) {
+		dropped++;
+		if (policy == DROP_NEWEST) {
+			/* The stream lacks this picture, so the next one can't be a repeat */
+			needFrame = true;
+			SDL_mutexV(lock);
+			return 0;
+		}
+		slot = queue[queueHead];
+		queueHead = (queueHead + 1) % queueSize;
+		queueUsed--;
+	} else {
+		slot = freeList[--freeUsed];
+	}
+	writing = slot;
+	slots[slot].pts = pts;
+	needFrame = false;
+	SDL_mutexV(lock);
+	return slots[slot].data;
+}
+
+bool StreamEncoder::RepeatFrame(void) {
+	if (!thread)
+		return false;
+	SDL_mutexP(lock);
+	if (needFrame || frames - lastFrame >= fps) {
+		SDL_mutexV(lock);
+		return false;
+	}
+	/* Leaving a gap in the timestamps shows the last picture for longer */
+	frames++;
+	SDL_mutexV(lock);
+	return true;
+}
+
+void StreamEncoder::SubmitFrame(const Bit8u * pal) {
+	if (writing == NO_SLOT)
+		return;
+	if (bpp == 8) {
+		Bit32u * dest = slots[writing].pal;
+		for (Bitu i=0;i<256;i++)
+			dest[i] = 0xff000000 | (pal[i*4+0] << 16) | (pal[i*4+1] << 8) | pal[i*4+2];
+	}
+	SDL_mutexP(lock);
+	queue[(queueHead + queueUsed) % queueSize] = writing;
+	queueUsed++;
+	writing = NO_SLOT;
+	SDL_CondSignal(cond);
+	SDL_mutexV(lock);
+}
+
+void StreamEncoder::AddAudio(Bit32u len, Bit16s * data) {
+	if (!audioThread)
+		return;
+	SDL_mutexP(lock);
+	Bitu pos = audioWrite;
+	Bitu left = AUDIO_RING - audioUsed;
+	SDL_mutexV(lock);
+	/* The free part of the ring belongs to this thread until it is
+	 * published, so the copy happens without holding the lock */
+	if (left > len)
+		left = len;
+	audioDropped += len - left;
+	Bitu count = left;
+	while (count) {
+		Bitu chunk = AUDIO_RING - pos;
+		if (chunk > count)
+			chunk = count;
+		memcpy(audioRing[pos], data, chunk * 4);
+		data += chunk * 2;
+		pos = (pos + chunk) % AUDIO_RING;
+		count -= chunk;
+	}
+	if (!left)
+		return;
+	SDL_mutexP(lock);
+	audioWrite = pos;
+	audioUsed += left;
+	SDL_CondSignal(audioCond);
+	SDL_mutexV(lock);
+}
+
+int StreamEncoder::ThreadProc(void * data) {
+	static_cast<StreamEncoder *>(data)->Run();
+	return 0;
+}
+
+int StreamEncoder::AudioThreadProc(void * data) {
+	static_cast<StreamEncoder *>(data)->AudioRun();
+	return 0;
+}
+
+void StreamEncoder::AudioRun(void) {
+	SDL_mutexP(lock);
+	for (;;) {
+		while (!audioUsed && !quit)
+			SDL_CondWait(audioCond, lock);
+		if (!audioUsed)
+			break;
+		Bitu pos = audioRead;
+		Bitu count = AUDIO_RING - pos;
+		if (count > audioUsed)
+			count = audioUsed;
+		SDL_mutexV(lock);
+
+		streaming_audio(ctx, count, audioRing[pos]);
+
+		SDL_mutexP(lock);
+		audioRead = (pos + count) % AUDIO_RING;
+		audioUsed -= count;
+	}
+	SDL_mutexV(lock);
+}
+
+void StreamEncoder::Run(void) {
+	SDL_mutexP(lock);
+	for (;;) {
+		while (!queueUsed && !quit)
+			SDL_CondWait(cond, lock);
+		if (!queueUsed)
+			break;
+		Bitu slot = queue[queueHead];
+		queueHead = (queueHead + 1) % queueSize;
+		queueUsed--;
+		SDL_mutexV(lock);
+
+		streaming_video_frame(ctx, slots[slot].data, pitch, slots[slot].pal, slots[slot].pts);
+
+		SDL_mutexP(lock);
+		freeList[freeUsed++] = slot;
+		if (adaptive) {
+			Bitu backlog = queueUsed;
+			SDL_mutexV(lock);
+			Adapt(backlog);
+			SDL_mutexP(lock);
+		}
+	}
+	SDL_mutexV(lock);
+}
+
+/* Lower the quality when the queue stays mostly full for half a second,
+ * raise it again after ten seconds of the encoder keeping up */
+void StreamEncoder::Adapt(Bitu backlog) {
+	if (backlog * 4 >= queueSize * 3) {
+		idleFrames = 0;
+		if (++busyFrames >= (Bitu)(fps / 2 + 1) && level < STREAM_MAX_LEVEL) {
+			level = streaming_set_level(ctx, level + 1);
+			busyFrames = 0;
+		}
+	} else if (backlog == 0) {
+		busyFrames = 0;
+		if (++idleFrames >= (Bitu)(fps * 10 + 1) && level > 0) {
+			level = streaming_set_level(ctx, level - 1);
+			idleFrames = 0;
+		}
+	} else {
+		busyFrames = 0;
+		idleFrames = 0;
+	}
+}
+
+#endif
@@ -0,0 +1,126 @@
+/*
+ *  Copyright (C) 2002-2019  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_STREAM_ENCODER_H
+#define DOSBOX_STREAM_ENCODER_H
+
+#if (C_STREAM)
+
+#include "SDL.h"
+#include "stream_settings.h"
+
+struct StreamContext;
+
+/* Runs the ffmpeg encoders and muxer on threads of their own.
+ * The emulation thread only fills a frame slot and queues it, the video
+ * encoder thread converts, encodes and writes it to the stream.
+ * Audio goes through a sample ring drained by the audio encoder thread. */
+class StreamEncoder {
+public:
+	enum DropPolicy {
+		DROP_OLDEST,
+		DROP_NEWEST
+	};
+
+	StreamEncoder();
+	~StreamEncoder();
+
+	/* width and height are the capture size, the source frames are
+	 * srcWidth x srcHeight in their native bpp and get scaled up.
+	 * level is the adaptive quality level to start with. */
+	bool Start(const char * url, int width, int height, int srcWidth, int srcHeight, int bpp,
+		int fps, Bitu queueSize, DropPolicy policy, const StreamSettings & settings, int level);
+	void Stop(void);
+	bool Active(void) const { return thread != 0; }
+
+	/* Returns a buffer for srcHeight lines of Pitch() bytes in the native
+	 * source format, or 0 when the queue is full and the frame is skipped */
+	Bit8u * GetFrame(void);
+	/* Counts a frame identical to the previous one without encoding it.
+	 * Returns false when a real frame is due, at least one per second
+	 * goes out so a static screen keeps the stream alive. */
+	bool RepeatFrame(void);
+	/* pal holds the 8bpp palette as 256 r,g,b,x entries */
+	void SubmitFrame(const Bit8u * pal);
+	Bitu Pitch(void) const { return pitch; }
+
+	/* Copies stereo samples into the audio ring, never blocks on the encoder */
+	void AddAudio(Bit32u len, Bit16s * data);
+
+	int Width(void) const { return width; }
+	int Height(void) const { return height; }
+	int Fps(void) const { return fps; }
+	int Bpp(void) const { return bpp; }
+	Bitu Dropped(void) const { return dropped; }
+	int Level(void) const { return level; }
+private:
+	struct Slot {
+		Bit8u * data;
+		/* palette in the native endian 0xAARRGGBB layout swscale wants */
+		Bit32u pal[256];
+		Bit64s pts;
+	};
+
+	StreamContext * ctx;
+	SDL_Thread * thread;
+	SDL_mutex * lock;
+	SDL_cond * cond;
+
+	Slot * slots;
+	Bitu slotCount;
+	Bitu * freeList;
+	Bitu freeUsed;
+	/* Ring of slot numbers waiting to be encoded */
+	Bitu * queue;
+	Bitu queueSize, queueHead, queueUsed;
+	Bitu writing;
+	bool quit;
+
+	/* Ring of stereo samples, filled by the emulation thread only and
+	 * drained by the audio encoder thread only */
+	SDL_Thread * audioThread;
+	SDL_cond * audioCond;
+	Bit16s (*audioRing)[2];
+	Bitu audioRead, audioWrite, audioUsed;
+	Bitu audioDropped;
+
+	/* Adaptive quality, only touched by the video encoder thread */
+	bool adaptive;
+	int level;
+	Bitu busyFrames, idleFrames;
+
+	DropPolicy policy;
+	int width, height, fps;
+	int srcWidth, srcHeight, bpp;
+	Bitu pitch;
+	Bit64s frames;
+	Bit64s lastFrame;
+	bool needFrame;
+	Bitu dropped;
+
+	static int ThreadProc(void * data);
+	static int AudioThreadProc(void * data);
+	void Run(void);
+	void AudioRun(void);
+	void Adapt(Bitu backlog);
+	void FreeBuffers(void);
+};
+
+#endif
+
+#endif
@@ -53,6 +53,26 @@
 
 #define SCALE_FLAGS SWS_BICUBIC
 
+/* x264 presets from fastest to slowest, the adaptive mode steps towards
+ * the start of the list */
+static const char *x264_presets[] = {
+    "ultrafast", "superfast", "veryfast", "faster", "fast",
+    "medium", "slow", "slower", "veryslow", NULL
+};
+
+/* percentage of the configured video bitrate for each adaptive level */
+static const int level_bitrate[STREAM_MAX_LEVEL + 1] = { 100, 80, 64, 50, 40 };
+
+static int level_video_bitrate(const StreamContext *ctx, int level)
+{
+    return (int)((int64_t)ctx->settings.video_bitrate * level_bitrate[level] / 100);
+}
+
+static int level_crf(const StreamContext *ctx, int level)
+{
+    return min(ctx->settings.crf + 2 * level, 51);
+}
+
 static void log_packet(const AVFormatContext *fmt_ctx, const AVPacket *pkt)
 {
     AVRational *time_base = &fmt_ctx->streams[pkt->stream_index]->time_base;
@@ -64,15 +84,178 @@ static void log_packet(const AVFormatContext *fmt_ctx, const AVPacket *pkt)
            pkt->stream_index);
 }
 
-static int write_frame(AVFormatContext *fmt_ctx, const AVRational *time_base, AVStream *st, AVPacket *pkt)
+/**************************************************************/
+/* output selection and segmenting */
+
+/* The container for a target: rtmp goes out as flv, network and pipe
+ * targets as mpegts, files by their extension. Names without a known
+ * extension, such as named pipes, get the streamable mpegts too. */
+static const char *output_format_name(const char *target, const char *format)
+{
+    if (format[0])
+        return format;
+    if (!strncmp(target, "rtmp", 4))
+        return "flv";
+    if (!strncmp(target, "udp://", 6) || !strncmp(target, "tcp://", 6) ||
+        !strncmp(target, "srt://", 6) || !strncmp(target, "pipe:", 5))
+        return "mpegts";
+    if (av_guess_format(NULL, target, NULL))
+        return NULL;
+    return "mpegts";
+}
+
+/* Only plain files can be split */
+static int is_file_target(const char *target)
+{
+    return !strncmp(target, "file:", 5) || (!strstr(target, "://") && strncmp(target, "pipe:", 5));
+}
+
+/* name_000.ext, name_001.ext, ... */
+static void segment_name(const StreamContext *ctx, char *name, size_t size)
+{
+    const char *target = ctx->target;
+    const char *ext = strrchr(target, '.');
+    const char *slash = strrchr(target, '/');
+    const char *backslash = strrchr(target, '\\');
+    /* The last path separator, NULL when there is none */
+    const char *sep = !slash ? backslash : !backslash ? slash : max(slash, backslash);
+    if (!ctx->segmenting) {
+        snprintf(name, size, "%s", target);
+        return;
+    }
+    if (!ext || (sep && ext < sep))
+        ext = target + strlen(target);
+    snprintf(name, size, "%.*s_%03d%s", (int)(ext - target), target, ctx->segment_index, ext);
+}
+
+static int open_output(StreamContext *ctx)
+{
+    AVDictionary *opt = NULL;
+    char name[1024];
+    int ret;
+
+    segment_name(ctx, name, sizeof(name));
+    av_dump_format(ctx->oc, 0, name, 1);
+
+    /* open the output file, if needed */
+    if (!(ctx->oc->oformat->flags & AVFMT_NOFILE)) {
+        ret = avio_open(&ctx->oc->pb, name, AVIO_FLAG_WRITE);
+        if (ret < 0) {
+            LOG_MSG("Could not open '%s': %s\n", name,
+                    av_err2str(ret));
+            return ret;
+        }
+    }
+
+    /* mp4 is written fragmented, so an interrupted recording stays
+     * playable and pipes need no seeking */
+    if (!strcmp(ctx->oc->oformat->name, "mp4") || !strcmp(ctx->oc->oformat->name, "mov"))
+        av_dict_set(&opt, "movflags", "frag_keyframe+empty_moov+default_base_moof", 0);
+
+    /* Write the stream header, if any. */
+    ret = avformat_write_header(ctx->oc, &opt);
+    av_dict_free(&opt);
+    if (ret < 0) {
+        LOG_MSG("Error occurred when opening output file: %s\n",
+                av_err2str(ret));
+        return ret;
+    }
+    return 0;
+}
+
+static int segment_full(const StreamContext *ctx, const AVPacket *pkt)
 {
+    const StreamSettings *settings = &ctx->settings;
+    if (settings->segment_size &&
+        avio_tell(ctx->oc->pb) >= (int64_t)settings->segment_size * 1024 * 1024)
+        return 1;
+    if (settings->segment_time &&
+        av_compare_ts(pkt->pts - ctx->segment_start, ctx->video_st.st->time_base,
+                      settings->segment_time, (AVRational){ 1, 1 }) >= 0)
+        return 1;
+    return 0;
+}
+
+static int segment_stream(AVFormatContext *oc, OutputStream *ost)
+{
+    AVStream *st;
+    if (!ost->st)
+        return 0;
+    st = avformat_new_stream(oc, NULL);
+    if (!st)
+        return -1;
+    st->id = oc->nb_streams-1;
+    st->time_base = ost->enc->time_base;
+    ost->st = st;
+    return avcodec_parameters_from_context(st->codecpar, ost->enc);
+}
+
+/* Close the current file and continue in the next one, the encoders keep
+ * running. pkt is the keyframe the new segment starts with. */
+static int next_segment(StreamContext *ctx, AVPacket *pkt)
+{
+    AVFormatContext *oc = NULL;
+    AVRational video_tb = ctx->video_st.st->time_base;
+    int ret;
+
+    av_write_trailer(ctx->oc);
+    avio_closep(&ctx->oc->pb);
+
+    ctx->segment_index++;
+    avformat_alloc_output_context2(&oc, ctx->oc->oformat, NULL, NULL);
+    avformat_free_context(ctx->oc);
+    ctx->oc = oc;
+    if (!oc)
+        return -1;
+    ret = segment_stream(oc, &ctx->video_st);
+    if (ret >= 0)
+        ret = segment_stream(oc, &ctx->audio_st);
+    if (ret < 0)
+        return ret;
+
+    /* every segment starts at time 0 */
+    oc->output_ts_offset = -av_rescale_q(pkt->pts, video_tb, AV_TIME_BASE_Q);
+    oc->avoid_negative_ts = AVFMT_AVOID_NEG_TS_MAKE_NON_NEGATIVE;
+
+    ret = open_output(ctx);
+    if (ret < 0)
+        return ret;
+    /* the muxer may have picked a different stream timebase */
+    av_packet_rescale_ts(pkt, video_tb, ctx->video_st.st->time_base);
+    ctx->segment_start = pkt->pts;
+    return 0;
+}
+
+static int write_frame(StreamContext *ctx, const AVRational *time_base, OutputStream *ost, AVPacket *pkt)
+{
+    AVStream *st;
+    int ret;
+
+    /* Audio and video are encoded on different threads, only the muxer
+     * itself is shared between them. Streams get replaced when a new
+     * segment starts, so they are only looked at under the lock. */
+    SDL_mutexP(ctx->mux_lock);
+    st = ost->st;
+
     /* rescale output packet timestamp values from codec to stream timebase */
     av_packet_rescale_ts(pkt, *time_base, st->time_base);
+
+    if (ctx->segmenting && ost == &ctx->video_st && (pkt->flags & AV_PKT_FLAG_KEY) &&
+        segment_full(ctx, pkt)) {
+        ret = next_segment(ctx, pkt);
+        if (ret < 0) {
+            SDL_mutexV(ctx->mux_lock);
+            return ret;
+        }
+        st = ost->st;
+    }
     pkt->stream_index = st->index;
 
     /* Write the compressed frame to the media file. */
-    //log_packet(fmt_ctx, pkt);
-    return av_interleaved_write_frame(fmt_ctx, pkt);
+    //log_packet(ctx->oc, pkt);
+    ret = av_interleaved_write_frame(ctx->oc, pkt);
+    SDL_mutexV(ctx->mux_lock);
+    return ret;
 }
 
 /* Add an output stream. */
@@ -115,7 +298,7 @@ static int add_stream(OutputStream *ost, AVFormatContext *oc,
     case AVMEDIA_TYPE_AUDIO:
         c->sample_fmt  = (*codec)->sample_fmts ?
             (*codec)->sample_fmts[0] : AV_SAMPLE_FMT_S16;
-        c->bit_rate    = 64000;
+        c->bit_rate    = ctx->settings.audio_bitrate;
         c->sample_rate = 44100;
         if ((*codec)->supported_samplerates) {
             c->sample_rate = (*codec)->supported_samplerates[0];
@@ -139,10 +322,11 @@ static int add_stream(OutputStream *ost, AVFormatContext *oc,
     case AVMEDIA_TYPE_VIDEO:
         c->codec_id = codec_id;
 
-        c->bit_rate = 750000;
+        c->bit_rate = level_video_bitrate(ctx, ctx->level);
         /* Resolution must be a multiple of two. */
-        c->width    = ctx->width;
-        c->height   = ctx->height;
+        c->width    = (ctx->width * ctx->settings.scale + 1) & ~1;
+        c->height   = (ctx->height * ctx->settings.scale + 1) & ~1;
+        c->thread_count = ctx->settings.threads;
         /* timebase: This is the fundamental unit of time (in seconds) in terms
          * of which frame timestamps are represented. For fixed-fps content,
          * timebase should be 1/framerate and timestamp increments should be
@@ -150,7 +334,8 @@ static int add_stream(OutputStream *ost, AVFormatContext *oc,
         ost->st->time_base = (AVRational){ 1, ctx->fps };
         c->time_base       = ost->st->time_base;
 
-        c->gop_size      = 12; /* emit one intra frame every twelve frames at most */
+        /* emit one intra frame every two seconds unless told otherwise */
+        c->gop_size      = ctx->settings.gop ? ctx->settings.gop : 2 * ctx->fps;
         c->pix_fmt       = AV_PIX_FMT_YUV420P;
         if (c->codec_id == AV_CODEC_ID_MPEG2VIDEO) {
             /* just for testing, we also add B-frames */
@@ -283,7 +468,7 @@ static AVFrame *get_audio_frame(OutputStream *ost, int* nb_samples)
  * encode one audio frame and send it to the muxer
  * return 1 when encoding is finished, 0 otherwise, <0 on error
  */
-static int write_audio_frame(AVFormatContext *oc, OutputStream *ost, int nb_samples)
+static int write_audio_frame(StreamContext *ctx, OutputStream *ost, int nb_samples)
 {
     AVCodecContext *c;
     AVFrame *frame;
@@ -339,7 +524,7 @@ static int write_audio_frame(AVFormatContext *oc, OutputStream *ost, int nb_samp
             return -1;
         }
         got_packet |= 1;
-        ret = write_frame(oc, &c->time_base, ost->st, ost->pkt);
+        ret = write_frame(ctx, &c->time_base, ost, ost->pkt);
         av_packet_unref(ost->pkt);
         if (ret < 0) {
             LOG_MSG("Error while writing audio frame: %s\n", av_err2str(ret));
@@ -377,15 +562,35 @@ static AVFrame *alloc_picture(enum AVPixelFormat pix_fmt, int width, int height)
     return picture;
 }
 
-static int open_video(AVFormatContext *oc, AVCodec *codec, OutputStream *ost, AVDictionary *opt_arg)
+static int open_video(StreamContext *ctx, AVCodec *codec, OutputStream *ost, AVDictionary *opt_arg)
 {
     int ret;
+    int i;
     AVCodecContext *c = ost->enc;
     AVDictionary *opt = NULL;
+    const StreamSettings *settings = &ctx->settings;
+    const char *preset = settings->preset;
 
     av_dict_copy(&opt, opt_arg, 0);
 
-    av_opt_set(c->priv_data, "preset", "slow", 0);
+    /* The preset can only change when the encoder is opened, so a stream
+     * that had to lower its quality before restarts with a faster one */
+    for (i = 0; x264_presets[i]; i++) {
+        if (!strcmp(x264_presets[i], settings->preset)) {
+            preset = x264_presets[max(i - ctx->level, 0)];
+            break;
+        }
+    }
+    av_opt_set(c->priv_data, "preset", preset, 0);
+    if (settings->tune[0])
+        av_opt_set(c->priv_data, "tune", settings->tune, 0);
+    if (settings->crf) {
+        /* constant quality, capped at the configured bitrate */
+        av_opt_set_double(c->priv_data, "crf", level_crf(ctx, ctx->level), 0);
+        c->bit_rate = 0;
+        c->rc_max_rate = level_video_bitrate(ctx, ctx->level);
+        c->rc_buffer_size = 2 * settings->video_bitrate;
+    }
 
     /* open the codec */
     ret = avcodec_open2(c, codec, &opt);
@@ -402,12 +607,8 @@ static int open_video(AVFormatContext *oc, AVCodec *codec, OutputStream *ost, AV
         return -1;
     }
 
+    /* frames are converted straight from the queued capture buffer */
     ost->tmp_frame = NULL;
-    ost->tmp_frame = alloc_picture(AV_PIX_FMT_RGB24, c->width, c->height);
-    if (!ost->tmp_frame) {
-        LOG_MSG("Could not allocate temporary picture\n");
-        return -1;
-    }
 
     /* copy the stream parameters to the muxer */
     ret = avcodec_parameters_from_context(ost->st->codecpar, c);
@@ -419,34 +620,56 @@ static int open_video(AVFormatContext *oc, AVCodec *codec, OutputStream *ost, AV
     return 0;
 }
 
-static AVFrame *get_video_frame(OutputStream *ost)
+/* the capture formats, 15 and 16 bpp are native endian words,
+ * 32 bpp is a native endian 0x00RRGGBB dword */
+static enum AVPixelFormat source_pix_fmt(int bpp)
+{
+    switch (bpp) {
+    case 8:  return AV_PIX_FMT_PAL8;
+    case 15: return AV_PIX_FMT_RGB555;
+    case 16: return AV_PIX_FMT_RGB565;
+    case 32: return AV_PIX_FMT_0RGB32;
+    default: return AV_PIX_FMT_NONE;
+    }
+}
+
+static AVFrame *get_video_frame(StreamContext *ctx, OutputStream *ost, const uint8_t *data,
+                                int pitch, const Bit32u *pal, int64_t pts)
 {
     AVCodecContext *c = ost->enc;
+    const uint8_t *src[2];
+    int src_stride[2];
 
     /* when we pass a frame to the encoder, it may keep a reference to it
      * internally; make sure we do not overwrite it here */
     if (av_frame_make_writable(ost->frame) < 0)
         return NULL;
 
-    /* as we only always get an RGB24 picture, we must convert it
-     * to the codec pixel format if needed */
+    /* frames arrive in the native capture format and size, swscale
+     * converts them and takes care of any line or column doubling */
     if (!ost->sws_ctx) {
-        ost->sws_ctx = sws_getContext(c->width, c->height,
-                                        AV_PIX_FMT_RGB24,
+        int scaled = ctx->src_width != c->width || ctx->src_height != c->height;
+        ost->sws_ctx = sws_getContext(ctx->src_width, ctx->src_height,
+                                        source_pix_fmt(ctx->src_bpp),
                                         c->width, c->height,
                                         c->pix_fmt,
-                                        SCALE_FLAGS, NULL, NULL, NULL);
+                                        scaled ? SWS_POINT : SCALE_FLAGS,
+                                        NULL, NULL, NULL);
         if (!ost->sws_ctx) {
             LOG_MSG(
                     "Could not initialize the conversion context\n");
             return NULL;
         }
     }
-    sws_scale(ost->sws_ctx, (const uint8_t * const *) ost->tmp_frame->data,
-                ost->tmp_frame->linesize, 0, c->height, ost->frame->data,
-                ost->frame->linesize);
+    src[0] = data;
+    src[1] = (const uint8_t *)pal;
+    src_stride[0] = pitch;
+    src_stride[1] = 0;
+    sws_scale(ost->sws_ctx, src, src_stride, 0, ctx->src_height,
+                ost->frame->data, ost->frame->linesize);
 
-    ost->frame->pts = ost->next_pts++;
+    ost->frame->pts = pts;
+    ost->next_pts = pts + 1;
 
     return ost->frame;
 }
@@ -455,7 +678,8 @@ static AVFrame *get_video_frame(OutputStream *ost)
  * encode one video frame and send it to the muxer
  * return 1 when encoding is finished, 0 otherwise, <0 on error
  */
-static int write_video_frame(AVFormatContext *oc, OutputStream *ost)
+static int write_video_frame(StreamContext *ctx, OutputStream *ost,
+                             const uint8_t *data, int pitch, const Bit32u *pal, int64_t pts)
 {
     int ret;
     AVCodecContext *c;
@@ -464,7 +688,9 @@ static int write_video_frame(AVFormatContext *oc, OutputStream *ost)
 
     c = ost->enc;
 
-    frame = get_video_frame(ost);
+    frame = get_video_frame(ctx, ost, data, pitch, pal, pts);
+    if (!frame)
+        return -1;
 
     /* encode the image */
     ret = avcodec_send_frame(ost->enc, frame);
@@ -482,7 +708,7 @@ static int write_video_frame(AVFormatContext *oc, OutputStream *ost)
             return -1;
         }
         got_packet |= 1;
-        ret = write_frame(oc, &c->time_base, ost->st, ost->pkt);
+        ret = write_frame(ctx, &c->time_base, ost, ost->pkt);
         av_packet_unref(ost->pkt);
         if (ret < 0) {
             LOG_MSG("Error while writing video frame: %s\n", av_err2str(ret));
@@ -507,6 +733,29 @@ static void close_stream(AVFormatContext *oc, OutputStream *ost)
     ost->swr_ctx = NULL;
 }
 
+static enum AVCodecID pick_codec(AVOutputFormat *fmt, enum AVCodecID wanted, enum AVCodecID fallback)
+{
+    if (avformat_query_codec(fmt, wanted, FF_COMPLIANCE_NORMAL) == 1 &&
+        avcodec_find_encoder(wanted))
+        return wanted;
+    return fallback;
+}
+
+static void free_context(StreamContext* ctx)
+{
+    close_stream(ctx->oc, &ctx->video_st);
+    close_stream(ctx->oc, &ctx->audio_st);
+    if (ctx->oc) {
+        if (ctx->oc->pb && !(ctx->oc->oformat->flags & AVFMT_NOFILE))
+            avio_closep(&ctx->oc->pb);
+        avformat_free_context(ctx->oc);
+        ctx->oc = NULL;
+    }
+    if (ctx->mux_lock)
+        SDL_DestroyMutex(ctx->mux_lock);
+    ctx->mux_lock = NULL;
+}
+
 /**************************************************************/
 int streaming_init(const char *streamname, StreamContext* ctx)
 {
@@ -516,44 +765,47 @@ int streaming_init(const char *streamname, StreamContext* ctx)
     ctx->frames = 0;
     ctx->bufferedAudio = 0;
 
-    avformat_alloc_output_context2(&ctx->oc, NULL, "flv", streamname);
+    ctx->mux_lock = SDL_CreateMutex();
+    if (!ctx->mux_lock)
+        return 1;
+
+    snprintf(ctx->target, sizeof(ctx->target), "%s", streamname);
+    ctx->segmenting = (ctx->settings.segment_time || ctx->settings.segment_size) &&
+                      is_file_target(streamname);
+    ctx->segment_index = 0;
+    ctx->segment_start = 0;
 
-    if (!ctx->oc)
+    avformat_alloc_output_context2(&ctx->oc, NULL,
+                                   output_format_name(streamname, ctx->settings.format),
+                                   streamname);
+
+    if (!ctx->oc) {
+        SDL_DestroyMutex(ctx->mux_lock);
+        ctx->mux_lock = NULL;
         return 1;
+    }
 
     fmt = ctx->oc->oformat;
 
-    /* Add the audio and video streams using the default format codecs
-     * and initialize the codecs. */
+    /* Add the audio and video streams, H.264 and AAC where the format
+     * and the libraries allow it, the default format codecs otherwise */
     if (fmt->video_codec != AV_CODEC_ID_NONE) {
-        add_stream(&ctx->video_st, ctx->oc, &ctx->video_codec, fmt->video_codec, ctx);
+        add_stream(&ctx->video_st, ctx->oc, &ctx->video_codec,
+                   pick_codec(fmt, AV_CODEC_ID_H264, fmt->video_codec), ctx);
     }
     if (fmt->audio_codec != AV_CODEC_ID_NONE) {
-        add_stream(&ctx->audio_st, ctx->oc, &ctx->audio_codec, fmt->audio_codec, ctx);
+        add_stream(&ctx->audio_st, ctx->oc, &ctx->audio_codec,
+                   pick_codec(fmt, AV_CODEC_ID_AAC, fmt->audio_codec), ctx);
     }
 
     /* Now that all the parameters are set, we can open the audio and
      * video codecs and allocate the necessary encode buffers. */
-    open_video(ctx->oc, ctx->video_codec, &ctx->video_st, NULL);
+    open_video(ctx, ctx->video_codec, &ctx->video_st, NULL);
     open_audio(ctx->oc, ctx->audio_codec, &ctx->audio_st, NULL);
 
-    av_dump_format(ctx->oc, 0, streamname, 1);
-
-    /* open the output file, if needed */
-    if (!(fmt->flags & AVFMT_NOFILE)) {
-        ret = avio_open(&ctx->oc->pb, streamname, AVIO_FLAG_WRITE);
-        if (ret < 0) {
-            LOG_MSG("Could not open '%s': %s\n", streamname,
-                    av_err2str(ret));
-            return 1;
-        }
-    }
-
-    /* Write the stream header, if any. */
-    ret = avformat_write_header(ctx->oc, NULL);
+    ret = open_output(ctx);
     if (ret < 0) {
-        LOG_MSG("Error occurred when opening output file: %s\n",
-                av_err2str(ret));
+        free_context(ctx);
         return 1;
     }
 
@@ -566,54 +818,66 @@ int streaming_cleanup(StreamContext* ctx)
      * close the CodecContexts open when you wrote the header; otherwise
      * av_write_trailer() may try to use memory that was freed on
      * av_codec_close(). */
-    av_write_trailer(ctx->oc);
+    if (ctx->oc)
+        av_write_trailer(ctx->oc);
 
-    /* Close each codec. */
-    close_stream(ctx->oc, &ctx->video_st);
-    close_stream(ctx->oc, &ctx->audio_st);
-
-    /* free the stream */
-    avformat_free_context(ctx->oc);
-
-    ctx->oc = NULL;
+    /* Close each codec and the output, then free the stream */
+    free_context(ctx);
 
     return 0;
 }
 
-int streaming_video_line(StreamContext* ctx, int y, Bit8u *data)
+/* Lower the video quality by level steps below the configured settings.
+ * The bitrate and crf are picked up by the encoder on the next frame. */
+int streaming_set_level(StreamContext* ctx, int level)
 {
-    AVFrame* pict = ctx->video_st.tmp_frame;
-    memcpy(&pict->data[0][y * pict->linesize[0]], data, pict->width * 3);
-
-    return 0;
+    AVCodecContext *c = ctx->video_st.enc;
+    int bitrate;
+
+    if (level < 0)
+        level = 0;
+    if (level > STREAM_MAX_LEVEL)
+        level = STREAM_MAX_LEVEL;
+    if (!c || level == ctx->level)
+        return ctx->level;
+    ctx->level = level;
+
+    bitrate = level_video_bitrate(ctx, level);
+    if (ctx->settings.crf) {
+        c->rc_max_rate = bitrate;
+        av_opt_set_double(c->priv_data, "crf", level_crf(ctx, level), 0);
+    } else {
+        c->bit_rate = bitrate;
+    }
+    LOG_MSG("Stream quality level %d, video bitrate %d kbit/s\n", level, bitrate / 1000);
+    return level;
 }
 
-int streaming_video(StreamContext* ctx)
+int streaming_video_frame(StreamContext* ctx, const Bit8u *data, int pitch, const Bit32u *pal, int64_t pts)
 {
-    return write_video_frame(ctx->oc, &ctx->video_st);
+    return write_video_frame(ctx, &ctx->video_st, data, pitch, pal, pts);
 }
 
 int streaming_audio(StreamContext* ctx, Bit32u len, Bit16s *data)
 {
     int ret = 0;
-    len *= 4; // convert to bytes
     AVFrame *frame = ctx->audio_st.tmp_frame;
-    if (frame != NULL) {
-        int frameByfferSize = frame->nb_samples * 4; // convert to bytes
-        int copyBytes = min(len, frameByfferSize - ctx->bufferedAudio);
-        //LOG_MSG("buffering %u audio bytes\n", copyBytes);
-        memcpy(&frame->data[0][ctx->bufferedAudio], data, copyBytes);
-        ctx->bufferedAudio += copyBytes;
-
-        {
-            //LOG_MSG("using %u audio bytes\n", ctx->bufferedAudio);
-            ret = write_audio_frame(ctx->oc, &ctx->audio_st, ctx->bufferedAudio / 4);
-
+    if (frame == NULL)
+        return 0;
+
+    /* collect whole encoder frames, bufferedAudio counts stereo samples */
+    while (len > 0) {
+        int copy = min((int)len, frame->nb_samples - ctx->bufferedAudio);
+        memcpy(&frame->data[0][ctx->bufferedAudio * 4], data, copy * 4);
+        ctx->bufferedAudio += copy;
+        data += copy * 2;
+        len -= copy;
+
+        if (ctx->bufferedAudio == frame->nb_samples) {
+            ret = write_audio_frame(ctx, &ctx->audio_st, ctx->bufferedAudio);
             ctx->bufferedAudio = 0;
-            if (copyBytes < len) {
-                //LOG_MSG("buffering %u left-over audio bytes\n", len - copyBytes);
-                memcpy(&frame->data[0][ctx->bufferedAudio], &data[copyBytes], len - copyBytes);
-            }
+            if (ret < 0)
+                break;
         }
     }
 
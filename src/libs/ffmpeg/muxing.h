@@ -9,6 +9,9 @@
 #include <libswscale/swscale.h>
 #include <libswresample/swresample.h>
 
+#include "SDL.h"
+#include "stream_settings.h"
+
 // a wrapper around a single output AVStream
 typedef struct OutputStream {
     AVStream *st;
@@ -36,8 +39,22 @@ typedef struct StreamContext {
 	int	width;
     int height;
 	int fps;
+    /* size and bpp of the frames handed to streaming_video_frame */
+    int src_width;
+    int src_height;
+    int src_bpp;
     int bufferedAudio;
     Bitu frames;
+    /* serializes packet writes from the audio and video encoders */
+    SDL_mutex *mux_lock;
+    StreamSettings settings;
+    /* output name, for segmented outputs the name segments are made from */
+    char target[1024];
+    int segmenting;
+    int segment_index;
+    int64_t segment_start;
+    /* quality steps below the configured settings, see streaming_set_level */
+    int level;
 } StreamContext;
 
 #ifdef __cplusplus
@@ -45,9 +62,9 @@ extern "C"
 {
 #endif
 
-int streaming_video_line(StreamContext* ctx, int y, Bit8u *data);
-int streaming_video(StreamContext* ctx);
+int streaming_video_frame(StreamContext* ctx, const Bit8u *data, int pitch, const Bit32u *pal, int64_t pts);
 int streaming_audio(StreamContext* ctx, Bit32u len, Bit16s *data);
+int streaming_set_level(StreamContext* ctx, int level);
 
 int streaming_init(const char *streamname, StreamContext* ctx);
 int streaming_cleanup(StreamContext* ctx);
@@ -0,0 +1,108 @@
+/*
+ *  Copyright (C) 2002-2019  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_STREAM_SETTINGS_H
+#define DOSBOX_STREAM_SETTINGS_H
+
+/* How many steps the adaptive mode may lower the encoder quality */
+#define STREAM_MAX_LEVEL 4
+
+/* Encoder setup, shared between the capture code and the C muxer */
+typedef struct StreamSettings {
+	char	preset[16];			/* x264 preset, ultrafast .. veryslow */
+	char	tune[16];			/* x264 tune, empty for none */
+	int		crf;				/* constant quality, 0 to use the bitrate */
+	int		video_bitrate;		/* bits per second, the cap when crf is used */
+	int		audio_bitrate;		/* bits per second */
+	int		gop;				/* frames between keyframes, 0 for two seconds */
+	int		threads;			/* encoder threads, 0 for automatic */
+	int		scale;				/* integer scale of the output size */
+	int		adaptive;			/* lower quality when the encoder falls behind */
+	char	format[16];			/* container, empty to pick one from the target */
+	int		segment_time;		/* seconds per file segment, 0 for no limit */
+	int		segment_size;		/* megabytes per file segment, 0 for no limit */
+} StreamSettings;
+
+#ifdef __cplusplus
+/* The stream_* settings of the [dosbox] section. dosbox.cpp adds them from
+ * this table and so does the capture benchmark, so the defaults only live here. */
+enum StreamSettingType {
+	STREAM_SETTING_STRING,
+	STREAM_SETTING_INT,
+	STREAM_SETTING_BOOL
+};
+
+struct StreamSettingDefault {
+	const char *			name;
+	StreamSettingType		type;
+	const char *			text;		/* default of a string */
+	int						value;		/* default of an int or a bool */
+	int						min,max;	/* range of an int */
+	const char * const *	values;		/* allowed strings, 0 for any */
+	const char *			help;
+};
+
+static const char * const stream_formats[] = { "auto", "flv", "mpegts", "matroska", "mp4", "nut", 0 };
+static const char * const stream_drops[] = { "oldest", "newest", 0 };
+static const char * const stream_presets[] = { "ultrafast", "superfast", "veryfast", "faster", "fast",
+	"medium", "slow", "slower", "veryslow", 0 };
+static const char * const stream_tunes[] = { "none", "animation", "film", "grain", "stillimage", "zerolatency", 0 };
+
+static const StreamSettingDefault stream_setting_defaults[] = {
+	{ "stream_output", STREAM_SETTING_STRING, "", 0, 0, 0, 0,
+		"Where to send the stream instead of YouTube. This can be a file name,\n"
+		"a named pipe, pipe:1 for standard output or a url such as udp://127.0.0.1:1234.\n"
+		"Empty streams to youtube_url/youtube_key." },
+	{ "stream_format", STREAM_SETTING_STRING, "auto", 0, 0, 0, stream_formats,
+		"Container of the stream. auto uses flv for rtmp, mpegts for network\n"
+		"and pipe outputs and the file extension otherwise. mp4 is written fragmented." },
+	{ "stream_segment_time", STREAM_SETTING_INT, 0, 0, 0, 86400, 0,
+		"Start a new file after this many seconds when streaming to a file. 0 disables." },
+	{ "stream_segment_size", STREAM_SETTING_INT, 0, 0, 0, 1000000, 0,
+		"Start a new file after this many megabytes when streaming to a file. 0 disables.\n"
+		"Segments are named after stream_output with _000, _001, ... added." },
+	{ "stream_queue", STREAM_SETTING_INT, 0, 8, 1, 120, 0,
+		"How many frames the stream encoder thread may fall behind before frames get dropped." },
+	{ "stream_drop", STREAM_SETTING_STRING, "oldest", 0, 0, 0, stream_drops,
+		"Which frame to drop when the stream encoder queue is full.\n"
+		"  oldest: replace the oldest queued frame, the stream stays current.\n"
+		"  newest: skip the new frame, queued frames are all encoded." },
+	{ "stream_preset", STREAM_SETTING_STRING, "veryfast", 0, 0, 0, stream_presets,
+		"x264 preset of the stream. Slower presets compress better but cost a lot more CPU." },
+	{ "stream_tune", STREAM_SETTING_STRING, "animation", 0, 0, 0, stream_tunes,
+		"x264 tuning of the stream." },
+	{ "stream_crf", STREAM_SETTING_INT, 0, 0, 0, 51, 0,
+		"Constant quality of the stream, lower is better. 0 encodes at stream_vbitrate,\n"
+		"otherwise stream_vbitrate is the maximum bitrate." },
+	{ "stream_vbitrate", STREAM_SETTING_INT, 0, 750, 100, 50000, 0,
+		"Video bitrate of the stream in kbit/s." },
+	{ "stream_abitrate", STREAM_SETTING_INT, 0, 64, 16, 320, 0,
+		"Audio bitrate of the stream in kbit/s." },
+	{ "stream_gop", STREAM_SETTING_INT, 0, 0, 0, 1000, 0,
+		"Frames between keyframes of the stream, 0 for one every two seconds." },
+	{ "stream_threads", STREAM_SETTING_INT, 0, 0, 0, 64, 0,
+		"Threads the video encoder may use, 0 lets the encoder decide." },
+	{ "stream_scale", STREAM_SETTING_INT, 0, 1, 1, 4, 0,
+		"Scale the stream to a multiple of the emulated resolution." },
+	{ "stream_adaptive", STREAM_SETTING_BOOL, 0, 1, 0, 0, 0,
+		"Lower the stream bitrate when the encoder falls behind and raise it again when\n"
+		"it catches up. After a mode switch the stream restarts with a faster preset." }
+};
+#endif
+
+#endif
@@ -87,6 +87,7 @@ bool VideoCodec::SetupBuffers(zmbv_format_t _format, int blockwidth, int blockhe
 	buf1 = new unsigned char[bufsize];
 	buf2 = new unsigned char[bufsize];
 	work = new unsigned char[bufsize];
+	lineChanged = new unsigned char[height];
 
 	int xblocks = (width/blockwidth);
 	int xleft = width % blockwidth;
@@ -97,7 +98,7 @@ bool VideoCodec::SetupBuffers(zmbv_format_t _format, int blockwidth, int blockhe
 	blockcount=yblocks*xblocks;
 	blocks=new FrameBlock[blockcount];
 
-	if (!buf1 || !buf2 || !work || !blocks) {
+	if (!buf1 || !buf2 || !work || !lineChanged || !blocks) {
 		FreeBuffers();
 		return false;
 	}
@@ -121,9 +122,28 @@ bool VideoCodec::SetupBuffers(zmbv_format_t _format, int blockwidth, int blockhe
 		}
 	}
 
+	/* Split the block rows into bands for the delta search, the first band
+	 * writes straight into the work buffer and the others get their own */
+	bandCount = threadCount;
+	if (bandCount > yblocks) bandCount = yblocks;
+	if (bandCount < 1) bandCount = 1;
+	for (i=0;i<bandCount;i++) {
+		bands[i].firstBlock = (yblocks*i/bandCount)*xblocks;
+		bands[i].lastBlock = (yblocks*(i+1)/bandCount)*xblocks;
+		bands[i].buf = 0;
+		bands[i].used = 0;
+		if (i) {
+			int size = 0;
+			for (int b=bands[i].firstBlock;b<bands[i].lastBlock;b++)
+				size += blocks[b].dx*blocks[b].dy*pixelsize;
+			bands[i].buf = new unsigned char[size];
+		}
+	}
+
 	memset(buf1,0,bufsize);
 	memset(buf2,0,bufsize);
 	memset(work,0,bufsize);
+	memset(lineChanged,1,height);
 	oldframe=buf1;
 	newframe=buf2;
 	format = _format;
@@ -146,11 +166,530 @@ void VideoCodec::CreateVectorTable(void) {
 	}
 }
 
+/* Block kernels
+ * The motion search spends nearly all its time comparing and xoring the full
+ * 16 pixel wide blocks, those go through a kernel set picked at runtime.
+ * Every set has to give exactly the results of the C versions: count the
+ * pixels that differ, at 32bpp only in the low 24 bits. */
+
+#if defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9) || defined(__clang__))
+#define ZMBV_GNUC_TARGETS 1
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ZMBV_SSE2 1
+#define ZMBV_SSE2_ALWAYS 1
+#elif defined(ZMBV_GNUC_TARGETS) || (defined(_MSC_VER) && _MSC_VER >= 1400)
+#define ZMBV_SSE2 1
+#endif
+#if defined(ZMBV_GNUC_TARGETS) || (defined(_MSC_VER) && _MSC_VER >= 1800)
+#define ZMBV_AVX2 1
+#endif
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ZMBV_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(ZMBV_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(ZMBV_AVX2)
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER) && (defined(ZMBV_SSE2) || defined(ZMBV_AVX2))
+#include <intrin.h>
+#endif
+
+#if defined(ZMBV_GNUC_TARGETS) && !defined(ZMBV_SSE2_ALWAYS)
+#define ZMBV_TARGET_SSE2 __attribute__((target("sse2")))
+#else
+#define ZMBV_TARGET_SSE2
+#endif
+#if defined(ZMBV_GNUC_TARGETS)
+#define ZMBV_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define ZMBV_TARGET_AVX2
+#endif
+
+#define ZMBV_BLOCK 16
+
+/* Scalar versions, these define the results */
+template<class P>
+static int ZMBV_CompareC(const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	int ret=0;
+	for (int y=0;y<rows;y++) {
+		const P * pold=(const P *)old;
+		const P * pnew=(const P *)cur;
+		for (int x=0;x<ZMBV_BLOCK;x++) {
+			int test=0-((pold[x]-pnew[x])&0x00ffffff);
+			ret-=(test>>31);
+		}
+		old+=pitch;
+		cur+=pitch;
+	}
+	return ret;
+}
+
+template<class P>
+static int ZMBV_PossibleC(const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	int ret=0;
+	for (int y=0;y<rows;y+=4) {
+		const P * pold=(const P *)old;
+		const P * pnew=(const P *)cur;
+		for (int x=0;x<ZMBV_BLOCK;x+=4) {
+			int test=0-((pold[x]-pnew[x])&0x00ffffff);
+			ret-=(test>>31);
+		}
+		old+=pitch*4;
+		cur+=pitch*4;
+	}
+	return ret;
+}
+
+template<class P>
+static void ZMBV_XorC(unsigned char * dest, const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	P * pdest=(P *)dest;
+	for (int y=0;y<rows;y++) {
+		const P * pold=(const P *)old;
+		const P * pnew=(const P *)cur;
+		for (int x=0;x<ZMBV_BLOCK;x++)
+			*pdest++=pnew[x] ^ pold[x];
+		old+=pitch;
+		cur+=pitch;
+	}
+}
+
+static const ZMBV_Kernels zmbv_kernels_c = {
+	"C",
+	{ ZMBV_CompareC<char>, ZMBV_CompareC<short>, ZMBV_CompareC<int> },
+	{ ZMBV_PossibleC<char>, ZMBV_PossibleC<short>, ZMBV_PossibleC<int> },
+	{ ZMBV_XorC<char>, ZMBV_XorC<short>, ZMBV_XorC<int> }
+};
+
+/* Pixels sampled by the possible test: 0, 4, 8 and 12 of the row */
+static INLINE int ZMBV_SampleMisses(unsigned int equal, unsigned int sample) {
+	unsigned int miss = ~equal & sample;
+	int ret = 0;
+	while (miss) {
+		miss &= miss - 1;
+		ret++;
+	}
+	return ret;
+}
+
+#if defined(ZMBV_SSE2)
+static INLINE ZMBV_TARGET_SSE2 int ZMBV_SumSSE2_16(__m128i acc) {
+	acc = _mm_madd_epi16(acc, _mm_set1_epi16(1));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4e));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xb1));
+	return _mm_cvtsi128_si32(acc);
+}
+
+static INLINE ZMBV_TARGET_SSE2 int ZMBV_SumSSE2_32(__m128i acc) {
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4e));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xb1));
+	return _mm_cvtsi128_si32(acc);
+}
+
+/* The equal lanes are counted by subtracting the all ones compare results */
+static ZMBV_TARGET_SSE2 int ZMBV_CompareSSE2_8(const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	__m128i acc = _mm_setzero_si128();
+	for (int y=0;y<rows;y++) {
+		__m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)old), _mm_loadu_si128((const __m128i *)cur));
+		acc = _mm_sub_epi8(acc, eq);
+		old+=pitch;
+		cur+=pitch;
+	}
+	acc = _mm_sad_epu8(acc, _mm_setzero_si128());
+	int equal = _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+	return rows*ZMBV_BLOCK - equal;
+}
+
+static ZMBV_TARGET_SSE2 int ZMBV_CompareSSE2_16(const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	__m128i acc = _mm_setzero_si128();
+	for (int y=0;y<rows;y++) {
+		for (int i=0;i<2;i++) {
+			__m128i eq = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)old+i), _mm_loadu_si128((const __m128i *)cur+i));
+			acc = _mm_sub_epi16(acc, eq);
+		}
+		old+=pitch;
+		cur+=pitch;
+	}
+	return rows*ZMBV_BLOCK - ZMBV_SumSSE2_16(acc);
+}
+
+static ZMBV_TARGET_SSE2 int ZMBV_CompareSSE2_32(const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	const __m128i mask = _mm_set1_epi32(0x00ffffff);
+	__m128i acc = _mm_setzero_si128();
+	for (int y=0;y<rows;y++) {
+		for (int i=0;i<4;i++) {
+			__m128i diff = _mm_xor_si128(_mm_loadu_si128((const __m128i *)old+i), _mm_loadu_si128((const __m128i *)cur+i));
+			acc = _mm_sub_epi32(acc, _mm_cmpeq_epi32(_mm_and_si128(diff, mask), _mm_setzero_si128()));
+		}
+		old+=pitch;
+		cur+=pitch;
+	}
+	return rows*ZMBV_BLOCK - ZMBV_SumSSE2_32(acc);
+}
+
+static ZMBV_TARGET_SSE2 int ZMBV_PossibleSSE2_8(const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	int ret=0;
+	for (int y=0;y<rows;y+=4) {
+		__m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)old), _mm_loadu_si128((const __m128i *)cur));
+		ret += ZMBV_SampleMisses(_mm_movemask_epi8(eq), 0x1111);
+		old+=pitch*4;
+		cur+=pitch*4;
+	}
+	return ret;
+}
+
+static ZMBV_TARGET_SSE2 int ZMBV_PossibleSSE2_16(const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	int ret=0;
+	for (int y=0;y<rows;y+=4) {
+		__m128i eq0 = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)old), _mm_loadu_si128((const __m128i *)cur));
+		__m128i eq1 = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)old+1), _mm_loadu_si128((const __m128i *)cur+1));
+		unsigned int equal = _mm_movemask_epi8(eq0) | (_mm_movemask_epi8(eq1) << 16);
+		ret += ZMBV_SampleMisses(equal, 0x01010101);
+		old+=pitch*4;
+		cur+=pitch*4;
+	}
+	return ret;
+}
+
+static ZMBV_TARGET_SSE2 void ZMBV_XorSSE2_8(unsigned char * dest, const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	for (int y=0;y<rows;y++) {
+		_mm_storeu_si128((__m128i *)dest, _mm_xor_si128(_mm_loadu_si128((const __m128i *)old), _mm_loadu_si128((const __m128i *)cur)));
+		dest+=ZMBV_BLOCK;
+		old+=pitch;
+		cur+=pitch;
+	}
+}
+
+static ZMBV_TARGET_SSE2 void ZMBV_XorSSE2_16(unsigned char * dest, const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	for (int y=0;y<rows;y++) {
+		for (int i=0;i<2;i++)
+			_mm_storeu_si128((__m128i *)dest+i, _mm_xor_si128(_mm_loadu_si128((const __m128i *)old+i), _mm_loadu_si128((const __m128i *)cur+i)));
+		dest+=ZMBV_BLOCK*2;
+		old+=pitch;
+		cur+=pitch;
+	}
+}
+
+static ZMBV_TARGET_SSE2 void ZMBV_XorSSE2_32(unsigned char * dest, const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	for (int y=0;y<rows;y++) {
+		for (int i=0;i<4;i++)
+			_mm_storeu_si128((__m128i *)dest+i, _mm_xor_si128(_mm_loadu_si128((const __m128i *)old+i), _mm_loadu_si128((const __m128i *)cur+i)));
+		dest+=ZMBV_BLOCK*4;
+		old+=pitch;
+		cur+=pitch;
+	}
+}
+
+/* The 32bpp possible test only reads 4 pixels a row, SSE2 doesn't win there */
+static const ZMBV_Kernels zmbv_kernels_sse2 = {
+	"SSE2",
+	{ ZMBV_CompareSSE2_8, ZMBV_CompareSSE2_16, ZMBV_CompareSSE2_32 },
+	{ ZMBV_PossibleSSE2_8, ZMBV_PossibleSSE2_16, ZMBV_PossibleC<int> },
+	{ ZMBV_XorSSE2_8, ZMBV_XorSSE2_16, ZMBV_XorSSE2_32 }
+};
+#endif
+
+#if defined(ZMBV_AVX2)
+static INLINE ZMBV_TARGET_AVX2 int ZMBV_SumAVX2_32(__m256i acc) {
+	__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+	return _mm_cvtsi128_si32(sum);
+}
+
+/* Two 16 byte rows in one register */
+static INLINE ZMBV_TARGET_AVX2 __m256i ZMBV_LoadRowsAVX2(const unsigned char * row, int pitch) {
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)row)),
+		_mm_loadu_si128((const __m128i *)(row + pitch)), 1);
+}
+
+static ZMBV_TARGET_AVX2 int ZMBV_CompareAVX2_8(const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	__m256i acc = _mm256_setzero_si256();
+	int y;
+	for (y=0;y+1<rows;y+=2) {
+		__m256i eq = _mm256_cmpeq_epi8(ZMBV_LoadRowsAVX2(old, pitch), ZMBV_LoadRowsAVX2(cur, pitch));
+		acc = _mm256_sub_epi8(acc, eq);
+		old+=pitch*2;
+		cur+=pitch*2;
+	}
+	acc = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+	int equal = ZMBV_SumAVX2_32(acc);
+	if (y < rows)
+		return rows*ZMBV_BLOCK - equal - (ZMBV_BLOCK - ZMBV_CompareSSE2_8(old, cur, pitch, 1));
+	return rows*ZMBV_BLOCK - equal;
+}
+
+static ZMBV_TARGET_AVX2 int ZMBV_CompareAVX2_16(const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	__m256i acc = _mm256_setzero_si256();
+	for (int y=0;y<rows;y++) {
+		__m256i eq = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)old), _mm256_loadu_si256((const __m256i *)cur));
+		acc = _mm256_sub_epi16(acc, eq);
+		old+=pitch;
+		cur+=pitch;
+	}
+	acc = _mm256_madd_epi16(acc, _mm256_set1_epi16(1));
+	return rows*ZMBV_BLOCK - ZMBV_SumAVX2_32(acc);
+}
+
+static ZMBV_TARGET_AVX2 int ZMBV_CompareAVX2_32(const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	const __m256i mask = _mm256_set1_epi32(0x00ffffff);
+	__m256i acc = _mm256_setzero_si256();
+	for (int y=0;y<rows;y++) {
+		for (int i=0;i<2;i++) {
+			__m256i diff = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)old+i), _mm256_loadu_si256((const __m256i *)cur+i));
+			acc = _mm256_sub_epi32(acc, _mm256_cmpeq_epi32(_mm256_and_si256(diff, mask), _mm256_setzero_si256()));
+		}
+		old+=pitch;
+		cur+=pitch;
+	}
+	return rows*ZMBV_BLOCK - ZMBV_SumAVX2_32(acc);
+}
+
+static ZMBV_TARGET_AVX2 int ZMBV_PossibleAVX2_16(const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	int ret=0;
+	for (int y=0;y<rows;y+=4) {
+		__m256i eq = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)old), _mm256_loadu_si256((const __m256i *)cur));
+		ret += ZMBV_SampleMisses(_mm256_movemask_epi8(eq), 0x01010101);
+		old+=pitch*4;
+		cur+=pitch*4;
+	}
+	return ret;
+}
+
+static ZMBV_TARGET_AVX2 void ZMBV_XorAVX2_16(unsigned char * dest, const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	for (int y=0;y<rows;y++) {
+		_mm256_storeu_si256((__m256i *)dest, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)old), _mm256_loadu_si256((const __m256i *)cur)));
+		dest+=ZMBV_BLOCK*2;
+		old+=pitch;
+		cur+=pitch;
+	}
+}
+
+static ZMBV_TARGET_AVX2 void ZMBV_XorAVX2_32(unsigned char * dest, const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	for (int y=0;y<rows;y++) {
+		for (int i=0;i<2;i++)
+			_mm256_storeu_si256((__m256i *)dest+i, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)old+i), _mm256_loadu_si256((const __m256i *)cur+i)));
+		dest+=ZMBV_BLOCK*4;
+		old+=pitch;
+		cur+=pitch;
+	}
+}
+
+/* A 8bpp row is only 16 bytes, the SSE2 versions are as good there */
+static const ZMBV_Kernels zmbv_kernels_avx2 = {
+	"AVX2",
+	{ ZMBV_CompareAVX2_8, ZMBV_CompareAVX2_16, ZMBV_CompareAVX2_32 },
+	{ ZMBV_PossibleSSE2_8, ZMBV_PossibleAVX2_16, ZMBV_PossibleC<int> },
+	{ ZMBV_XorSSE2_8, ZMBV_XorAVX2_16, ZMBV_XorAVX2_32 }
+};
+#endif
+
+#if defined(ZMBV_NEON)
+static INLINE int ZMBV_SumNEON_8(uint8x16_t acc) {
+	uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(acc)));
+	return (int)(vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1));
+}
+
+static INLINE int ZMBV_SumNEON_16(uint16x8_t acc) {
+	uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(acc));
+	return (int)(vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1));
+}
+
+static INLINE int ZMBV_SumNEON_32(uint32x4_t acc) {
+	uint64x2_t sum = vpaddlq_u32(acc);
+	return (int)(vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1));
+}
+
+static int ZMBV_CompareNEON_8(const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	uint8x16_t acc = vdupq_n_u8(0);
+	for (int y=0;y<rows;y++) {
+		acc = vsubq_u8(acc, vceqq_u8(vld1q_u8(old), vld1q_u8(cur)));
+		old+=pitch;
+		cur+=pitch;
+	}
+	return rows*ZMBV_BLOCK - ZMBV_SumNEON_8(acc);
+}
+
+static int ZMBV_CompareNEON_16(const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	uint16x8_t acc = vdupq_n_u16(0);
+	for (int y=0;y<rows;y++) {
+		for (int i=0;i<2;i++) {
+			uint16x8_t eq = vceqq_u16(vld1q_u16((const uint16_t *)old+i*8), vld1q_u16((const uint16_t *)cur+i*8));
+			acc = vsubq_u16(acc, eq);
+		}
+		old+=pitch;
+		cur+=pitch;
+	}
+	return rows*ZMBV_BLOCK - ZMBV_SumNEON_16(acc);
+}
+
+static int ZMBV_CompareNEON_32(const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	const uint32x4_t mask = vdupq_n_u32(0x00ffffff);
+	uint32x4_t acc = vdupq_n_u32(0);
+	for (int y=0;y<rows;y++) {
+		for (int i=0;i<4;i++) {
+			uint32x4_t diff = veorq_u32(vld1q_u32((const uint32_t *)old+i*4), vld1q_u32((const uint32_t *)cur+i*4));
+			acc = vsubq_u32(acc, vceqq_u32(vandq_u32(diff, mask), vdupq_n_u32(0)));
+		}
+		old+=pitch;
+		cur+=pitch;
+	}
+	return rows*ZMBV_BLOCK - ZMBV_SumNEON_32(acc);
+}
+
+static void ZMBV_XorNEON(unsigned char * dest, const unsigned char * old, const unsigned char * cur, int pitch, int rows, int vectors) {
+	for (int y=0;y<rows;y++) {
+		for (int i=0;i<vectors;i++) {
+			vst1q_u8(dest, veorq_u8(vld1q_u8(old+i*16), vld1q_u8(cur+i*16)));
+			dest+=16;
+		}
+		old+=pitch;
+		cur+=pitch;
+	}
+}
+
+static void ZMBV_XorNEON_8(unsigned char * dest, const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	ZMBV_XorNEON(dest, old, cur, pitch, rows, 1);
+}
+
+static void ZMBV_XorNEON_16(unsigned char * dest, const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	ZMBV_XorNEON(dest, old, cur, pitch, rows, 2);
+}
+
+static void ZMBV_XorNEON_32(unsigned char * dest, const unsigned char * old, const unsigned char * cur, int pitch, int rows) {
+	ZMBV_XorNEON(dest, old, cur, pitch, rows, 4);
+}
+
+/* NEON has no movemask, the sampled possible test stays in C */
+static const ZMBV_Kernels zmbv_kernels_neon = {
+	"NEON",
+	{ ZMBV_CompareNEON_8, ZMBV_CompareNEON_16, ZMBV_CompareNEON_32 },
+	{ ZMBV_PossibleC<char>, ZMBV_PossibleC<short>, ZMBV_PossibleC<int> },
+	{ ZMBV_XorNEON_8, ZMBV_XorNEON_16, ZMBV_XorNEON_32 }
+};
+#endif
+
+/* Kernel sets the cpu can run, best first, ending with the C versions */
+static int ZMBV_KernelList(const ZMBV_Kernels * list[4]) {
+	int count = 0;
+#if defined(ZMBV_AVX2) || (defined(ZMBV_SSE2) && !defined(ZMBV_SSE2_ALWAYS))
+	bool hasSSE2 = false, hasAVX2 = false;
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+	__cpuid(info, 1);
+	hasSSE2 = (info[3] & (1 << 26)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	(void)maxLeaf; (void)osxsave;
+#if defined(ZMBV_AVX2)
+	if (maxLeaf >= 7 && osxsave && (_xgetbv(0) & 6) == 6) {
+		__cpuidex(info, 7, 0);
+		hasAVX2 = (info[1] & (1 << 5)) != 0;
+	}
+#endif
+#else
+	__builtin_cpu_init();
+	hasSSE2 = __builtin_cpu_supports("sse2") != 0;
+#if defined(ZMBV_AVX2)
+	hasAVX2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+#endif
+	(void)hasSSE2;
+#if defined(ZMBV_AVX2)
+	if (hasAVX2) list[count++] = &zmbv_kernels_avx2;
+#endif
+#if defined(ZMBV_SSE2) && !defined(ZMBV_SSE2_ALWAYS)
+	if (hasSSE2) list[count++] = &zmbv_kernels_sse2;
+#endif
+#endif
+#if defined(ZMBV_SSE2_ALWAYS)
+	list[count++] = &zmbv_kernels_sse2;
+#endif
+#if defined(ZMBV_NEON)
+	list[count++] = &zmbv_kernels_neon;
+#endif
+	list[count++] = &zmbv_kernels_c;
+	return count;
+}
+
+const char * VideoCodec::SetKernels(const char * name) {
+	const ZMBV_Kernels * list[4];
+	int count = ZMBV_KernelList(list);
+	kernels = list[0];
+	if (name) {
+		for (int i=0;i<count;i++) {
+			if (!strcmp(name, list[i]->name)) {
+				kernels = list[i];
+				break;
+			}
+		}
+	}
+	return kernels->name;
+}
+
+bool VideoCodec::CheckKernels(void) {
+	const ZMBV_Kernels * list[4];
+	int count = ZMBV_KernelList(list);
+	/* Frames with a stride that keeps the loads unaligned */
+	const int pitch = 4*ZMBV_BLOCK*3 + 12;
+	const int size = pitch*(ZMBV_BLOCK+1);
+	unsigned char * old = new unsigned char[size];
+	unsigned char * cur = new unsigned char[size];
+	unsigned char * ref = new unsigned char[4*ZMBV_BLOCK*ZMBV_BLOCK];
+	unsigned char * out = new unsigned char[4*ZMBV_BLOCK*ZMBV_BLOCK];
+	bool ok = true;
+	unsigned int seed = 1;
+	for (int round=0;round<2000 && ok;round++) {
+		/* Mostly equal data with a few differences, some only in the top byte */
+		for (int i=0;i<size;i++) {
+			seed = seed*1103515245 + 12345;
+			old[i] = cur[i] = (unsigned char)(seed >> 16);
+			if (((seed >> 8) & 15) < (unsigned int)(round & 7))
+				cur[i] ^= (unsigned char)(1 << ((seed >> 4) & 7));
+		}
+		int offset = round % 13;
+		int rows = 1 + (round % ZMBV_BLOCK);
+		const unsigned char * o = old + offset;
+		const unsigned char * c = cur + offset;
+		for (int f=0;f<3 && ok;f++) {
+			int bytes = ZMBV_BLOCK*rows<<f;
+			zmbv_kernels_c.xorblock[f](ref, o, c, pitch, rows);
+			int compare = zmbv_kernels_c.compare[f](o, c, pitch, rows);
+			int possible = zmbv_kernels_c.possible[f](o, c, pitch, rows);
+			for (int k=0;k<count-1;k++) {
+				list[k]->xorblock[f](out, o, c, pitch, rows);
+				if (list[k]->compare[f](o, c, pitch, rows) != compare ||
+					list[k]->possible[f](o, c, pitch, rows) != possible ||
+					memcmp(out, ref, bytes)) {
+					ok = false;
+					break;
+				}
+			}
+		}
+	}
+	delete [] old;
+	delete [] cur;
+	delete [] ref;
+	delete [] out;
+	return ok;
+}
+
 template<class P>
 INLINE int VideoCodec::PossibleBlock(int vx,int vy,FrameBlock * block) {
 	int ret=0;
 	P * pold=((P*)oldframe)+block->start+(vy*pitch)+vx;
 	P * pnew=((P*)newframe)+block->start;;	
+	if (block->dx == ZMBV_BLOCK)
+		return kernels->possible[sizeof(P)>>1]((unsigned char *)pold, (unsigned char *)pnew, pitch*sizeof(P), block->dy);
 	for (int y=0;y<block->dy;y+=4) {
 		for (int x=0;x<block->dx;x+=4) {
 			int test=0-((pold[x]-pnew[x])&0x00ffffff);
@@ -167,6 +706,8 @@ INLINE int VideoCodec::CompareBlock(int vx,int vy,FrameBlock * block) {
 	int ret=0;
 	P * pold=((P*)oldframe)+block->start+(vy*pitch)+vx;
 	P * pnew=((P*)newframe)+block->start;;	
+	if (block->dx == ZMBV_BLOCK)
+		return kernels->compare[sizeof(P)>>1]((unsigned char *)pold, (unsigned char *)pnew, pitch*sizeof(P), block->dy);
 	for (int y=0;y<block->dy;y++) {
 		for (int x=0;x<block->dx;x++) {
 			int test=0-((pold[x]-pnew[x])&0x00ffffff);
@@ -179,30 +720,43 @@ INLINE int VideoCodec::CompareBlock(int vx,int vy,FrameBlock * block) {
 }
 
 template<class P>
-INLINE void VideoCodec::AddXorBlock(int vx,int vy,FrameBlock * block) {
+INLINE int VideoCodec::AddXorBlock(int vx,int vy,FrameBlock * block,unsigned char * dest) {
 	P * pold=((P*)oldframe)+block->start+(vy*pitch)+vx;
 	P * pnew=((P*)newframe)+block->start;
+	P * pdest=(P*)dest;
+	if (block->dx == ZMBV_BLOCK) {
+		kernels->xorblock[sizeof(P)>>1](dest, (unsigned char *)pold, (unsigned char *)pnew, pitch*sizeof(P), block->dy);
+		return block->dx*block->dy*sizeof(P);
+	}
 	for (int y=0;y<block->dy;y++) {
 		for (int x=0;x<block->dx;x++) {
-			*((P*)&work[workUsed])=pnew[x] ^ pold[x];
-			workUsed+=sizeof(P);
+			*pdest++=pnew[x] ^ pold[x];
 		}
 		pold+=pitch;
 		pnew+=pitch;
 	}
+	return block->dx*block->dy*sizeof(P);
+}
+
+bool VideoCodec::BlockChanged(FrameBlock * block) {
+	int y = block->start / pitch - MAX_VECTOR;
+	for (int i=0;i<block->dy;i++)
+		if (lineChanged[y+i]) return true;
+	return false;
 }
 
 template<class P>
-void VideoCodec::AddXorFrame(void) {
-	int written=0;
-	int lastvector=0;
-	signed char * vectors=(signed char*)&work[workUsed];
-	/* Align the following xor data on 4 byte boundary*/
-	workUsed=(workUsed + blockcount*2 +3) & ~3;
-	int totalx=0;
-	int totaly=0;
-	for (int b=0;b<blockcount;b++) {
+void VideoCodec::AddXorBand(XorBand * band) {
+	signed char * vectors=workVectors;
+	band->used=0;
+	for (int b=band->firstBlock;b<band->lastBlock;b++) {
 		FrameBlock * block=&blocks[b];
+		/* Untouched lines match the old frame, no need to search */
+		if (!BlockChanged(block)) {
+			vectors[b*2+0]=0;
+			vectors[b*2+1]=0;
+			continue;
+		}
 		int bestvx = 0;
 		int bestvy = 0;
 		int bestchange=CompareBlock<P>(0,0, block);
@@ -226,11 +780,117 @@ void VideoCodec::AddXorFrame(void) {
 		vectors[b*2+1]=(bestvy << 1);
 		if (bestchange) {
 			vectors[b*2+0]|=1;
-			AddXorBlock<P>(bestvx, bestvy, block);
+			band->used+=AddXorBlock<P>(bestvx, bestvy, block, band->buf+band->used);
 		}
 	}
 }
 
+void VideoCodec::XorBandFrame(int band) {
+	switch (format) {
+	case ZMBV_FORMAT_8BPP:
+		AddXorBand<char>(&bands[band]);
+		break;
+	case ZMBV_FORMAT_15BPP:
+	case ZMBV_FORMAT_16BPP:
+		AddXorBand<short>(&bands[band]);
+		break;
+	case ZMBV_FORMAT_32BPP:
+		AddXorBand<int>(&bands[band]);
+		break;
+	default:
+		bands[band].used=0;
+		break;
+	}
+}
+
+template<class P>
+void VideoCodec::AddXorFrame(void) {
+	workVectors=(signed char*)&work[workUsed];
+	/* Align the following xor data on 4 byte boundary*/
+	workUsed=(workUsed + blockcount*2 +3) & ~3;
+	bands[0].buf=&work[workUsed];
+	int b;
+#if defined(ZMBV_THREADS)
+	if (bandCount > 1 && StartWorkers()) {
+		for (b=1;b<bandCount;b++)
+			SDL_SemPost(workers[b-1].start);
+		AddXorBand<P>(&bands[0]);
+		for (b=1;b<bandCount;b++)
+			SDL_SemWait(workDone);
+	} else
+#endif
+	for (b=0;b<bandCount;b++)
+		AddXorBand<P>(&bands[b]);
+	/* Join the bands in block order, giving the same data a single pass would */
+	workUsed+=bands[0].used;
+	for (b=1;b<bandCount;b++) {
+		memcpy(&work[workUsed],bands[b].buf,bands[b].used);
+		workUsed+=bands[b].used;
+	}
+}
+
+#if defined(ZMBV_THREADS)
+int VideoCodec::WorkerProc(void * data) {
+	Worker * worker=(Worker *)data;
+	VideoCodec * codec=worker->codec;
+	for (;;) {
+		SDL_SemWait(worker->start);
+		if (codec->workQuit)
+			break;
+		codec->XorBandFrame(worker->band);
+		SDL_SemPost(codec->workDone);
+	}
+	return 0;
+}
+
+bool VideoCodec::StartWorkers(void) {
+	if (!workDone) {
+		workDone=SDL_CreateSemaphore(0);
+		if (!workDone)
+			return false;
+	}
+	while (workerCount < bandCount-1) {
+		Worker * worker=&workers[workerCount];
+		worker->codec=this;
+		worker->band=workerCount+1;
+		worker->start=SDL_CreateSemaphore(0);
+		worker->thread=worker->start ? SDL_CreateThread(&VideoCodec::WorkerProc, worker) : 0;
+		if (!worker->thread) {
+			if (worker->start) SDL_DestroySemaphore(worker->start);
+			worker->start=0;
+			/* Keep searching on this thread from now on */
+			threadCount=1;
+			return false;
+		}
+		workerCount++;
+	}
+	return true;
+}
+
+void VideoCodec::StopWorkers(void) {
+	workQuit=true;
+	for (int i=0;i<workerCount;i++)
+		SDL_SemPost(workers[i].start);
+	for (int i=0;i<workerCount;i++) {
+		SDL_WaitThread(workers[i].thread, 0);
+		SDL_DestroySemaphore(workers[i].start);
+	}
+	workerCount=0;
+	workQuit=false;
+	if (workDone) SDL_DestroySemaphore(workDone);
+	workDone=0;
+}
+#endif
+
+void VideoCodec::SetThreads(int count) {
+	if (count < 1) count = 1;
+	if (count > ZMBV_MAX_THREADS) count = ZMBV_MAX_THREADS;
+#if !defined(ZMBV_THREADS)
+	count = 1;
+#endif
+	threadCount = count;
+}
+
 bool VideoCodec::SetupCompress( int _width, int _height ) {
 	width = _width;
 	height = _height;
@@ -266,6 +926,7 @@ bool VideoCodec::PrepareCompressFrame(int flags,  zmbv_format_t _format, char *
 	oldframe = copyFrame;
 
 	compress.linesDone = 0;
+	memset(lineChanged, 1, height);
 	compress.writeSize = writeSize;
 	compress.writeDone = 1;
 	compress.writeBuf = (unsigned char *)writeBuf;
@@ -321,11 +982,27 @@ void VideoCodec::CompressLines(int lineCount, void *lineData[]) {
 	unsigned char *destStart = newframe + pixelsize*(MAX_VECTOR+(compress.linesDone+MAX_VECTOR)*pitch);
 	while ( i < lineCount && (compress.linesDone < height)) {
 		memcpy(destStart, lineData[i],  lineWidth );
+		lineChanged[compress.linesDone] = 1;
 		destStart += linePitch;
 		i++;compress.linesDone++;
 	}
 }
 
+void VideoCodec::SkipLines(int lineCount) {
+	int linePitch = pitch * pixelsize;
+	int lineWidth = width * pixelsize;
+	int offset = pixelsize*(MAX_VECTOR+(compress.linesDone+MAX_VECTOR)*pitch);
+	unsigned char *destStart = newframe + offset;
+	unsigned char *srcStart = oldframe + offset;
+	while ( lineCount-- > 0 && (compress.linesDone < height)) {
+		memcpy(destStart, srcStart, lineWidth );
+		lineChanged[compress.linesDone] = 0;
+		destStart += linePitch;
+		srcStart += linePitch;
+		compress.linesDone++;
+	}
+}
+
 int VideoCodec::FinishCompressFrame( void ) {
 	unsigned char firstByte = *compress.writeBuf;
 	if (firstByte & Mask_KeyFrame) {
@@ -348,7 +1025,7 @@ int VideoCodec::FinishCompressFrame( void ) {
 			AddXorFrame<short>();
 			break;
 		case ZMBV_FORMAT_32BPP:
-			AddXorFrame<long>();
+			AddXorFrame<int>();
 			break;
 		}
 	}
@@ -469,7 +1146,7 @@ bool VideoCodec::DecompressFrame(void * framedata, int size) {
 			UnXorFrame<short>();
 			break;
 		case ZMBV_FORMAT_32BPP:
-			UnXorFrame<long>();
+			UnXorFrame<int>();
 			break;
 		}
 	}
@@ -536,6 +1213,13 @@ void VideoCodec::FreeBuffers(void) {
 	if (work) {
 		delete[] work;work=0;
 	}
+	if (lineChanged) {
+		delete[] lineChanged;lineChanged=0;
+	}
+	for (int i=1;i<bandCount;i++) {
+		delete[] bands[i].buf;bands[i].buf=0;
+	}
+	bandCount=0;
 }
 
 
@@ -545,5 +1229,22 @@ VideoCodec::VideoCodec() {
 	buf1 = 0;
 	buf2 = 0;
 	work = 0;
+	lineChanged = 0;
+	SetKernels(0);
+	bandCount = 0;
+	threadCount = 1;
+	workVectors = 0;
+#if defined(ZMBV_THREADS)
+	workerCount = 0;
+	workDone = 0;
+	workQuit = false;
+#endif
 	memset( &zstream, 0, sizeof(zstream));
 }
+
+VideoCodec::~VideoCodec() {
+#if defined(ZMBV_THREADS)
+	StopWorkers();
+#endif
+	FreeBuffers();
+}
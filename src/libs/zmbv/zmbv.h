@@ -26,6 +26,13 @@
 
 #define CODEC_4CC "ZMBV"
 
+/* Inside DOSBox the delta search of a frame is spread over SDL threads */
+#ifdef DOSBOX_DOSBOX_H
+#define ZMBV_THREADS 1
+#include "SDL.h"
+#endif
+#define ZMBV_MAX_THREADS 16
+
 typedef enum {
 	ZMBV_FORMAT_NONE		= 0x00,
 	ZMBV_FORMAT_1BPP		= 0x01,
@@ -38,6 +45,17 @@ typedef enum {
 	ZMBV_FORMAT_32BPP	= 0x08
 } zmbv_format_t;
 
+/* Compare, possible and xor kernels for the full width blocks,
+ * indexed by 1, 2 and 4 byte pixels. pitch is in bytes. */
+typedef int (*zmbv_count_t)(const unsigned char * old, const unsigned char * cur, int pitch, int rows);
+typedef void (*zmbv_xor_t)(unsigned char * dest, const unsigned char * old, const unsigned char * cur, int pitch, int rows);
+struct ZMBV_Kernels {
+	const char * name;
+	zmbv_count_t compare[3];
+	zmbv_count_t possible[3];
+	zmbv_xor_t xorblock[3];
+};
+
 void Msg(const char fmt[], ...);
 class VideoCodec {
 private:
@@ -49,6 +67,12 @@ private:
 		int x,y;
 		int slot;
 	};
+	/* A band of whole block rows, searched by one thread into its own buffer */
+	struct XorBand {
+		int firstBlock, lastBlock;
+		unsigned char *buf;
+		int used;
+	};
 	struct KeyframeHeader {
 		unsigned char high_version;
 		unsigned char low_version;
@@ -70,12 +94,32 @@ private:
 	unsigned char *oldframe, *newframe;
 	unsigned char *buf1, *buf2, *work;
 	int bufsize;
+	/* Lines of the new frame that differ from the old one */
+	unsigned char *lineChanged;
 
 	int blockcount; 
 	FrameBlock * blocks;
 
 	int workUsed, workPos;
 
+	XorBand bands[ZMBV_MAX_THREADS];
+	int bandCount, threadCount;
+	signed char * workVectors;
+#if defined(ZMBV_THREADS)
+	struct Worker {
+		VideoCodec * codec;
+		int band;
+		SDL_Thread * thread;
+		SDL_sem * start;
+	} workers[ZMBV_MAX_THREADS];
+	int workerCount;
+	SDL_sem * workDone;
+	bool workQuit;
+	static int WorkerProc(void * data);
+	bool StartWorkers(void);
+	void StopWorkers(void);
+#endif
+
 	int palsize;
 	char palette[256*4];
 	int height, width, pitch;
@@ -83,6 +127,7 @@ private:
 	int pixelsize;
 
 	z_stream zstream;
+	const ZMBV_Kernels * kernels;
 
 	// methods
 	void FreeBuffers(void);
@@ -91,6 +136,10 @@ private:
 
 	template<class P>
 		void AddXorFrame(void);
+	template<class P>
+		void AddXorBand(XorBand * band);
+	void XorBandFrame(int band);
+	bool BlockChanged(FrameBlock * block);
 	template<class P>
 		void UnXorFrame(void);
 	template<class P>
@@ -98,19 +147,29 @@ private:
 	template<class P>
 		INLINE int CompareBlock(int vx,int vy,FrameBlock * block);
 	template<class P>
-		INLINE void AddXorBlock(int vx,int vy,FrameBlock * block);
+		INLINE int AddXorBlock(int vx,int vy,FrameBlock * block,unsigned char * dest);
 	template<class P>
 		INLINE void UnXorBlock(int vx,int vy,FrameBlock * block);
 	template<class P>
 		INLINE void CopyBlock(int vx, int vy,FrameBlock * block);
 public:
 	VideoCodec();
+	~VideoCodec();
+	/* Threads used for the delta search, 1 keeps it on the calling thread */
+	void SetThreads(int count);
+	/* Picks a kernel set by name (SSE2, AVX2, NEON, C), 0 for the best one
+	 * the cpu supports. Returns the name of the set in use. */
+	const char * SetKernels(const char * name);
+	/* Runs every supported kernel set against the C one, true when they all match */
+	static bool CheckKernels(void);
 	bool SetupCompress( int _width, int _height);
 	bool SetupDecompress( int _width, int _height);
 	zmbv_format_t BPPFormat( int bpp );
 	int NeededSize( int _width, int _height, zmbv_format_t _format);
 
 	void CompressLines(int lineCount, void *lineData[]);
+	/* Keeps lines that are the same as in the previous frame */
+	void SkipLines(int lineCount);
 	bool PrepareCompressFrame(int flags,  zmbv_format_t _format, char * pal, void *writeBuf, int writeSize);
 	int FinishCompressFrame( void );
 	bool DecompressFrame(void * framedata, int size);
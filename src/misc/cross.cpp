@@ -30,11 +30,24 @@
 #include <shlobj.h>
 #endif
 
+#if !defined(WIN32)
+#include <time.h>
+#if !defined(DB_HAVE_CLOCK_GETTIME)
+#include <sys/time.h>
+#endif
+#endif
+
 #if defined HAVE_SYS_TYPES_H && defined HAVE_PWD_H
 #include <sys/types.h>
 #include <pwd.h>
 #endif
 
+#if defined(MACOSX)
+#include <mach-o/dyld.h>
+#elif !defined(WIN32)
+#include <unistd.h>
+#endif
+
 #ifdef WIN32
 static void W32_ConfDir(std::string& in,bool create) {
 	int c = create?1:0;
@@ -134,6 +147,103 @@ bool Cross::IsPathAbsolute(std::string const& in) {
 	return false;
 }
 
+int Cross::GetCPUCount(void) {
+	int count = 1;
+#if defined (WIN32)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	count = (int)info.dwNumberOfProcessors;
+#elif defined (_SC_NPROCESSORS_ONLN)
+	count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	return count > 0 ? count : 1;
+}
+
+/* Full path of the running executable, false if the platform can't tell */
+bool Cross::GetExecutablePath(std::string & path) {
+#if defined (WIN32)
+	char buf[MAX_PATH+1];
+	DWORD len = GetModuleFileName(NULL,buf,MAX_PATH);
+	if (len == 0 || len >= MAX_PATH) return false;
+	path.assign(buf,len);
+	return true;
+#elif defined(MACOSX)
+	char buf[4096];
+	uint32_t size = sizeof(buf);
+	if (_NSGetExecutablePath(buf,&size) != 0) return false;
+	path = buf;
+	return true;
+#elif defined(LINUX)
+	char buf[4096];
+	ssize_t len = readlink("/proc/self/exe",buf,sizeof(buf)-1);
+	if (len <= 0) return false;
+	path.assign(buf,(size_t)len);
+	return true;
+#else
+	return false;
+#endif
+}
+
+/* Monotonic host time in microseconds, only differences are meaningful */
+Bit64u Cross::GetTicksUs(void) {
+#if defined (WIN32)
+	static LARGE_INTEGER frequency = {{0,0}};
+	if (!frequency.QuadPart) QueryPerformanceFrequency(&frequency);
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return (Bit64u)(counter.QuadPart/frequency.QuadPart)*1000000+
+		(Bit64u)(counter.QuadPart%frequency.QuadPart)*1000000/frequency.QuadPart;
+#elif defined(DB_HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+	struct timespec tp;
+	clock_gettime(CLOCK_MONOTONIC,&tp);
+	return (Bit64u)tp.tv_sec*1000000+(Bit64u)(tp.tv_nsec/1000);
+#else
+	struct timeval tv;
+	gettimeofday(&tv,0);
+	return (Bit64u)tv.tv_sec*1000000+(Bit64u)tv.tv_usec;
+#endif
+}
+
+#if defined (WIN32)
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+typedef HANDLE (WINAPI * CreateWaitableTimerExW_t)(LPSECURITY_ATTRIBUTES,LPCWSTR,DWORD,DWORD);
+#endif
+
+/* Sleep about us microseconds */
+void Cross::DelayUs(Bit32u us) {
+#if defined (WIN32)
+	/* Sleep() only knows whole ms. Windows 10 1803 and newer have high
+	 * resolution waitable timers, older versions sleep the whole ms and
+	 * spin on the performance counter for the rest */
+	static HANDLE timer = NULL;
+	static bool probed = false;
+	if (!probed) {
+		probed = true;
+		CreateWaitableTimerExW_t create = (CreateWaitableTimerExW_t)
+			GetProcAddress(GetModuleHandle("kernel32.dll"),"CreateWaitableTimerExW");
+		if (create) timer = create(NULL,NULL,CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,TIMER_ALL_ACCESS);
+	}
+	if (timer) {
+		LARGE_INTEGER due;
+		due.QuadPart = -(LONGLONG)us*10;	// relative, in units of 100 ns
+		if (SetWaitableTimer(timer,&due,0,NULL,NULL,FALSE)) {
+			WaitForSingleObject(timer,INFINITE);
+			return;
+		}
+	}
+	Bit64u end = GetTicksUs() + us;
+	if (us >= 2000) Sleep(us/1000 - 1);
+	while (GetTicksUs() < end) {}
+#else
+	struct timespec ts;
+	ts.tv_sec=us/1000000;
+	ts.tv_nsec=(long)(us%1000000)*1000;
+	nanosleep(&ts,0);
+#endif
+}
+
 #if defined (WIN32)
 
 dir_information* open_directory(const char* dirname) {